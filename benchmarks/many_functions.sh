@@ -0,0 +1,47 @@
+#!/bin/bash
+# Many Functions Benchmark for Gem Language
+# Generates a program with 1000 distinct functions and calls every one of
+# them repeatedly, then times it with and without --experimental-jit.
+# Per-call JIT bookkeeping that scales with the number of functions the
+# program has shows up as the gap between the two runs.
+#
+# Usage: benchmarks/many_functions.sh [rounds]
+
+GEMC="${GEMC:-./bin/gemc}"
+ROUNDS="${1:-1000}"
+PROGRAM="$(mktemp /tmp/gem_many_functions_XXXXXX.gem)"
+trap 'rm -f "$PROGRAM"' EXIT
+
+# The compiler caps global functions and locals per function at 255, so
+# the functions are nested 200 at a time inside five outer functions.
+OUTER=5
+PER_OUTER=200
+echo "int step = 1;" >> "$PROGRAM"
+for ((g = 0; g < OUTER; g++)); do
+  echo "def group$g(int rounds) int" >> "$PROGRAM"
+  for ((i = 0; i < PER_OUTER; i++)); do
+    printf '  def f%d(int n) int\n    return n + step + %d;\n  end\n' $i $((g * PER_OUTER + i)) >> "$PROGRAM"
+  done
+  echo "  int! total = 0;" >> "$PROGRAM"
+  echo "  for (int! r = 0; r < rounds; r = r + 1)" >> "$PROGRAM"
+  for ((i = 0; i < PER_OUTER; i++)); do
+    echo "    total = total + (f$i(r) as int);" >> "$PROGRAM"
+  done
+  echo "  end" >> "$PROGRAM"
+  echo "  return total;" >> "$PROGRAM"
+  echo "end" >> "$PROGRAM"
+done
+echo "int! total = 0;" >> "$PROGRAM"
+for ((g = 0; g < OUTER; g++)); do
+  echo "total = total + (group$g($ROUNDS) as int);" >> "$PROGRAM"
+done
+echo "puts total;" >> "$PROGRAM"
+
+echo "=== GEM MANY FUNCTIONS BENCHMARK ==="
+echo "Making $((OUTER * PER_OUTER * ROUNDS)) calls to $((OUTER * PER_OUTER)) distinct functions..."
+echo ""
+echo "--- interpreter ---"
+time "$GEMC" "$PROGRAM"
+echo ""
+echo "--- --experimental-jit ---"
+time "$GEMC" --experimental-jit "$PROGRAM"
@@ -0,0 +1,31 @@
+#!/bin/bash
+# Scope Compile Benchmark for Gem Language
+# Generates a program of roughly 50,000 lines made of functions full of
+# begin/end blocks, then times how long gemc takes to run it. The
+# generated functions are never called, so the time is almost entirely
+# spent compiling.
+#
+# Usage: benchmarks/scope_compile.sh [lines]
+
+GEMC="${GEMC:-./bin/gemc}"
+LINES="${1:-50000}"
+PROGRAM="$(mktemp /tmp/gem_scope_compile_XXXXXX.gem)"
+trap 'rm -f "$PROGRAM"' EXIT
+
+# Functions are capped at 200 to stay under the compiler's global
+# function limit; each one gets enough blocks to reach the line count.
+FUNCTIONS=200
+BLOCKS=$(((LINES / FUNCTIONS - 2) / 3))
+for ((i = 0; i < FUNCTIONS; i++)); do
+  echo "def f$i() int" >> "$PROGRAM"
+  for ((j = 0; j < BLOCKS; j++)); do
+    printf '  begin\n    string s = "block %d.%d";\n  end\n' $i $j >> "$PROGRAM"
+  done
+  echo "  return $i;" >> "$PROGRAM"
+  echo "end" >> "$PROGRAM"
+done
+echo 'puts "done";' >> "$PROGRAM"
+
+echo "=== GEM SCOPE COMPILE BENCHMARK ==="
+echo "Compiling $(wc -l < "$PROGRAM") lines ($FUNCTIONS functions, $((FUNCTIONS * BLOCKS)) blocks)..."
+time "$GEMC" "$PROGRAM"
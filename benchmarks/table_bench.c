@@ -0,0 +1,178 @@
+// Microbenchmark for the hash table in src/table.c.
+//
+//   make table-bench && ./bin/table_bench [keys]
+//
+// Times the lookups the VM leans on: interning (vm.strings), hits and
+// misses on string-keyed tables, the small-table misses a property get
+// takes before falling back to class methods, number keys, and
+// delete/reinsert churn. Prints nanoseconds per operation.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "memory.h"
+#include "object.h"
+#include "table.h"
+#include "vm.h"
+
+#define ROUNDS 20
+#define SMALL_TABLES 4096
+#define SMALL_FIELDS 4
+
+static volatile uint64_t sink;
+
+static double nowNanos() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// Same FNV-1a hash as object.c, for probing the intern table with strings
+// that were never allocated.
+static uint32_t fnv1a(const char* key, int length) {
+  uint32_t hash = 2166136261u;
+  for (int i = 0; i < length; i++) {
+    hash ^= (uint8_t)key[i];
+    hash *= 16777619;
+  }
+  return hash;
+}
+
+static void report(const char* name, double start, long operations) {
+  printf("%-22s %8.2f ns/op\n", name, (nowNanos() - start) / operations);
+}
+
+// Allocates `count` interned strings named prefix0, prefix1, ... and keeps
+// them reachable from an array on the VM stack.
+static ObjString** makeKeys(const char* prefix, int count) {
+  ObjArray* keep = newArray();
+  push(OBJ_VAL(keep));
+  ObjString** keys = malloc(sizeof(ObjString*) * count);
+  char buffer[32];
+  for (int i = 0; i < count; i++) {
+    int length = snprintf(buffer, sizeof(buffer), "%s%d", prefix, i);
+    keys[i] = copyString(buffer, length);
+    writeValueArray(&keep->elements, OBJ_VAL(keys[i]));
+    writeBarrier((Obj*)keep, OBJ_VAL(keys[i]));
+  }
+  return keys;
+}
+
+int main(int argc, char* argv[]) {
+  int count = argc > 1 ? atoi(argv[1]) : 100000;
+  long operations = (long)count * ROUNDS;
+  initVM();
+
+  ObjString** keys = makeKeys("key", count);
+  ObjString** absent = makeKeys("absent", count);
+
+  char** missChars = malloc(sizeof(char*) * count);
+  uint32_t* missHashes = malloc(sizeof(uint32_t) * count);
+  for (int i = 0; i < count; i++) {
+    char buffer[32];
+    int length = snprintf(buffer, sizeof(buffer), "missing%d", i);
+    missChars[i] = strdup(buffer);
+    missHashes[i] = fnv1a(buffer, length);
+  }
+
+  printf("%d keys, %d rounds, vm.strings holds %d strings\n",
+         count, ROUNDS, vm.strings.count);
+
+  double start = nowNanos();
+  for (int round = 0; round < ROUNDS; round++) {
+    for (int i = 0; i < count; i++) {
+      ObjString* key = keys[i];
+      sink += (uintptr_t)tableFindString(&vm.strings, key->chars,
+                                         key->length, key->hash);
+    }
+  }
+  report("intern hit", start, operations);
+
+  start = nowNanos();
+  for (int round = 0; round < ROUNDS; round++) {
+    for (int i = 0; i < count; i++) {
+      sink += (uintptr_t)tableFindString(&vm.strings, missChars[i],
+                                         (int)strlen(missChars[i]),
+                                         missHashes[i]);
+    }
+  }
+  report("intern miss", start, operations);
+
+  Table table;
+  initTable(&table);
+  start = nowNanos();
+  for (int i = 0; i < count; i++) {
+    tableSet(&table, keys[i], NUMBER_VAL(i));
+  }
+  report("string set", start, count);
+
+  Value value;
+  start = nowNanos();
+  for (int round = 0; round < ROUNDS; round++) {
+    for (int i = 0; i < count; i++) {
+      sink += tableGet(&table, keys[i], &value);
+    }
+  }
+  report("string get hit", start, operations);
+
+  start = nowNanos();
+  for (int round = 0; round < ROUNDS; round++) {
+    for (int i = 0; i < count; i++) {
+      sink += tableGet(&table, absent[i], &value);
+    }
+  }
+  report("string get miss", start, operations);
+
+  start = nowNanos();
+  for (int round = 0; round < ROUNDS; round++) {
+    for (int i = 0; i < count; i++) {
+      tableDelete(&table, keys[i]);
+      tableSet(&table, keys[i], NUMBER_VAL(i));
+    }
+  }
+  report("delete + reinsert", start, operations * 2);
+  freeTable(&table);
+
+  // Instance-sized tables probed for a method name they don't hold.
+  Table* fields = malloc(sizeof(Table) * SMALL_TABLES);
+  for (int t = 0; t < SMALL_TABLES; t++) {
+    initTable(&fields[t]);
+    for (int f = 0; f < SMALL_FIELDS; f++) {
+      tableSet(&fields[t], keys[(t + f) % count], NIL_VAL);
+    }
+  }
+  start = nowNanos();
+  for (int round = 0; round < ROUNDS; round++) {
+    for (int i = 0; i < count; i++) {
+      sink += tableGet(&fields[i % SMALL_TABLES], absent[i], &value);
+    }
+  }
+  report("small table miss", start, operations);
+  for (int t = 0; t < SMALL_TABLES; t++) freeTable(&fields[t]);
+  free(fields);
+
+  initTable(&table);
+  start = nowNanos();
+  for (int i = 0; i < count; i++) {
+    tableSetValue(&table, NUMBER_VAL(i), NUMBER_VAL(i));
+  }
+  report("number set", start, count);
+
+  start = nowNanos();
+  for (int round = 0; round < ROUNDS; round++) {
+    for (int i = 0; i < count; i++) {
+      sink += tableGetValue(&table, NUMBER_VAL(i), &value);
+    }
+  }
+  report("number get hit", start, operations);
+  freeTable(&table);
+
+  for (int i = 0; i < count; i++) free(missChars[i]);
+  free(missChars);
+  free(missHashes);
+  free(keys);
+  free(absent);
+  freeVM();
+  return 0;
+}
@@ -32,9 +32,11 @@ print_status() {
     echo "$message" >> "$LOG_FILE"
 }
 
-# Function to run a single test
+# Function to run a single test, with any further arguments passed to the
+# compiler before the test file
 run_test() {
     local test_file=$1
+    shift
     local test_name=$(basename "$test_file" .gem)
     
     print_status "$BLUE" "Running test: $test_name"
@@ -46,7 +48,7 @@ run_test() {
         return 1
     fi
     
-    "$COMPILER" "$test_file" >> "$LOG_FILE" 2>&1
+    "$COMPILER" "$@" "$test_file" >> "$LOG_FILE" 2>&1
     local exit_code=$?
     
     if [[ $exit_code -eq 0 ]]; then
@@ -61,6 +63,41 @@ run_test() {
     fi
 }
 
+# Function to run a test that must fail, checking that what it prints to
+# stderr is exactly its "# expect error: " lines
+run_error_test() {
+    local test_file=$1
+    shift
+    local test_name=$(basename "$test_file" .gem)
+    
+    print_status "$BLUE" "Running error test: $test_name"
+    
+    if [[ ! -f "$test_file" ]]; then
+        print_status "$RED" "  ❌ Test file not found: $test_file"
+        ((FAILED_TESTS++))
+        return 1
+    fi
+    
+    local expected=$(sed -n 's/^# expect error: //p' "$test_file")
+    local actual
+    actual=$("$COMPILER" "$@" "$test_file" 2>&1 >> "$LOG_FILE")
+    local exit_code=$?
+    echo "$actual" >> "$LOG_FILE"
+    
+    if [[ $exit_code -ne 0 && "$actual" == "$expected" ]]; then
+        print_status "$GREEN" "  ✅ PASSED: $test_name"
+        ((PASSED_TESTS++))
+        return 0
+    else
+        print_status "$RED" "  ❌ FAILED: $test_name (exit code: $exit_code)"
+        echo "    Expected errors:" >> "$LOG_FILE"
+        echo "$expected" >> "$LOG_FILE"
+        echo "    Error details logged to $LOG_FILE"
+        ((FAILED_TESTS++))
+        return 1
+    fi
+}
+
 # Function to run tests by category
 run_test_category() {
     local category=$1
@@ -134,7 +171,10 @@ main() {
     # Object-Oriented Programming
     run_test_category "Object-Oriented Programming" \
         "test_classes.gem" \
-        "test_inheritance.gem"
+        "test_inheritance.gem" \
+        "test_shapes.gem" \
+        "test_inline_caches.gem" \
+        "test_global_slots.gem"
     
     # Module System
     run_test_category "Module System" \
@@ -149,13 +189,47 @@ main() {
     # Advanced Features
     run_test_category "Advanced Features" \
         "test_memory_safety.gem" \
+        "test_garbage_collection.gem" \
         "test_type_safety.gem" \
         "test_jit_compilation.gem" \
+        "test_superinstructions.gem" \
+        "test_quickening.gem" \
+        "test_compare_branch.gem" \
+        "test_tail_calls.gem" \
+        "test_deep_recursion.gem" \
+        "test_constant_folding.gem" \
+        "test_inlining.gem" \
         "test_hashes.gem" \
+        "test_arrays.gem" \
         "test_type_coercion.gem" \
         "test_http.gem" \
         "test_borrow_checking.gem"
     
+    # Runtime errors and their stack traces
+    print_status "$PURPLE" "\n=== Runtime Errors ==="
+    run_error_test "$TEST_DIR/errors/test_inlining_arithmetic.gem"
+    ((TOTAL_TESTS++))
+    run_error_test "$TEST_DIR/errors/test_inlining_global.gem"
+    ((TOTAL_TESTS++))
+    
+    # Incremental collection, pausing after every microsecond of marking
+    print_status "$PURPLE" "\n=== Incremental Garbage Collection ==="
+    run_test "$TEST_DIR/test_garbage_collection.gem" --gc-pause-us 1
+    ((TOTAL_TESTS++))
+    run_test "$TEST_DIR/test_memory_safety.gem" --gc-pause-us 1
+    ((TOTAL_TESTS++))
+    run_test "$TEST_DIR/test_arrays.gem" --gc-pause-us 1
+    ((TOTAL_TESTS++))
+    
+    # Compiled code
+    print_status "$PURPLE" "\n=== JIT Compilation ==="
+    run_test "$TEST_DIR/test_jit_baseline.gem" --experimental-jit
+    ((TOTAL_TESTS++))
+    run_test "$TEST_DIR/test_jit_osr.gem" --experimental-jit
+    ((TOTAL_TESTS++))
+    run_test "$TEST_DIR/test_jit_specialized.gem" --experimental-jit
+    ((TOTAL_TESTS++))
+    
     # Final Summary
     print_status "$CYAN" "\n🏁 Test Suite Complete!"
     print_status "$CYAN" "================================"
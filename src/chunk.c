@@ -19,6 +19,24 @@ void initChunk(Chunk* chunk) {
 //> chunk-init-constant-array
   initValueArray(&chunk->constants);
 //< chunk-init-constant-array
+//> Inline Caches init-property-caches
+  chunk->propertyCaches = NULL;
+  chunk->propertyCacheCount = 0;
+  chunk->propertyCacheCapacity = 0;
+  chunk->callCaches = NULL;
+  chunk->callCacheCount = 0;
+  chunk->callCacheCapacity = 0;
+//< Inline Caches init-property-caches
+//> Number Locals init-number-ranges
+  chunk->numberRanges = NULL;
+  chunk->numberRangeCount = 0;
+  chunk->numberRangeCapacity = 0;
+//< Number Locals init-number-ranges
+//> Inlining init-inlined-ranges
+  chunk->inlinedRanges = NULL;
+  chunk->inlinedRangeCount = 0;
+  chunk->inlinedRangeCapacity = 0;
+//< Inlining init-inlined-ranges
 }
 //> free-chunk
 void freeChunk(Chunk* chunk) {
@@ -29,6 +47,18 @@ void freeChunk(Chunk* chunk) {
 //> chunk-free-constants
   freeValueArray(&chunk->constants);
 //< chunk-free-constants
+//> Inline Caches free-property-caches
+  FREE_ARRAY(PropertyCache, chunk->propertyCaches,
+             chunk->propertyCacheCapacity);
+  FREE_ARRAY(InlineCache, chunk->callCaches, chunk->callCacheCapacity);
+//< Inline Caches free-property-caches
+//> Number Locals free-number-ranges
+  FREE_ARRAY(NumberRange, chunk->numberRanges, chunk->numberRangeCapacity);
+//< Number Locals free-number-ranges
+//> Inlining free-inlined-ranges
+  FREE_ARRAY(InlinedRange, chunk->inlinedRanges,
+             chunk->inlinedRangeCapacity);
+//< Inlining free-inlined-ranges
   initChunk(chunk);
 }
 //< free-chunk
@@ -72,6 +102,38 @@ void writeChunk(Chunk* chunk, uint8_t byte, int line) {
   chunk->count++;
 }
 //< write-chunk
+//> Fused Branches truncate-chunk
+// Drops the bytes past `count`, along with their line information, so the
+// compiler can rewrite code it has just emitted.
+void truncateChunk(Chunk* chunk, int count) {
+  while (chunk->count > count) {
+    chunk->count--;
+    int* run = &chunk->lineData[(chunk->lineCount - 1) * 2];
+    if (--run[0] == 0) chunk->lineCount--;
+  }
+//> Number Locals truncate-number-ranges
+
+  // A range whose end was dropped went with the code it covered
+  int kept = 0;
+  for (int i = 0; i < chunk->numberRangeCount; i++) {
+    if (chunk->numberRanges[i].end < count) {
+      chunk->numberRanges[kept++] = chunk->numberRanges[i];
+    }
+  }
+  chunk->numberRangeCount = kept;
+//< Number Locals truncate-number-ranges
+//> Inlining truncate-inlined-ranges
+
+  kept = 0;
+  for (int i = 0; i < chunk->inlinedRangeCount; i++) {
+    if (chunk->inlinedRanges[i].end <= count) {
+      chunk->inlinedRanges[kept++] = chunk->inlinedRanges[i];
+    }
+  }
+  chunk->inlinedRangeCount = kept;
+//< Inlining truncate-inlined-ranges
+}
+//< Fused Branches truncate-chunk
 //> add-constant
 int addConstant(Chunk* chunk, Value value) {
   push(value);
@@ -104,6 +166,66 @@ void writeConstant(Chunk* chunk, Value value, int line) {
     writeChunk(chunk, constant & 0xff, line);
   }
 }
+//> Inline Caches add-property-cache
+int addPropertyCache(Chunk* chunk) {
+  if (chunk->propertyCacheCapacity < chunk->propertyCacheCount + 1) {
+    int oldCapacity = chunk->propertyCacheCapacity;
+    chunk->propertyCacheCapacity = GROW_CAPACITY(oldCapacity);
+    chunk->propertyCaches = GROW_ARRAY(PropertyCache, chunk->propertyCaches,
+        oldCapacity, chunk->propertyCacheCapacity);
+  }
+
+  PropertyCache* cache = &chunk->propertyCaches[chunk->propertyCacheCount];
+  cache->count = 0;
+  cache->megamorphic = false;
+  return chunk->propertyCacheCount++;
+}
+
+int addCallCache(Chunk* chunk) {
+  if (chunk->callCacheCapacity < chunk->callCacheCount + 1) {
+    int oldCapacity = chunk->callCacheCapacity;
+    chunk->callCacheCapacity = GROW_CAPACITY(oldCapacity);
+    chunk->callCaches = GROW_ARRAY(InlineCache, chunk->callCaches,
+        oldCapacity, chunk->callCacheCapacity);
+  }
+
+  InlineCache* cache = &chunk->callCaches[chunk->callCacheCount];
+  cache->key = NULL;
+  cache->closure = NULL;
+  cache->hitCount = 0;
+  return chunk->callCacheCount++;
+}
+//< Inline Caches add-property-cache
+//> Number Locals add-number-range
+void addNumberRange(Chunk* chunk, int slot, int start, int end) {
+  if (chunk->numberRangeCapacity < chunk->numberRangeCount + 1) {
+    int oldCapacity = chunk->numberRangeCapacity;
+    chunk->numberRangeCapacity = GROW_CAPACITY(oldCapacity);
+    chunk->numberRanges = GROW_ARRAY(NumberRange, chunk->numberRanges,
+        oldCapacity, chunk->numberRangeCapacity);
+  }
+
+  NumberRange* range = &chunk->numberRanges[chunk->numberRangeCount++];
+  range->start = start;
+  range->end = end;
+  range->slot = (uint8_t)slot;
+}
+//< Number Locals add-number-range
+//> Inlining add-inlined-range
+void addInlinedRange(Chunk* chunk, int start, int end, ObjString* name) {
+  if (chunk->inlinedRangeCapacity < chunk->inlinedRangeCount + 1) {
+    int oldCapacity = chunk->inlinedRangeCapacity;
+    chunk->inlinedRangeCapacity = GROW_CAPACITY(oldCapacity);
+    chunk->inlinedRanges = GROW_ARRAY(InlinedRange, chunk->inlinedRanges,
+        oldCapacity, chunk->inlinedRangeCapacity);
+  }
+
+  InlinedRange* range = &chunk->inlinedRanges[chunk->inlinedRangeCount++];
+  range->start = start;
+  range->end = end;
+  range->name = name;
+}
+//< Inlining add-inlined-range
 //> get-line
 int getLine(Chunk* chunk, int instruction) {
   if (instruction < 0 || instruction >= chunk->count) {
@@ -128,3 +250,74 @@ int getLine(Chunk* chunk, int instruction) {
   return -1; // Should never reach here if data is consistent
 }
 //< get-line
+//> Superinstructions instruction-length
+// Size in bytes of the instruction at [offset], including its operands.
+// A superinstruction spans the whole sequence it replaced.
+int instructionLength(Chunk* chunk, int offset) {
+  switch (chunk->code[offset]) {
+    case OP_CONSTANT:
+    case OP_GET_LOCAL:
+    case OP_SET_LOCAL:
+    case OP_GET_UPVALUE:
+    case OP_SET_UPVALUE:
+    case OP_HASH_LITERAL:
+    case OP_ARRAY_LITERAL:
+    case OP_INTERPOLATE:
+    case OP_TYPE_CAST:
+    case OP_GET_STACK:
+    case OP_SET_STACK:
+    case OP_INLINE_RETURN:
+      return 2;
+    case OP_GET_GLOBAL:
+    case OP_DEFINE_GLOBAL:
+    case OP_SET_GLOBAL:
+    case OP_GET_GLOBAL_SLOT:
+    case OP_DEFINE_GLOBAL_SLOT:
+    case OP_SET_GLOBAL_SLOT:
+    case OP_GET_SUPER:
+    case OP_JUMP:
+    case OP_JUMP_IF_FALSE:
+    case OP_LOOP:
+    case OP_CLASS:
+    case OP_MODULE:
+    case OP_MODULE_METHOD:
+    case OP_METHOD:
+    case OP_SET_LOCAL_POP:
+    case OP_JUMP_IF_NOT_LESS_NUMBER:
+    case OP_JUMP_IF_NOT_LESS_EQUAL_NUMBER:
+    case OP_JUMP_IF_NOT_GREATER_NUMBER:
+    case OP_JUMP_IF_NOT_GREATER_EQUAL_NUMBER:
+    case OP_JUMP_IF_NOT_EQUAL_NUMBER:
+      return 3;
+    case OP_CONSTANT_LONG:
+    case OP_CALL:
+    case OP_TAIL_CALL:
+    case OP_SUPER_INVOKE:
+    case OP_GET_LOCAL_GET_LOCAL:
+    case OP_GET_LOCAL_CONSTANT:
+    case OP_SET_GLOBAL_SLOT_POP:
+    case OP_POP_LOOP:
+      return 4;
+    case OP_GET_PROPERTY:
+    case OP_SET_PROPERTY:
+    case OP_ADD_LOCAL_LOCAL:
+    case OP_ADD_LOCAL_CONSTANT:
+    case OP_SUBTRACT_LOCAL_CONSTANT:
+      return 5;
+    case OP_INVOKE:
+    case OP_MODULE_CALL:
+    case OP_INLINE_CALL:
+      return 6;
+    case OP_INLINE_INVOKE:
+      return 10;
+    case OP_CLOSURE: {
+      uint16_t constant = (uint16_t)(chunk->code[offset + 1] << 8) |
+                          chunk->code[offset + 2];
+      ObjFunction* function = AS_FUNCTION(chunk->constants.values[constant]);
+      return 3 + function->upvalueCount * 2;
+    }
+    default:
+      return 1;
+  }
+}
+//< Superinstructions instruction-length
@@ -36,6 +36,11 @@ typedef enum {
 //> Global Variables set-global-op
   OP_SET_GLOBAL,
 //< Global Variables set-global-op
+//> Global Slots global-slot-ops
+  OP_GET_GLOBAL_SLOT,
+  OP_DEFINE_GLOBAL_SLOT,
+  OP_SET_GLOBAL_SLOT,
+//< Global Slots global-slot-ops
 //> Closures upvalue-ops
   OP_GET_UPVALUE,
   OP_SET_UPVALUE,
@@ -49,6 +54,11 @@ typedef enum {
   OP_SET_INDEX,
   OP_HASH_LITERAL,
 //< Hash Objects hash-ops
+//> Arrays array-ops
+  OP_ARRAY_LITERAL,
+  OP_GET_ARRAY_INDEX,
+  OP_SET_ARRAY_INDEX,
+//< Arrays array-ops
 //> Type Casting type-cast-op
   OP_TYPE_CAST,
 //< Type Casting type-cast-op
@@ -130,10 +140,118 @@ typedef enum {
   OP_INHERIT,
 //< Superclasses inherit-op
 //> Methods and Initializers method-op
+/* Methods and Initializers method-op < Superinstructions superinstruction-ops
   OP_METHOD
+*/
+//> Superinstructions superinstruction-ops
+  OP_METHOD,
+  // Fused sequences written over the first opcode of the sequence by the
+  // peephole pass. The operands and opcodes that follow are left in place.
+  OP_GET_LOCAL_GET_LOCAL,     // GET_LOCAL a, GET_LOCAL b
+  OP_GET_LOCAL_CONSTANT,      // GET_LOCAL a, CONSTANT k
+  OP_ADD_LOCAL_LOCAL,         // GET_LOCAL a, GET_LOCAL b, ADD_NUMBER
+  OP_ADD_LOCAL_CONSTANT,      // GET_LOCAL a, CONSTANT k, ADD_NUMBER
+  OP_SUBTRACT_LOCAL_CONSTANT, // GET_LOCAL a, CONSTANT k, SUBTRACT_NUMBER
+  OP_SET_LOCAL_POP,           // SET_LOCAL a, POP
+  OP_SET_GLOBAL_SLOT_POP,     // SET_GLOBAL_SLOT s, POP
+  OP_POP_LOOP,                // POP, LOOP offset
+//< Superinstructions superinstruction-ops
+//> Quickening quickened-ops
+  // Written over a generic OP_ADD, OP_LESS, OP_GREATER or OP_EQUAL once it
+  // has seen its operand types. Each checks that the types still hold and
+  // rewrites itself back to the generic op if not.
+  OP_QUICK_ADD_NUMBER,
+  OP_QUICK_ADD_STRING,
+  OP_QUICK_LESS_NUMBER,
+  OP_QUICK_GREATER_NUMBER,
+  OP_QUICK_EQUAL_NUMBER,
+//< Quickening quickened-ops
+//> Fused Branches compare-jump-ops
+  // Compare two numbers, pop both and jump forward when the comparison is
+  // false. Emitted in place of a comparison plus OP_JUMP_IF_FALSE when both
+  // operands are statically ints.
+  OP_JUMP_IF_NOT_LESS_NUMBER,
+  OP_JUMP_IF_NOT_LESS_EQUAL_NUMBER,
+  OP_JUMP_IF_NOT_GREATER_NUMBER,
+  OP_JUMP_IF_NOT_GREATER_EQUAL_NUMBER,
+  OP_JUMP_IF_NOT_EQUAL_NUMBER,
+//< Fused Branches compare-jump-ops
+//> Tail Calls tail-call-op
+  // OP_CALL in tail position. A closure callee reuses the caller's frame;
+  // any other callee is called normally and the OP_RETURN after it runs.
+  OP_TAIL_CALL,
+//< Tail Calls tail-call-op
+//> Inlining inline-ops
+  // A call compiled in place. Each checks that the callee is still the
+  // function that was inlined, and if not, makes the call as usual and
+  // jumps over the inlined body.
+  OP_INLINE_CALL,    // argCount, function, skip
+  OP_INLINE_INVOKE,  // name, argCount, function, cache, skip
+  // The inlined body reaches the callee's slots by their distance from
+  // the top of the stack, and returns by dropping the callee, arguments
+  // and locals from under its result.
+  OP_GET_STACK,
+  OP_SET_STACK,
+  OP_INLINE_RETURN
+//< Inlining inline-ops
 //< Methods and Initializers method-op
 } OpCode;
 //< op-enum
+//> Inline Caches property-cache
+// Side-table caches for OP_GET_PROPERTY and OP_SET_PROPERTY, indexed by
+// the instruction's cache operand. Each entry answers for one receiver
+// shape; a site that sees more than PROPERTY_CACHE_WAYS shapes goes
+// megamorphic and always takes the table lookup.
+#define PROPERTY_CACHE_WAYS 4
+
+struct ObjShape;
+
+typedef struct {
+  struct ObjShape* shape;       // Receiver shape this entry answers for
+  struct ObjShape* transition;  // Set: shape after adding the field, or NULL
+  Value method;                 // Get: method to bind when slot is -1
+  int slot;
+} PropertyCacheEntry;
+
+typedef struct {
+  PropertyCacheEntry entries[PROPERTY_CACHE_WAYS];
+  uint8_t count;
+  bool megamorphic;
+} PropertyCache;
+//< Inline Caches property-cache
+//> Inline Caches call-cache
+// Monomorphic cache for OP_CALL and OP_INVOKE sites. OP_CALL keys on the
+// callee (a closure, or a class whose initializer runs); OP_INVOKE keys on
+// the receiver's shape. Either way `closure` is the code to run.
+struct ObjClosure;
+
+typedef struct InlineCache {
+  struct Obj* key;
+  struct ObjClosure* closure;
+  uint32_t hitCount;
+} InlineCache;
+//< Inline Caches call-cache
+//> Number Locals number-range
+// Where an uncaptured local the compiler typed as a non-nullable int holds
+// its value: from `start`, where its initializer has just been pushed (0
+// for a parameter), through the instruction at `end` that discards it.
+// The JIT keeps these locals unboxed in registers.
+typedef struct {
+  int start;
+  int end;
+  uint8_t slot;
+} NumberRange;
+//< Number Locals number-range
+//> Inlining inlined-range
+// Code from `start` up to `end` is the body of the function `name`
+// inlined at a call site, so error traces can still show it as a frame.
+// The call itself is the instruction just before `start`.
+typedef struct {
+  int start;
+  int end;
+  ObjString* name;
+} InlinedRange;
+//< Inlining inlined-range
 //> chunk-struct
 
 typedef struct {
@@ -151,6 +269,24 @@ typedef struct {
 //> chunk-constants
   ValueArray constants;
 //< chunk-constants
+//> Inline Caches chunk-property-caches
+  PropertyCache* propertyCaches;
+  int propertyCacheCount;
+  int propertyCacheCapacity;
+  InlineCache* callCaches;
+  int callCacheCount;
+  int callCacheCapacity;
+//< Inline Caches chunk-property-caches
+//> Number Locals chunk-number-ranges
+  NumberRange* numberRanges;
+  int numberRangeCount;
+  int numberRangeCapacity;
+//< Number Locals chunk-number-ranges
+//> Inlining chunk-inlined-ranges
+  InlinedRange* inlinedRanges;
+  int inlinedRangeCount;
+  int inlinedRangeCapacity;
+//< Inlining chunk-inlined-ranges
 } Chunk;
 //< chunk-struct
 //> init-chunk-h
@@ -166,12 +302,28 @@ void writeChunk(Chunk* chunk, uint8_t byte);
 //> write-chunk-with-line-h
 void writeChunk(Chunk* chunk, uint8_t byte, int line);
 //< write-chunk-with-line-h
+//> Fused Branches truncate-chunk-h
+void truncateChunk(Chunk* chunk, int count);
+//< Fused Branches truncate-chunk-h
 //> add-constant-h
 int addConstant(Chunk* chunk, Value value);
 void writeConstant(Chunk* chunk, Value value, int line);
 //< add-constant-h
+//> Inline Caches add-property-cache-h
+int addPropertyCache(Chunk* chunk);
+int addCallCache(Chunk* chunk);
+//< Inline Caches add-property-cache-h
+//> Number Locals add-number-range-h
+void addNumberRange(Chunk* chunk, int slot, int start, int end);
+//< Number Locals add-number-range-h
+//> Inlining add-inlined-range-h
+void addInlinedRange(Chunk* chunk, int start, int end, ObjString* name);
+//< Inlining add-inlined-range-h
 //> get-line-h
 int getLine(Chunk* chunk, int instruction);
 //< get-line-h
+//> Superinstructions instruction-length-h
+int instructionLength(Chunk* chunk, int offset);
+//< Superinstructions instruction-length-h
 
 #endif
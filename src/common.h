@@ -37,6 +37,13 @@
 //< Compiling Expressions define-debug-print-code
 #define DEBUG_TRACE_EXECUTION
 //< A Virtual Machine define-debug-trace
+//> Garbage Collection define-stress-gc
+
+#define DEBUG_STRESS_GC
+//< Garbage Collection define-stress-gc
+//> Garbage Collection define-log-gc
+#define DEBUG_LOG_GC
+//< Garbage Collection define-log-gc
 //> Local Variables uint8-count
 
 #define UINT8_COUNT (UINT8_MAX + 1)
@@ -48,4 +55,6 @@
 // we don't want them to be.
 #undef DEBUG_PRINT_CODE
 #undef DEBUG_TRACE_EXECUTION  // Disabled due to fast stack compatibility issues
+#undef DEBUG_STRESS_GC
+#undef DEBUG_LOG_GC
 //< omit
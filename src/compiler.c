@@ -6,11 +6,26 @@
 //> Local Variables compiler-include-string
 #include <string.h>
 //< Local Variables compiler-include-string
+//> Constant Folding compiler-include-math
+#include <math.h>
+//< Constant Folding compiler-include-math
+//> Inlining compiler-include-limits
+#include <limits.h>
+//< Inlining compiler-include-limits
 
 #include "common.h"
 #include "compiler.h"
 #include "memory.h"
 #include "scanner.h"
+//> Superinstructions compiler-include-peephole
+#include "peephole.h"
+//< Superinstructions compiler-include-peephole
+//> Global Slots compiler-include-vm
+#include "vm.h"
+//< Global Slots compiler-include-vm
+//> Inlining compiler-include-jit
+#include "jit.h"
+//< Inlining compiler-include-jit
 //> Compiling Expressions include-debug
 
 #ifdef DEBUG_PRINT_CODE
@@ -74,6 +89,9 @@ typedef struct {
 //> Variable Type Tracking
   ReturnType type;
 //< Variable Type Tracking
+//> Number Locals local-number-start
+  int numberStart;  // Where the local took its value, or -1
+//< Number Locals local-number-start
 } Local;
 //< Local Variables local-struct
 //> Closures upvalue-struct
@@ -114,6 +132,13 @@ typedef struct Compiler {
   Upvalue upvalues[UINT8_COUNT];
 //< Closures upvalues-array
   int scopeDepth;
+//> Constant Folding dead-code-field
+  bool deadCode;  // Set after a return until the next jump target
+//< Constant Folding dead-code-field
+//> Inlining compiler-fields
+  bool callsItself;  // Recursive functions are never inlined
+  bool inReturn;     // Compiling the value of a return statement
+//< Inlining compiler-fields
 } Compiler;
 //< Local Variables compiler-struct
 //> Methods and Initializers class-compiler-struct
@@ -250,6 +275,10 @@ static MethodTableWithParams globalMethodsWithParams;
 static ModuleFunctionTableWithParams moduleFunctionsWithParams;
 // Global variable to store last compiled function parameters
 static FunctionParams lastCompiledFunctionParams;
+//> Inlining last-inlinable-function
+// The function just compiled if it can be inlined, else NULL.
+static ObjFunction* lastInlinableFunction = NULL;
+//< Inlining last-inlinable-function
 //< Function Parameter Tracking
 
 Parser parser;
@@ -263,6 +292,37 @@ ClassCompiler* currentClass = NULL;
 //> Expression Type Tracking
 static ReturnType lastExpressionType = {RETURN_TYPE_VOID, false, false};
 //< Expression Type Tracking
+//> Fused Branches fusable-compare
+// The most recent comparison of two ints. If a branch condition ends right
+// where it ends, the comparison and the branch become one fused jump.
+typedef struct {
+  Chunk* chunk;
+  int start;     // Offset of the comparison's first opcode.
+  int end;       // Chunk count just past the comparison.
+  uint8_t jump;  // The OP_JUMP_IF_NOT_* that replaces it.
+} FusableCompare;
+
+static FusableCompare lastCompare = {NULL, -1, -1, 0};
+//< Fused Branches fusable-compare
+//> Tail Calls last-call
+// Where the most recent OP_CALL was emitted, so a return statement whose
+// value ends with that call can turn it into OP_TAIL_CALL.
+static Chunk* lastCallChunk = NULL;
+static int lastCallOffset = -1;
+//< Tail Calls last-call
+//> Constant Folding constant-expr
+// The most recent expression that compiled to a single constant load. An
+// operator whose operands all end up here is evaluated at compile time.
+typedef struct {
+  Chunk* chunk;
+  int start;
+  int end;
+  int constant;  // Index in the constant table, or -1 for true/false/nil.
+  Value value;
+} ConstantExpr;
+
+static ConstantExpr lastConstant = {NULL, -1, -1, -1};
+//< Constant Folding constant-expr
 //> Compiling Expressions compiling-chunk
 /* Compiling Expressions compiling-chunk < Calls and Functions current-chunk
 Chunk* compilingChunk;
@@ -359,6 +419,16 @@ static void emitBytes(uint8_t byte1, uint8_t byte2) {
 //< Compiling Expressions emit-bytes
 //> Jumping Back and Forth emit-loop
 static void emitLoop(int loopStart) {
+//> Number Locals loop-number-locals
+  // A local declared in a loop body with no scope of its own is pushed
+  // again each time round, while reads keep going to its first slot. It
+  // stays on the stack so compiled code does the same.
+  for (int i = 0; i < current->localCount; i++) {
+    if (current->locals[i].numberStart > loopStart) {
+      current->locals[i].numberStart = -1;
+    }
+  }
+//< Number Locals loop-number-locals
   emitByte(OP_LOOP);
 
   int offset = currentChunk()->count - loopStart + 2;
@@ -368,6 +438,25 @@ static void emitLoop(int loopStart) {
   emitByte(offset & 0xff);
 }
 //< Jumping Back and Forth emit-loop
+//> Inline Caches emit-property-cache
+// Gives a property instruction its own inline cache slot.
+static void emitPropertyCache() {
+  int cache = addPropertyCache(currentChunk());
+  if (cache > UINT16_MAX) error("Too many property accesses in one function.");
+
+  emitByte((cache >> 8) & 0xff);
+  emitByte(cache & 0xff);
+}
+
+// Gives a call instruction its own call-site cache slot.
+static void emitCallCache() {
+  int cache = addCallCache(currentChunk());
+  if (cache > UINT16_MAX) error("Too many calls in one function.");
+
+  emitByte((cache >> 8) & 0xff);
+  emitByte(cache & 0xff);
+}
+//< Inline Caches emit-property-cache
 //> Jumping Back and Forth emit-jump
 static int emitJump(uint8_t instruction) {
   emitByte(instruction);
@@ -419,8 +508,545 @@ static void patchJump(int offset) {
 
   currentChunk()->code[offset] = (jump >> 8) & 0xff;
   currentChunk()->code[offset + 1] = jump & 0xff;
+//> Fused Branches patch-jump-target
+  // Code that jumps to just past a comparison expects its result on the
+  // stack (as in `a and b < c`), so that comparison can no longer fuse.
+  if (lastCompare.end == currentChunk()->count) lastCompare.end = -1;
+//< Fused Branches patch-jump-target
+//> Constant Folding patch-jump-target
+  // The same goes for a constant, and code that something jumps to can be
+  // reached even if it follows a return.
+  if (lastConstant.end == currentChunk()->count) lastConstant.end = -1;
+  current->deadCode = false;
+//< Constant Folding patch-jump-target
 }
 //< Jumping Back and Forth patch-jump
+//> Fused Branches emit-condition-jump
+// Emits the jump taken when the condition just compiled is false. If that
+// condition was a comparison of two ints, the comparison is rewritten into
+// a fused compare-and-jump which consumes its operands, and `popCondition`
+// is cleared; otherwise the caller pops the condition on both paths.
+static int emitConditionJump(bool* popCondition) {
+  Chunk* chunk = currentChunk();
+  if (lastCompare.chunk == chunk && lastCompare.end == chunk->count) {
+    truncateChunk(chunk, lastCompare.start);
+    lastCompare.end = -1;
+    *popCondition = false;
+    return emitJump(lastCompare.jump);
+  }
+
+  *popCondition = true;
+  return emitJump(OP_JUMP_IF_FALSE);
+}
+//< Fused Branches emit-condition-jump
+//> Constant Folding discard-code
+// Drops the code emitted since `start`, and forgets anything recorded
+// about it.
+static void discardCode(int start) {
+  truncateChunk(currentChunk(), start);
+  if (lastCompare.end > start) lastCompare.end = -1;
+  if (lastCallOffset >= start) lastCallOffset = -1;
+  if (lastConstant.end > start) lastConstant.end = -1;
+//> Number Locals discard-number-start
+  for (int i = 0; i < current->localCount; i++) {
+    if (current->locals[i].numberStart > start) {
+      current->locals[i].numberStart = -1;
+    }
+  }
+//< Number Locals discard-number-start
+}
+
+// Gives back the constant table entry of a discarded load when nothing was
+// added after it.
+static void releaseConstant(int constant) {
+  ValueArray* constants = &currentChunk()->constants;
+  if (constant >= 0 && constant == constants->count - 1) constants->count--;
+}
+
+// Where a branch that may turn out to be dead begins.
+typedef struct {
+  int code;
+  int constants;
+} BranchStart;
+
+static BranchStart markBranch() {
+  Chunk* chunk = currentChunk();
+  return (BranchStart){chunk->count, chunk->constants.count};
+}
+
+// Drops a dead branch along with the constants only it used.
+static void discardBranch(BranchStart start) {
+  discardCode(start.code);
+  currentChunk()->constants.count = start.constants;
+}
+
+// Emits a load of `value` and records it for folding.
+static void emitConstantExpr(Value value) {
+  Chunk* chunk = currentChunk();
+  int start = chunk->count;
+  int constant = -1;
+  if (IS_BOOL(value)) {
+    emitByte(AS_BOOL(value) ? OP_TRUE : OP_FALSE);
+  } else if (IS_NIL(value)) {
+    emitByte(OP_NIL);
+  } else {
+    emitConstant(value);
+    constant = chunk->constants.count - 1;
+  }
+  lastConstant = (ConstantExpr){chunk, start, chunk->count, constant, value};
+}
+
+// Whether the code emitted so far ends with a recorded constant load.
+static bool endsWithConstant(ConstantExpr* expr) {
+  Chunk* chunk = currentChunk();
+  if (lastConstant.chunk != chunk || lastConstant.end != chunk->count) {
+    return false;
+  }
+  *expr = lastConstant;
+  return true;
+}
+
+// Replaces the constant loads from `start` on with a load of `value`.
+static void replaceConstants(int start, ConstantExpr* first,
+                             ConstantExpr* second, Value value) {
+  discardCode(start);
+  if (second != NULL) releaseConstant(second->constant);
+  releaseConstant(first->constant);
+  emitConstantExpr(value);
+}
+
+// Matches isFalsey() in the VM.
+static bool isFalseyConstant(Value value) {
+  return IS_NIL(value) || (IS_BOOL(value) && !AS_BOOL(value));
+}
+//< Constant Folding discard-code
+//> Inlining inline-candidates
+// Functions and methods compiled so far, by name, with the function to
+// compile in place at their call sites, or NULL if the latest definition
+// by that name can't be. A method is found by name alone: the guard at
+// each site checks that the receiver's class really has that method.
+typedef struct {
+  ObjString* className;  // NULL for a global function.
+  ObjString* name;
+  ObjFunction* function;
+} InlineCandidate;
+
+typedef struct {
+  InlineCandidate candidates[UINT8_COUNT];
+  int count;
+} InlineTable;
+
+static InlineTable inlineCandidates;
+
+static void addInlineCandidate(ObjString* className, ObjString* name,
+                               ObjFunction* function) {
+  for (int i = 0; i < inlineCandidates.count; i++) {
+    InlineCandidate* candidate = &inlineCandidates.candidates[i];
+    if (candidate->className == className && candidate->name == name) {
+      candidate->function = function;
+      return;
+    }
+  }
+  if (inlineCandidates.count == UINT8_COUNT) return;
+
+  inlineCandidates.candidates[inlineCandidates.count++] =
+      (InlineCandidate){className, name, function};
+}
+
+static ObjFunction* findInlineFunction(ObjString* name) {
+  for (int i = 0; i < inlineCandidates.count; i++) {
+    InlineCandidate* candidate = &inlineCandidates.candidates[i];
+    if (candidate->className == NULL && candidate->name == name) {
+      return candidate->function;
+    }
+  }
+  return NULL;
+}
+
+// Prefers the method of the receiver's static class. Failing that, a name
+// only one class defines is a safe guess.
+static ObjFunction* findInlineMethod(ObjString* className, ObjString* name) {
+  ObjFunction* found = NULL;
+  int matches = 0;
+  for (int i = 0; i < inlineCandidates.count; i++) {
+    InlineCandidate* candidate = &inlineCandidates.candidates[i];
+    if (candidate->className == NULL || candidate->name != name) continue;
+    if (candidate->className == className) return candidate->function;
+    found = candidate->function;
+    matches++;
+  }
+  return matches == 1 ? found : NULL;
+}
+//< Inlining inline-candidates
+//> Inlining inline-analysis
+#define NOT_INLINABLE INT_MIN
+
+// Quickened instructions go back to their generic form, which quickens
+// again in its new home.
+static uint8_t inlinedOpcode(uint8_t instruction) {
+  switch (instruction) {
+    case OP_QUICK_ADD_NUMBER:
+    case OP_QUICK_ADD_STRING:     return OP_ADD;
+    case OP_QUICK_LESS_NUMBER:    return OP_LESS;
+    case OP_QUICK_GREATER_NUMBER: return OP_GREATER;
+    case OP_QUICK_EQUAL_NUMBER:   return OP_EQUAL;
+    default:                      return unfusedOpcode(instruction);
+  }
+}
+
+// How an instruction that can be inlined changes the stack depth when it
+// falls through, or NOT_INLINABLE. Anything that reaches the callee's
+// frame other than through its slots is left out.
+static int inlineStackEffect(uint8_t* code) {
+  switch (inlinedOpcode(code[0])) {
+    case OP_CONSTANT:
+    case OP_CONSTANT_LONG:
+    case OP_NIL:
+    case OP_TRUE:
+    case OP_FALSE:
+    case OP_GET_LOCAL:
+    case OP_GET_GLOBAL:
+    case OP_GET_GLOBAL_SLOT:
+    case OP_GET_STACK:
+      return 1;
+    case OP_SET_LOCAL:
+    case OP_SET_GLOBAL:
+    case OP_SET_GLOBAL_SLOT:
+    case OP_SET_STACK:
+    case OP_GET_PROPERTY:
+    case OP_TYPE_CAST:
+    case OP_NOT:
+    case OP_NEGATE:
+    case OP_NEGATE_NUMBER:
+    case OP_JUMP_IF_FALSE:
+    case OP_INLINE_CALL:
+    case OP_INLINE_INVOKE:
+      return 0;
+    case OP_POP:
+    case OP_PRINT:
+    case OP_SET_PROPERTY:
+    case OP_EQUAL:
+    case OP_GREATER:
+    case OP_LESS:
+    case OP_ADD:
+    case OP_ADD_NUMBER:
+    case OP_ADD_STRING:
+    case OP_SUBTRACT:
+    case OP_SUBTRACT_NUMBER:
+    case OP_MULTIPLY:
+    case OP_MULTIPLY_NUMBER:
+    case OP_DIVIDE:
+    case OP_DIVIDE_NUMBER:
+    case OP_MODULO:
+    case OP_MODULO_NUMBER:
+      return -1;
+    case OP_JUMP_IF_NOT_LESS_NUMBER:
+    case OP_JUMP_IF_NOT_LESS_EQUAL_NUMBER:
+    case OP_JUMP_IF_NOT_GREATER_NUMBER:
+    case OP_JUMP_IF_NOT_GREATER_EQUAL_NUMBER:
+    case OP_JUMP_IF_NOT_EQUAL_NUMBER:
+      return -2;
+    case OP_CALL:
+    case OP_TAIL_CALL:
+      return -code[1];
+    case OP_INVOKE:
+      return -code[3];
+    case OP_INLINE_RETURN:
+      return -code[1];
+    default:
+      return NOT_INLINABLE;
+  }
+}
+
+// Where a forward jump at `offset` lands, or -1 if it isn't one. An
+// inlined call's skip lands where the call's result is on the stack.
+static int inlineJumpTarget(uint8_t* code, int offset, int* argCount) {
+  int operand;
+  *argCount = 0;
+  switch (inlinedOpcode(code[offset])) {
+    case OP_JUMP:
+    case OP_JUMP_IF_FALSE:
+    case OP_JUMP_IF_NOT_LESS_NUMBER:
+    case OP_JUMP_IF_NOT_LESS_EQUAL_NUMBER:
+    case OP_JUMP_IF_NOT_GREATER_NUMBER:
+    case OP_JUMP_IF_NOT_GREATER_EQUAL_NUMBER:
+    case OP_JUMP_IF_NOT_EQUAL_NUMBER:
+      operand = offset + 1;
+      break;
+    case OP_INLINE_CALL:
+      *argCount = code[offset + 1];
+      operand = offset + 4;
+      break;
+    case OP_INLINE_INVOKE:
+      *argCount = code[offset + 3];
+      operand = offset + 8;
+      break;
+    default:
+      return -1;
+  }
+  return operand + 2 + ((code[operand] << 8) | code[operand + 1]);
+}
+
+// Works out the stack depth before each instruction of `function`,
+// counting the callee and its arguments, or -1 where no path reaches.
+// Returns false if the function can't be compiled in place: it is too
+// big, captures or is captured, loops, or uses an instruction the inliner
+// doesn't handle.
+static bool inlineDepths(ObjFunction* function, int* depths) {
+  Chunk* chunk = &function->chunk;
+  if (function->upvalueCount != 0 || chunk->count > JIT_MAX_INLINE_SIZE) {
+    return false;
+  }
+
+  for (int i = 0; i < chunk->count; i++) depths[i] = -1;
+  depths[0] = function->arity + 1;
+
+  int depth = depths[0];
+  for (int offset = 0; offset < chunk->count;
+       offset += unfusedLength(chunk, offset)) {
+    if (depth == -1) {
+      depth = depths[offset];
+    } else if (depths[offset] != -1 && depths[offset] != depth) {
+      return false;
+    }
+    depths[offset] = depth;
+    if (depth == -1) continue;
+
+    uint8_t* code = chunk->code;
+    uint8_t instruction = inlinedOpcode(code[offset]);
+    if (instruction == OP_RETURN) {
+      if (depth - 1 > UINT8_MAX) return false;
+      depth = -1;
+      continue;
+    }
+    if ((instruction == OP_GET_LOCAL || instruction == OP_SET_LOCAL) &&
+        (code[offset + 1] >= depth || depth > UINT8_MAX)) {
+      return false;
+    }
+
+    int argCount;
+    int target = inlineJumpTarget(code, offset, &argCount);
+    if (target != -1) {
+      if (target <= offset || target >= chunk->count) return false;
+      int targetDepth = depth - argCount;
+      if (instruction >= OP_JUMP_IF_NOT_LESS_NUMBER &&
+          instruction <= OP_JUMP_IF_NOT_EQUAL_NUMBER) {
+        targetDepth -= 2;
+      }
+      if (depths[target] != -1 && depths[target] != targetDepth) return false;
+      depths[target] = targetDepth;
+      if (instruction == OP_JUMP) {
+        depth = -1;
+        continue;
+      }
+    }
+
+    int effect = inlineStackEffect(code + offset);
+    if (effect == NOT_INLINABLE) return false;
+    depth += effect;
+  }
+
+  // The implicit return ends every function, so nothing falls off the end.
+  return depth == -1;
+}
+//< Inlining inline-analysis
+//> Inlining inline-body
+typedef struct {
+  int operand;  // Where the jump's offset goes in the caller's code.
+  int target;   // What it jumps to in the callee's code.
+} InlineJump;
+
+static void emitShort(uint16_t value) {
+  emitByte((value >> 8) & 0xff);
+  emitByte(value & 0xff);
+}
+
+static uint16_t readShort(uint8_t* code) {
+  return (uint16_t)((code[0] << 8) | code[1]);
+}
+
+// Copies the callee's code to the end of the current chunk. Its slots are
+// reached relative to the top of the stack, each return hands its value
+// back in place of the callee and arguments, and constants and caches are
+// the caller's own. Lines stay the callee's, and the body is recorded as
+// an inlined range so error traces still name the callee.
+static void emitInlinedBody(ObjFunction* function, int* depths) {
+  Chunk* callee = &function->chunk;
+  int start = currentChunk()->count;
+  int offsets[JIT_MAX_INLINE_SIZE];
+  InlineJump jumps[JIT_MAX_INLINE_SIZE];
+  int jumpCount = 0;
+
+  int last = 0;
+  for (int offset = 0; offset < callee->count;
+       offset += unfusedLength(callee, offset)) {
+    if (depths[offset] != -1) last = offset;
+  }
+
+  int callLine = parser.previous.line;
+  for (int offset = 0; offset < callee->count;
+       offset += unfusedLength(callee, offset)) {
+    offsets[offset] = currentChunk()->count;
+    int depth = depths[offset];
+    if (depth == -1) continue;
+
+    parser.previous.line = getLine(callee, offset);
+    uint8_t* code = callee->code + offset;
+    uint8_t instruction = inlinedOpcode(code[0]);
+    switch (instruction) {
+      case OP_CONSTANT:
+        emitConstant(callee->constants.values[code[1]]);
+        break;
+      case OP_CONSTANT_LONG:
+        emitConstant(callee->constants.values[
+            (code[1] << 16) | (code[2] << 8) | code[3]]);
+        break;
+      case OP_GET_LOCAL:
+        emitBytes(OP_GET_STACK, depth - 1 - code[1]);
+        break;
+      case OP_SET_LOCAL:
+        emitBytes(OP_SET_STACK, depth - 1 - code[1]);
+        break;
+      case OP_GET_GLOBAL:
+      case OP_SET_GLOBAL:
+        emitByte(instruction);
+        emitShort(makeConstant(callee->constants.values[readShort(code + 1)]));
+        break;
+      case OP_GET_PROPERTY:
+      case OP_SET_PROPERTY:
+        emitByte(instruction);
+        emitShort(makeConstant(callee->constants.values[readShort(code + 1)]));
+        emitPropertyCache();
+        break;
+      case OP_CALL:
+      case OP_TAIL_CALL:
+        // The caller's frame is not the callee's to reuse.
+        emitBytes(OP_CALL, code[1]);
+        emitCallCache();
+        break;
+      case OP_INVOKE:
+        emitByte(OP_INVOKE);
+        emitShort(makeConstant(callee->constants.values[readShort(code + 1)]));
+        emitByte(code[3]);
+        emitCallCache();
+        break;
+      case OP_INLINE_CALL:
+        emitBytes(OP_INLINE_CALL, code[1]);
+        emitShort(makeConstant(callee->constants.values[readShort(code + 2)]));
+        emitShort(0xffff);
+        jumps[jumpCount++] = (InlineJump){currentChunk()->count - 2,
+                                          offset + 6 + readShort(code + 4)};
+        break;
+      case OP_INLINE_INVOKE:
+        emitByte(OP_INLINE_INVOKE);
+        emitShort(makeConstant(callee->constants.values[readShort(code + 1)]));
+        emitByte(code[3]);
+        emitShort(makeConstant(callee->constants.values[readShort(code + 4)]));
+        emitCallCache();
+        emitShort(0xffff);
+        jumps[jumpCount++] = (InlineJump){currentChunk()->count - 2,
+                                          offset + 10 + readShort(code + 8)};
+        break;
+      case OP_RETURN:
+        emitBytes(OP_INLINE_RETURN, depth - 1);
+        if (offset != last) {
+          // -1 stands for the end of the inlined body.
+          emitByte(OP_JUMP);
+          emitShort(0xffff);
+          jumps[jumpCount++] = (InlineJump){currentChunk()->count - 2, -1};
+        }
+        break;
+      case OP_JUMP:
+      case OP_JUMP_IF_FALSE:
+      case OP_JUMP_IF_NOT_LESS_NUMBER:
+      case OP_JUMP_IF_NOT_LESS_EQUAL_NUMBER:
+      case OP_JUMP_IF_NOT_GREATER_NUMBER:
+      case OP_JUMP_IF_NOT_GREATER_EQUAL_NUMBER:
+      case OP_JUMP_IF_NOT_EQUAL_NUMBER:
+        emitByte(instruction);
+        emitShort(0xffff);
+        jumps[jumpCount++] = (InlineJump){currentChunk()->count - 2,
+                                          offset + 3 + readShort(code + 1)};
+        break;
+      default:
+        // Everything else has no operands or ones that mean the same here:
+        // global slots, stack distances and type tags.
+        emitByte(instruction);
+        for (int i = 1; i < unfusedLength(callee, offset); i++) {
+          emitByte(code[i]);
+        }
+        break;
+    }
+  }
+  parser.previous.line = callLine;
+
+  Chunk* chunk = currentChunk();
+  for (int i = 0; i < jumpCount; i++) {
+    int target = jumps[i].target == -1 ? chunk->count
+                                       : offsets[jumps[i].target];
+    int jump = target - jumps[i].operand - 2;
+    chunk->code[jumps[i].operand] = (jump >> 8) & 0xff;
+    chunk->code[jumps[i].operand + 1] = jump & 0xff;
+  }
+
+  // Calls the callee had inlined itself come along with its code.
+  for (int i = 0; i < callee->inlinedRangeCount; i++) {
+    InlinedRange* range = &callee->inlinedRanges[i];
+    int end = range->end < callee->count ? offsets[range->end]
+                                         : chunk->count;
+    addInlinedRange(chunk, offsets[range->start], end, range->name);
+  }
+  addInlinedRange(chunk, start, chunk->count, function->name);
+
+  if (chunk->count - start > UINT16_MAX) error("Too much code to inline.");
+}
+//< Inlining inline-body
+//> Inlining inline-call
+// Compiles a call to a known function in place. The callee and arguments
+// are already on the stack, and OP_INLINE_CALL checks that the callee is
+// still that function before running the inlined body.
+static bool inlineCall(ObjString* name, int argCount) {
+  if (name == NULL) return false;
+  ObjFunction* function = findInlineFunction(name);
+  int depths[JIT_MAX_INLINE_SIZE];
+  if (function == NULL || function->arity != argCount ||
+      !inlineDepths(function, depths)) {
+    return false;
+  }
+
+  emitBytes(OP_INLINE_CALL, argCount);
+  emitShort(makeConstant(OBJ_VAL(function)));
+  emitShort(0xffff);
+  int skip = currentChunk()->count - 2;
+  emitInlinedBody(function, depths);
+  patchJump(skip);
+  return true;
+}
+
+// The same for a method, where OP_INLINE_INVOKE checks that the receiver's
+// class has this method.
+static bool inlineInvoke(ObjString* className, uint16_t name,
+                         int argCount) {
+  ObjString* methodName = AS_STRING(currentChunk()->constants.values[name]);
+  ObjFunction* function = findInlineMethod(className, methodName);
+  int depths[JIT_MAX_INLINE_SIZE];
+  if (function == NULL || function->arity != argCount ||
+      !inlineDepths(function, depths)) {
+    return false;
+  }
+
+  emitByte(OP_INLINE_INVOKE);
+  emitShort(name);
+  emitByte(argCount);
+  emitShort(makeConstant(OBJ_VAL(function)));
+  emitCallCache();
+  emitShort(0xffff);
+  int skip = currentChunk()->count - 2;
+  emitInlinedBody(function, depths);
+  patchJump(skip);
+  return true;
+}
+//< Inlining inline-call
 //> Local Variables init-compiler
 /* Local Variables init-compiler < Calls and Functions init-compiler
 static void initCompiler(Compiler* compiler) {
@@ -435,10 +1061,23 @@ static void initCompiler(Compiler* compiler, FunctionType type) {
 //< Calls and Functions init-compiler
   compiler->localCount = 0;
   compiler->scopeDepth = 0;
+//> Constant Folding init-dead-code
+  compiler->deadCode = false;
+//< Constant Folding init-dead-code
+//> Inlining init-calls-itself
+  compiler->callsItself = false;
+  compiler->inReturn = false;
+//< Inlining init-calls-itself
 //> Calls and Functions init-function
   compiler->function = newFunction();
 //< Calls and Functions init-function
   current = compiler;
+//> Fused Branches init-compiler
+  lastCompare.end = -1;
+//< Fused Branches init-compiler
+//> Constant Folding init-compiler
+  lastConstant.end = -1;
+//< Constant Folding init-compiler
 //> Calls and Functions init-function-name
   if (type != TYPE_SCRIPT) {
     current->function->name = copyString(parser.previous.start,
@@ -452,6 +1091,9 @@ static void initCompiler(Compiler* compiler, FunctionType type) {
 //> Closures init-zero-local-is-captured
   local->isCaptured = false;
 //< Closures init-zero-local-is-captured
+//> Number Locals init-zero-local-number-start
+  local->numberStart = -1;
+//< Number Locals init-zero-local-number-start
 //> Methods and Initializers slot-zero
   if (type != TYPE_FUNCTION) {
     local->name.start = "this";
@@ -471,6 +1113,21 @@ static void initCompiler(Compiler* compiler, FunctionType type) {
 //< Calls and Functions init-function-slot
 }
 //< Local Variables init-compiler
+//> Number Locals record-number-local
+static bool isNumberType(ReturnType type);
+
+// Tells the JIT where the local in `slot` held a number, now that the
+// instruction at `end` discards it. A captured local is left out, since a
+// closure may read it from the stack at any point.
+static void recordNumberLocal(int slot, int end) {
+  Local* local = &current->locals[slot];
+  if (local->numberStart < 0 || local->isCaptured ||
+      !isNumberType(local->type)) {
+    return;
+  }
+  addNumberRange(currentChunk(), slot, local->numberStart, end);
+}
+//< Number Locals record-number-local
 //> Compiling Expressions end-compiler
 /* Compiling Expressions end-compiler < Calls and Functions end-compiler
 static void endCompiler() {
@@ -479,10 +1136,19 @@ static void endCompiler() {
 static ObjFunction* endCompiler() {
 //< Calls and Functions end-compiler
   emitReturn();
+//> Number Locals end-compiler-number-locals
+  // The function's own locals last until it returns
+  for (int i = 1; i < current->localCount; i++) {
+    recordNumberLocal(i, currentChunk()->count);
+  }
+//< Number Locals end-compiler-number-locals
 //> Calls and Functions end-function
   ObjFunction* function = current->function;
 
 //< Calls and Functions end-function
+//> Superinstructions end-compiler-fuse
+  if (!parser.hadError) fuseSuperinstructions(&function->chunk);
+//< Superinstructions end-compiler-fuse
 //> dump-chunk
 #ifdef DEBUG_PRINT_CODE
   if (!parser.hadError) {
@@ -501,6 +1167,11 @@ static ObjFunction* endCompiler() {
 //> restore-enclosing
   current = current->enclosing;
 //< restore-enclosing
+//> Generational GC end-compiler-barrier
+  // The compiler fills in functions without write barriers. Once the
+  // function stops being a compiler root, an old one must be rescanned.
+  if (function->obj.isMarked) rememberObject((Obj*)function);
+//< Generational GC end-compiler-barrier
   return function;
 //< Calls and Functions return-function
 }
@@ -530,6 +1201,9 @@ static void endScope() {
 /* Local Variables pop-locals < Closures end-scope
     emitByte(OP_POP);
 */
+//> Number Locals end-scope-number-local
+    recordNumberLocal(current->localCount - 1, currentChunk()->count);
+//< Number Locals end-scope-number-local
 //> Closures end-scope
     if (current->locals[current->localCount - 1].isCaptured) {
       emitByte(OP_CLOSE_UPVALUE);
@@ -557,6 +1231,7 @@ static void interpolatedString(bool canAssign);
 static void typedVarDeclaration();
 static void mutVarDeclaration();
 static void consumeStatementTerminator(const char* message);
+static bool checkStatementEnd();
 static void typeCast(bool canAssign);
 //< Global Variables forward-declarations
 
@@ -703,6 +1378,9 @@ static void addLocal(Token name, ReturnType type) {
 //> Variable Type Storage
   local->type = type;
 //< Variable Type Storage
+//> Number Locals add-local-number-start
+  local->numberStart = -1;
+//< Number Locals add-local-number-start
 }
 //< Local Variables add-local
 //> Local Variables declare-variable
@@ -766,8 +1444,24 @@ static void markInitialized() {
 //< Calls and Functions check-depth
   current->locals[current->localCount - 1].depth =
       current->scopeDepth;
+//> Number Locals mark-number-start
+  current->locals[current->localCount - 1].numberStart =
+      currentChunk()->count;
+//< Number Locals mark-number-start
 }
 //< Local Variables mark-initialized
+//> Global Slots global-slot-index
+// Globals are stored in one array on the VM. The compiler resolves each
+// name to its index there so the VM never hashes a name at runtime.
+static uint16_t globalSlotIndex(ObjString* name) {
+  int slot = globalSlot(name);
+  if (slot > UINT16_MAX) {
+    error("Too many global variables.");
+    return 0;
+  }
+  return (uint16_t)slot;
+}
+//< Global Slots global-slot-index
 //> Global Variables define-variable
 static void defineVariable(uint16_t global) {
 //> Local Variables define-variable
@@ -779,9 +1473,18 @@ static void defineVariable(uint16_t global) {
   }
 
 //< Local Variables define-variable
+/* Global Variables define-variable < Global Slots define-global-slot
   emitByte(OP_DEFINE_GLOBAL);
   emitByte((global >> 8) & 0xff);  // High byte
   emitByte(global & 0xff);         // Low byte
+*/
+//> Global Slots define-global-slot
+  ObjString* name = AS_STRING(currentChunk()->constants.values[global]);
+  uint16_t slot = globalSlotIndex(name);
+  emitByte(OP_DEFINE_GLOBAL_SLOT);
+  emitByte((slot >> 8) & 0xff);  // High byte
+  emitByte(slot & 0xff);         // Low byte
+//< Global Slots define-global-slot
 }
 //< Global Variables define-variable
 //> Calls and Functions argument-list
@@ -804,6 +1507,25 @@ static uint8_t argumentList() {
 //< Calls and Functions argument-list
 //> Jumping Back and Forth and
 static void and_(bool canAssign) {
+//> Constant Folding and-constant
+  ConstantExpr left;
+  if (endsWithConstant(&left)) {
+    if (isFalseyConstant(left.value)) {
+      // The right operand is never evaluated.
+      BranchStart right = markBranch();
+      parsePrecedence(PREC_AND);
+      discardBranch(right);
+      lastConstant = left;
+    } else {
+      discardCode(left.start);
+      releaseConstant(left.constant);
+      parsePrecedence(PREC_AND);
+    }
+    lastExpressionType = TYPE_BOOL;
+    return;
+  }
+
+//< Constant Folding and-constant
   int endJump = emitJump(OP_JUMP_IF_FALSE);
 
   emitByte(OP_POP);
@@ -814,8 +1536,46 @@ static void and_(bool canAssign) {
 }
 //< Jumping Back and Forth and
 //> Ternary conditional
+//> Constant Folding constant-ternary
+// A ternary whose condition is known compiles only the branch it takes.
+static void constantTernary(bool taken) {
+  BranchStart trueBranch = markBranch();
+  parsePrecedence(PREC_TERNARY + 1);
+  ReturnType trueType = lastExpressionType;
+  if (!taken) discardBranch(trueBranch);
+
+  ConstantExpr trueValue;
+  bool trueConstant = taken && endsWithConstant(&trueValue);
+
+  consume(TOKEN_COLON, "Expect ':' after true expression in ternary conditional.");
+
+  BranchStart falseBranch = markBranch();
+  parsePrecedence(PREC_TERNARY + 1);
+  ReturnType falseType = lastExpressionType;
+  if (taken) {
+    discardBranch(falseBranch);
+    if (trueConstant) lastConstant = trueValue;
+  }
+
+  if (typesEqual(trueType, falseType)) {
+    lastExpressionType = trueType;
+  } else {
+    lastExpressionType = TYPE_VOID;
+  }
+}
+//< Constant Folding constant-ternary
+
 static void ternary(bool canAssign) {
   // At this point, the condition has been evaluated and is on the stack
+//> Constant Folding ternary-condition
+  ConstantExpr condition;
+  if (endsWithConstant(&condition)) {
+    discardCode(condition.start);
+    releaseConstant(condition.constant);
+    constantTernary(!isFalseyConstant(condition.value));
+    return;
+  }
+//< Constant Folding ternary-condition
   
   // Jump to false branch if condition is false
   int elseJump = emitJump(OP_JUMP_IF_FALSE);
@@ -854,18 +1614,92 @@ static void ternary(bool canAssign) {
 /* Compiling Expressions binary < Global Variables binary
 static void binary() {
 */
+//> Quickening is-number-type
+// Only a non-nullable int is certain to be a number at runtime.
+static bool isNumberType(ReturnType type) {
+  return type.baseType == RETURN_TYPE_INT && !type.isNullable;
+}
+//< Quickening is-number-type
+//> Fused Branches compare-jump
+// The fused jump for a comparison, taken when the comparison is false.
+static uint8_t compareJump(TokenType operatorType) {
+  switch (operatorType) {
+    case TOKEN_EQUAL_EQUAL:   return OP_JUMP_IF_NOT_EQUAL_NUMBER;
+    case TOKEN_GREATER:       return OP_JUMP_IF_NOT_GREATER_NUMBER;
+    case TOKEN_GREATER_EQUAL: return OP_JUMP_IF_NOT_GREATER_EQUAL_NUMBER;
+    case TOKEN_LESS:          return OP_JUMP_IF_NOT_LESS_NUMBER;
+    case TOKEN_LESS_EQUAL:    return OP_JUMP_IF_NOT_LESS_EQUAL_NUMBER;
+    default:                  return OP_JUMP_IF_FALSE;
+  }
+}
+//< Fused Branches compare-jump
+//> Constant Folding fold-binary
+// Evaluates a binary operator on two constants the way the VM would.
+// Returns false when it can't, or when the VM would raise an error.
+static bool foldBinary(TokenType operatorType, Value a, Value b,
+                       Value* result) {
+  switch (operatorType) {
+    case TOKEN_EQUAL_EQUAL: *result = BOOL_VAL(valuesEqual(a, b)); return true;
+    case TOKEN_BANG_EQUAL:  *result = BOOL_VAL(!valuesEqual(a, b)); return true;
+    default: break;
+  }
+
+  if (operatorType == TOKEN_PLUS && IS_STRING(a) && IS_STRING(b)) {
+    ObjString* left = AS_STRING(a);
+    ObjString* right = AS_STRING(b);
+    int length = left->length + right->length;
+    char* chars = ALLOCATE(char, length + 1);
+    memcpy(chars, AS_CSTRING(a), left->length);
+    memcpy(chars + left->length, AS_CSTRING(b), right->length);
+    chars[length] = '\0';
+    *result = OBJ_VAL(takeString(chars, length));
+    return true;
+  }
+
+  if (!IS_NUMBER(a) || !IS_NUMBER(b)) return false;
+  double x = AS_NUMBER(a);
+  double y = AS_NUMBER(b);
+  switch (operatorType) {
+    case TOKEN_PLUS:          *result = NUMBER_VAL(x + y); return true;
+    case TOKEN_MINUS:         *result = NUMBER_VAL(x - y); return true;
+    case TOKEN_STAR:          *result = NUMBER_VAL(x * y); return true;
+    case TOKEN_SLASH:         *result = NUMBER_VAL(x / y); return true;
+    case TOKEN_PERCENT:
+      if (y == 0.0) return false; // "Modulo by zero." at runtime.
+      *result = NUMBER_VAL(fmod(x, y));
+      return true;
+    case TOKEN_GREATER:       *result = BOOL_VAL(x > y); return true;
+    case TOKEN_GREATER_EQUAL: *result = BOOL_VAL(x >= y); return true;
+    case TOKEN_LESS:          *result = BOOL_VAL(x < y); return true;
+    case TOKEN_LESS_EQUAL:    *result = BOOL_VAL(x <= y); return true;
+    default:                  return false;
+  }
+}
+//< Constant Folding fold-binary
 //> Global Variables binary
 static void binary(bool canAssign) {
   TokenType operatorType = parser.previous.type;
 
   // Remember the left operand type before parsing the right operand
   ReturnType leftType = lastExpressionType;
+//> Constant Folding binary-operands
+  ConstantExpr left = {0};
+  bool leftConstant = endsWithConstant(&left);
+//< Constant Folding binary-operands
   
   ParseRule* rule = getRule(operatorType);
   parsePrecedence((Precedence)(rule->precedence + 1));
+//> Constant Folding binary-operands
+  ConstantExpr right = {0};
+  bool constantOperands = leftConstant && endsWithConstant(&right) &&
+                          right.start == left.end;
+//< Constant Folding binary-operands
   
   // Now we have both operand types - left and right
   ReturnType rightType = lastExpressionType;
+//> Fused Branches compare-start
+  int compareStart = currentChunk()->count;
+//< Fused Branches compare-start
 
   switch (operatorType) {
     case TOKEN_BANG_EQUAL: emitBytes(OP_EQUAL, OP_NOT); lastExpressionType = TYPE_BOOL; break;
@@ -879,10 +1713,24 @@ static void binary(bool canAssign) {
       if (typeEqualsBase(leftType, TYPE_STRING.baseType) || typeEqualsBase(rightType, TYPE_STRING.baseType)) {
         emitByte(OP_ADD_STRING);
         lastExpressionType = TYPE_STRING;
+/* Compiling Expressions binary < Quickening generic-add
       } else {
         emitByte(OP_ADD_NUMBER);
         lastExpressionType = TYPE_INT;
       }
+*/
+//> Quickening generic-add
+      } else if (isNumberType(leftType) && isNumberType(rightType)) {
+        emitByte(OP_ADD_NUMBER);
+        lastExpressionType = TYPE_INT;
+      } else {
+        // The VM rewrites this to a typed add once it sees the operands.
+        // Neither side is known to be a string, so the result is typed as
+        // a number like before and the runtime checks the real operands.
+        emitByte(OP_ADD);
+        lastExpressionType = TYPE_INT;
+      }
+//< Quickening generic-add
       break;
     case TOKEN_MINUS:         
       emitByte(OP_SUBTRACT_NUMBER); 
@@ -902,6 +1750,25 @@ static void binary(bool canAssign) {
       break;
     default: return; // Unreachable.
   }
+//> Constant Folding fold-binary-operands
+
+  // The operator was emitted above only to settle the result type.
+  Value folded;
+  if (constantOperands &&
+      foldBinary(operatorType, left.value, right.value, &folded)) {
+    replaceConstants(left.start, &left, &right, folded);
+    return;
+  }
+//< Constant Folding fold-binary-operands
+//> Fused Branches record-compare
+
+  uint8_t fusedJump = compareJump(operatorType);
+  if (fusedJump != OP_JUMP_IF_FALSE &&
+      isNumberType(leftType) && isNumberType(rightType)) {
+    lastCompare = (FusableCompare){currentChunk(), compareStart,
+                                   currentChunk()->count, fusedJump};
+  }
+//< Fused Branches record-compare
 }
 //< Compiling Expressions binary
 //> Calls and Functions compile-call
@@ -924,7 +1791,26 @@ static void call(bool canAssign) {
     argCount = argumentList();
   }
   
+/* Calls and Functions compile-call < Inlining inline-call
+  lastCallChunk = currentChunk();
+  lastCallOffset = currentChunk()->count;
   emitBytes(OP_CALL, argCount);
+  emitCallCache();
+*/
+//> Inlining inline-call
+  if (calledIdentifier != NULL && calledIdentifier == current->function->name) {
+    current->callsItself = true;
+  }
+  // A call that ends a return statement's value stays a call, so the
+  // return can turn it into a tail call.
+  bool tailPosition = current->inReturn && checkStatementEnd();
+  if (tailPosition || !inlineCall(calledIdentifier, argCount)) {
+    lastCallChunk = currentChunk();
+    lastCallOffset = currentChunk()->count;
+    emitBytes(OP_CALL, argCount);
+    emitCallCache();
+  }
+//< Inlining inline-call
   
   // Determine the return type based on what was called
   if (calledIdentifier != NULL) {
@@ -949,6 +1835,9 @@ static void call(bool canAssign) {
 //< Calls and Functions compile-call
 //> Classes and Instances compile-dot
 static void dot(bool canAssign) {
+//> Arrays dot-receiver-type
+  ReturnType receiverType = lastExpressionType;
+//< Arrays dot-receiver-type
   consume(TOKEN_IDENTIFIER, "Expect property name after '.'.");
   uint16_t name = identifierConstant(&parser.previous);
 //> Track Property Name for Type Inference
@@ -970,6 +1859,9 @@ static void dot(bool canAssign) {
     emitByte(OP_SET_PROPERTY);
     emitByte((name >> 8) & 0xff);  // High byte
     emitByte(name & 0xff);         // Low byte
+//> Inline Caches set-property-cache
+    emitPropertyCache();
+//< Inline Caches set-property-cache
 //> Methods and Initializers parse-call
   } else if (match(TOKEN_LEFT_PAREN)) {
     // Save the identifier before parsing arguments (like call() function does)
@@ -988,6 +1880,9 @@ static void dot(bool canAssign) {
         emitByte((name >> 8) & 0xff);  // High byte
         emitByte(name & 0xff);         // Low byte
         emitByte(argCount);
+//> Module Slots module-call-cache
+        emitCallCache();
+//< Module Slots module-call-cache
         
         // Use proper module function signature lookup instead of hardcoded nonsense
         ObjString* methodNameString = copyString(propertyName.start, propertyName.length);
@@ -997,11 +1892,39 @@ static void dot(bool canAssign) {
       }
     }
     
+/* Methods and Initializers parse-call < Inlining inline-invoke
     emitByte(OP_INVOKE);
     emitByte((name >> 8) & 0xff);  // High byte
     emitByte(name & 0xff);         // Low byte
     emitByte(argCount);
+    emitCallCache();
+*/
+//> Inlining inline-invoke
+    if (AS_STRING(currentChunk()->constants.values[name]) ==
+        current->function->name) {
+      current->callsItself = true;
+    }
+    if (!inlineInvoke(receiverType.className, name, argCount)) {
+      emitByte(OP_INVOKE);
+      emitByte((name >> 8) & 0xff);  // High byte
+      emitByte(name & 0xff);         // Low byte
+      emitByte(argCount);
+      emitCallCache();
+    }
+//< Inlining inline-invoke
     
+//> Arrays array-method-types
+    // push() and len() on an array both answer the element count; pop()
+    // hands back an element whose type is not tracked.
+    if (receiverType.baseType == RETURN_TYPE_ARRAY) {
+      bool answersCount =
+          (propertyName.length == 4 && memcmp(propertyName.start, "push", 4) == 0) ||
+          (propertyName.length == 3 && memcmp(propertyName.start, "len", 3) == 0);
+      lastExpressionType = answersCount ? TYPE_INT : TYPE_VOID;
+      return;
+    }
+//< Arrays array-method-types
+
     // Infer method return type using the method table
     ObjString* methodNameString = copyString(propertyName.start, propertyName.length);
     if (currentClass != NULL) {
@@ -1033,6 +1956,9 @@ static void dot(bool canAssign) {
     emitByte(OP_GET_PROPERTY);
     emitByte((name >> 8) & 0xff);  // High byte
     emitByte(name & 0xff);         // Low byte
+//> Inline Caches get-property-cache
+    emitPropertyCache();
+//< Inline Caches get-property-cache
     
     // Look up field type if we're accessing a field
     if (currentClass != NULL) {
@@ -1054,15 +1980,30 @@ static void literal(bool canAssign) {
 //< Global Variables parse-literal
   switch (parser.previous.type) {
     case TOKEN_FALSE: 
+/* Types of Values parse-literal < Constant Folding literal-constants
       emitByte(OP_FALSE); 
+*/
+//> Constant Folding literal-constants
+      emitConstantExpr(BOOL_VAL(false));
+//< Constant Folding literal-constants
       lastExpressionType = TYPE_BOOL;
       break;
     case TOKEN_NIL: 
+/* Types of Values parse-literal < Constant Folding literal-constants
       emitByte(OP_NIL); 
+*/
+//> Constant Folding literal-constants
+      emitConstantExpr(NIL_VAL);
+//< Constant Folding literal-constants
       lastExpressionType = NULLABLE_IMMUTABLE_TYPE(TYPE_VOID.baseType);
       break;
     case TOKEN_TRUE: 
+/* Types of Values parse-literal < Constant Folding literal-constants
       emitByte(OP_TRUE); 
+*/
+//> Constant Folding literal-constants
+      emitConstantExpr(BOOL_VAL(true));
+//< Constant Folding literal-constants
       lastExpressionType = TYPE_BOOL;
       break;
     default: return; // Unreachable.
@@ -1092,13 +2033,37 @@ static void number(bool canAssign) {
   emitConstant(value);
 */
 //> Types of Values const-number-val
+/* Types of Values const-number-val < Constant Folding number-constant
   emitConstant(NUMBER_VAL(value));
+*/
+//> Constant Folding number-constant
+  emitConstantExpr(NUMBER_VAL(value));
+//< Constant Folding number-constant
 //< Types of Values const-number-val
   lastExpressionType = TYPE_INT;
 }
 //< Compiling Expressions number
 //> Jumping Back and Forth or
 static void or_(bool canAssign) {
+//> Constant Folding or-constant
+  ConstantExpr left;
+  if (endsWithConstant(&left)) {
+    if (!isFalseyConstant(left.value)) {
+      // The right operand is never evaluated.
+      BranchStart right = markBranch();
+      parsePrecedence(PREC_OR);
+      discardBranch(right);
+      lastConstant = left;
+    } else {
+      discardCode(left.start);
+      releaseConstant(left.constant);
+      parsePrecedence(PREC_OR);
+    }
+    lastExpressionType = TYPE_BOOL;
+    return;
+  }
+
+//< Constant Folding or-constant
   int elseJump = emitJump(OP_JUMP_IF_FALSE);
   int endJump = emitJump(OP_JUMP);
 
@@ -1117,8 +2082,14 @@ static void string() {
 //> Global Variables string
 static void string(bool canAssign) {
 //< Global Variables string
+/* Strings parse-string < Constant Folding string-constant
   emitConstant(OBJ_VAL(copyString(parser.previous.start + 1,
                                   parser.previous.length - 2)));
+*/
+//> Constant Folding string-constant
+  emitConstantExpr(OBJ_VAL(copyString(parser.previous.start + 1,
+                                      parser.previous.length - 2)));
+//< Constant Folding string-constant
   lastExpressionType = TYPE_STRING;
 }
 //< Strings parse-string
@@ -1201,8 +2172,35 @@ static void hashLiteral(bool canAssign) {
 }
 //< Hash literal function
 
+//> Array literal function
+static void arrayLiteral(bool canAssign) {
+  int elementCount = 0;
+  
+  if (!check(TOKEN_RIGHT_BRACKET)) {
+    do {
+      expression();
+      
+      elementCount++;
+      if (elementCount > 255) {
+        error("Can't have more than 255 elements in array literal.");
+      }
+    } while (match(TOKEN_COMMA));
+  }
+  
+  consume(TOKEN_RIGHT_BRACKET, "Expect ']' after array literal.");
+  
+  emitBytes(OP_ARRAY_LITERAL, elementCount);
+  lastExpressionType = TYPE_ARRAY;
+}
+//< Array literal function
+
 //> Hash indexing function
 static void indexing(bool canAssign) {
+//> Arrays typed-indexing
+  // A receiver known to be an array gets the typed opcodes, which index the
+  // element storage directly instead of going through the hash path.
+  bool typedArray = lastExpressionType.baseType == RETURN_TYPE_ARRAY;
+//< Arrays typed-indexing
   // Parse the index expression
   expression();
   consume(TOKEN_RIGHT_BRACKET, "Expect ']' after index.");
@@ -1210,11 +2208,11 @@ static void indexing(bool canAssign) {
   if (canAssign && match(TOKEN_EQUAL)) {
     // Hash assignment: hash[key] = value
     expression();
-    emitByte(OP_SET_INDEX);
+    emitByte(typedArray ? OP_SET_ARRAY_INDEX : OP_SET_INDEX);
     lastExpressionType = TYPE_VOID; // Assignment returns void
   } else {
     // Hash access: hash[key]
-    emitByte(OP_GET_INDEX);
+    emitByte(typedArray ? OP_GET_ARRAY_INDEX : OP_GET_INDEX);
     lastExpressionType = TYPE_VOID; // Conservative - we don't know the value type
   }
 }
@@ -1242,9 +2240,16 @@ static void namedVariable(Token name, bool canAssign) {
     getOp = OP_GET_UPVALUE;
     setOp = OP_SET_UPVALUE;
   } else {
+/* Local Variables named-local < Global Slots named-global-slot
     globalArg = identifierConstant(&name);
     getOp = OP_GET_GLOBAL;
     setOp = OP_SET_GLOBAL;
+*/
+//> Global Slots named-global-slot
+    globalArg = globalSlotIndex(copyString(name.start, name.length));
+    getOp = OP_GET_GLOBAL_SLOT;
+    setOp = OP_SET_GLOBAL_SLOT;
+//< Global Slots named-global-slot
   }
 //< Local Variables named-local
 /* Global Variables read-named-variable < Global Variables named-variable
@@ -1279,7 +2284,7 @@ static void namedVariable(Token name, bool canAssign) {
     }
     
     // Type check for global variables
-    if (getOp == OP_GET_GLOBAL) {
+    if (getOp == OP_GET_GLOBAL_SLOT) {
       // This is a global variable assignment - check mutability first, then types
       ObjString* varName = copyString(name.start, name.length);
       ReturnType globalType = getGlobalVarType(varName);
@@ -1297,7 +2302,7 @@ static void namedVariable(Token name, bool canAssign) {
       }
     }
     
-    if (setOp == OP_SET_GLOBAL) {
+    if (setOp == OP_SET_GLOBAL_SLOT) {
       emitByte(setOp);
       emitByte((globalArg >> 8) & 0xff);  // High byte
       emitByte(globalArg & 0xff);         // Low byte
@@ -1309,7 +2314,7 @@ static void namedVariable(Token name, bool canAssign) {
     emitBytes(OP_GET_GLOBAL, arg);
 */
 //> Local Variables emit-get
-    if (getOp == OP_GET_GLOBAL) {
+    if (getOp == OP_GET_GLOBAL_SLOT) {
       emitByte(getOp);
       emitByte((globalArg >> 8) & 0xff);  // High byte
       emitByte(globalArg & 0xff);         // Low byte
@@ -1322,7 +2327,7 @@ static void namedVariable(Token name, bool canAssign) {
       // For local variables, get the type from the Local struct
       Local* local = &current->locals[arg];
       lastExpressionType = local->type;
-    } else if (getOp == OP_GET_GLOBAL) {
+    } else if (getOp == OP_GET_GLOBAL_SLOT) {
       // For global variables, get the type from the global variable table
       ObjString* varName = copyString(name.start, name.length);
       lastExpressionType = getGlobalVarType(varName);
@@ -1431,9 +2436,17 @@ static void unary() {
 //> Global Variables unary
 static void unary(bool canAssign) {
   TokenType operatorType = parser.previous.type;
+//> Constant Folding unary-operand
+  int operandStart = currentChunk()->count;
+//< Constant Folding unary-operand
 
   // Compile the operand.
   parsePrecedence(PREC_UNARY);
+//> Constant Folding unary-operand
+  ConstantExpr operand;
+  bool constantOperand = endsWithConstant(&operand) &&
+                         operand.start == operandStart;
+//< Constant Folding unary-operand
 
   // Emit the operator instruction.
   switch (operatorType) {
@@ -1447,6 +2460,17 @@ static void unary(bool canAssign) {
       break;
     default: return; // Unreachable.
   }
+//> Constant Folding fold-unary
+
+  if (!constantOperand) return;
+  if (operatorType == TOKEN_BANG) {
+    replaceConstants(operandStart, &operand, NULL,
+                     BOOL_VAL(isFalseyConstant(operand.value)));
+  } else if (IS_NUMBER(operand.value)) {
+    replaceConstants(operandStart, &operand, NULL,
+                     NUMBER_VAL(-AS_NUMBER(operand.value)));
+  }
+//< Constant Folding fold-unary
 }
 //< Compiling Expressions unary
 //> Compiling Expressions rules
@@ -1460,7 +2484,7 @@ ParseRule rules[] = {
   [TOKEN_RIGHT_PAREN]   = {NULL,     NULL,   PREC_NONE},
   [TOKEN_LEFT_BRACE]    = {hashLiteral, NULL, PREC_NONE},
   [TOKEN_RIGHT_BRACE]   = {NULL,     NULL,   PREC_NONE},
-  [TOKEN_LEFT_BRACKET]  = {NULL,     indexing, PREC_CALL},
+  [TOKEN_LEFT_BRACKET]  = {arrayLiteral, indexing, PREC_CALL},
   [TOKEN_RIGHT_BRACKET] = {NULL,     NULL,   PREC_NONE},
   [TOKEN_COMMA]         = {NULL,     NULL,   PREC_NONE},
 /* Compiling Expressions rules < Classes and Instances table-dot
@@ -1665,12 +2689,13 @@ static ReturnType function(FunctionType type) {
       ReturnType paramType = IMMUTABLE_NONNULL_TYPE(TYPE_VOID.baseType);
       if (check(TOKEN_RETURNTYPE_INT) || check(TOKEN_RETURNTYPE_STRING) || 
           check(TOKEN_RETURNTYPE_BOOL) || check(TOKEN_RETURNTYPE_FUNC) ||
-          check(TOKEN_RETURNTYPE_OBJ) || check(TOKEN_RETURNTYPE_HASH)) {
+          check(TOKEN_RETURNTYPE_OBJ) || check(TOKEN_RETURNTYPE_HASH) ||
+          check(TOKEN_RETURNTYPE_ARRAY)) {
         TokenType typeToken = parser.current.type;
         advance(); // Consume the type token first
         paramType = tokenToBaseType(typeToken);
       } else {
-        errorAtCurrent("Expect parameter type (int, string, bool, func, obj, or hash).");
+        errorAtCurrent("Expect parameter type (int, string, bool, func, obj, hash, or array).");
       }
       
       // Store parameter type for enhanced type checking
@@ -1693,7 +2718,7 @@ static ReturnType function(FunctionType type) {
   if (check(TOKEN_RETURNTYPE_INT) || check(TOKEN_RETURNTYPE_STRING) || 
       check(TOKEN_RETURNTYPE_BOOL) || check(TOKEN_RETURNTYPE_VOID) || 
       check(TOKEN_RETURNTYPE_FUNC) || check(TOKEN_RETURNTYPE_OBJ) ||
-      check(TOKEN_RETURNTYPE_HASH)) {
+      check(TOKEN_RETURNTYPE_HASH) || check(TOKEN_RETURNTYPE_ARRAY)) {
     // Store the return type in the function object
     TokenType typeToken = parser.current.type;
     advance(); // Consume the type token first
@@ -1706,6 +2731,18 @@ static ReturnType function(FunctionType type) {
   gemBlock();
 
   ObjFunction* function = endCompiler();
+//> Inlining record-inlinable
+  int depths[JIT_MAX_INLINE_SIZE];
+  bool inlinable = !parser.hadError && !compiler.callsItself &&
+                   inlineDepths(function, depths);
+  lastInlinableFunction = inlinable ? function : NULL;
+//< Inlining record-inlinable
+//> Memory Safety function-scope-end
+  // The body's scope is thrown away with its compiler instead of being
+  // closed by endScope(), so leave it here.
+  vm.currentScopeDepth--;
+  releaseScopeObjects(vm.currentScopeDepth + 1);
+//< Memory Safety function-scope-end
 //> Closures emit-closure
   uint16_t constant = makeConstant(OBJ_VAL(function));
   emitByte(OP_CLOSURE);
@@ -1752,6 +2789,10 @@ static void method() {
   if (currentClass != NULL) {
     ObjString* methodNameString = copyString(methodName.start, methodName.length);
     addMethod(currentClass->className, methodNameString, returnType);
+//> Inlining register-method
+    addInlineCandidate(currentClass->className, methodNameString,
+                       type == TYPE_METHOD ? lastInlinableFunction : NULL);
+//< Inlining register-method
   }
 //< method-body
   emitByte(OP_METHOD);
@@ -1913,13 +2954,40 @@ static void forStatement() {
 
   int loopStart = currentChunk()->count;
   int exitJump = -1;
+//> Fused Branches for-condition
+  bool popCondition = false;
+//< Fused Branches for-condition
   if (!match(TOKEN_SEMICOLON)) {
     expression();
     consume(TOKEN_SEMICOLON, "Expect ';' after loop condition.");
+//> Constant Folding for-condition
+    ConstantExpr condition;
+    bool alwaysTrue = endsWithConstant(&condition) &&
+                      !isFalseyConstant(condition.value);
+    if (alwaysTrue) {
+      // The loop only ends by returning, so there is nothing to test.
+      discardCode(condition.start);
+      releaseConstant(condition.constant);
+    }
+//< Constant Folding for-condition
 
     // Jump out of the loop if the condition is false.
+/* Jumping Back and Forth for-statement < Fused Branches for-condition
     exitJump = emitJump(OP_JUMP_IF_FALSE);
     emitByte(OP_POP); // Condition.
+*/
+//> Fused Branches for-condition
+/* Fused Branches for-condition < Constant Folding for-condition
+    exitJump = emitConditionJump(&popCondition);
+    if (popCondition) emitByte(OP_POP); // Condition.
+*/
+//> Constant Folding for-condition
+    if (!alwaysTrue) {
+      exitJump = emitConditionJump(&popCondition);
+      if (popCondition) emitByte(OP_POP); // Condition.
+    }
+//< Constant Folding for-condition
+//< Fused Branches for-condition
   }
 
   if (!match(TOKEN_RIGHT_PAREN)) {
@@ -1947,7 +3015,12 @@ static void forStatement() {
 
   if (exitJump != -1) {
     patchJump(exitJump);
+/* Jumping Back and Forth for-statement < Fused Branches for-condition
     emitByte(OP_POP); // Condition.
+*/
+//> Fused Branches for-condition
+    if (popCondition) emitByte(OP_POP); // Condition.
+//< Fused Branches for-condition
   }
 
   consume(TOKEN_END, "Expect 'end' after block.");
@@ -2068,6 +3141,7 @@ static void requireStatement() {
           current++;
         }
         ObjString* moduleName = copyString(moduleNameStart, current - moduleNameStart);
+        push(OBJ_VAL(moduleName)); // Keep reachable until it is registered
         
         // Look for function definitions in this module
         while (*current != '\0') {
@@ -2147,6 +3221,10 @@ static void requireStatement() {
                       (current[4] == ' ' || current[4] == '\t' || current[4] == '\n' || current[4] == '\r' || current[4] == '\0')) {
               returnType = TYPE_HASH;
               current += 4;
+            } else if (strncmp(current, "array", 5) == 0 && 
+                      (current[5] == ' ' || current[5] == '\t' || current[5] == '\n' || current[5] == '\r' || current[5] == '\0')) {
+              returnType = TYPE_ARRAY;
+              current += 5;
             }
             
             // Register the function signature
@@ -2191,6 +3269,7 @@ static void requireStatement() {
             current++;
           }
         }
+        (void)pop(); // moduleName
         break; // Found the module, we're done
       } else {
         current++;
@@ -2236,7 +3315,13 @@ static void returnStatement() {
       error("Cannot return a value from void function.");
     }
     
+//> Inlining in-return
+    current->inReturn = true;
+//< Inlining in-return
     expression();
+//> Inlining in-return-end
+    current->inReturn = false;
+//< Inlining in-return-end
     
     // Type check the returned expression
     ReturnType expressionType = inferExpressionType();
@@ -2246,8 +3331,20 @@ static void returnStatement() {
     }
     
     consumeStatementTerminator("Expect ';' or newline after return value.");
+//> Tail Calls emit-tail-call
+    // A call that ends the returned expression is in tail position. Code
+    // that jumps past it (from `?:`, `and` or `or`) lands on the OP_RETURN
+    // below, which still runs when the callee isn't a closure.
+    Chunk* chunk = currentChunk();
+    if (lastCallChunk == chunk && lastCallOffset + 4 == chunk->count) {
+      chunk->code[lastCallOffset] = OP_TAIL_CALL;
+    }
+//< Tail Calls emit-tail-call
     emitByte(OP_RETURN);
   }
+//> Constant Folding return-dead-code
+  current->deadCode = true;
+//< Constant Folding return-dead-code
 }
 //< Calls and Functions return-statement
 
@@ -2262,6 +3359,7 @@ static GemType tokenToBaseType(TokenType token) {
     case TOKEN_RETURNTYPE_FUNC: baseType = TYPE_FUNC.baseType; break;
     case TOKEN_RETURNTYPE_OBJ: baseType = TYPE_OBJ.baseType; break;
     case TOKEN_RETURNTYPE_HASH: baseType = TYPE_HASH.baseType; break;
+    case TOKEN_RETURNTYPE_ARRAY: baseType = TYPE_ARRAY.baseType; break;
     default: baseType = TYPE_VOID.baseType; break; // Should never happen
   }
   
@@ -2556,6 +3654,7 @@ static void typedVarDeclaration() {
     case TOKEN_RETURNTYPE_FUNC: baseType = TYPE_FUNC.baseType; break;
     case TOKEN_RETURNTYPE_OBJ: baseType = TYPE_OBJ.baseType; break;
     case TOKEN_RETURNTYPE_HASH: baseType = TYPE_HASH.baseType; break;
+    case TOKEN_RETURNTYPE_ARRAY: baseType = TYPE_ARRAY.baseType; break;
     default: 
       error("Unknown type in variable declaration.");
       return;
@@ -2642,7 +3741,8 @@ static void mutVarDeclaration() {
   // Now we expect a type token
   if (!match(TOKEN_RETURNTYPE_INT) && !match(TOKEN_RETURNTYPE_STRING) && 
       !match(TOKEN_RETURNTYPE_BOOL) && !match(TOKEN_RETURNTYPE_FUNC) &&
-      !match(TOKEN_RETURNTYPE_OBJ) && !match(TOKEN_RETURNTYPE_HASH)) {
+      !match(TOKEN_RETURNTYPE_OBJ) && !match(TOKEN_RETURNTYPE_HASH) &&
+      !match(TOKEN_RETURNTYPE_ARRAY)) {
     error("Expect type after 'mut' keyword.");
     return;
   }
@@ -2657,6 +3757,7 @@ static void mutVarDeclaration() {
     case TOKEN_RETURNTYPE_FUNC: baseType = TYPE_FUNC.baseType; break;
     case TOKEN_RETURNTYPE_OBJ: baseType = TYPE_OBJ.baseType; break;
     case TOKEN_RETURNTYPE_HASH: baseType = TYPE_HASH.baseType; break;
+    case TOKEN_RETURNTYPE_ARRAY: baseType = TYPE_ARRAY.baseType; break;
     default: 
       error("Unknown type in variable declaration.");
       return;
@@ -2757,13 +3858,60 @@ static void scopedBlock() {
 //< Local Variables scoped-block
 
 //> Control Flow Statements
+static void ifStatement();
+
+// Compiles the rest of an if statement whose condition is known. The dead
+// branch is still compiled, so its errors are reported, and then dropped
+// along with any locals it declared.
+static void constantIfStatement(bool taken) {
+  BranchStart thenBranch = markBranch();
+  int localCount = current->localCount;
+  bool deadCode = current->deadCode;
+  while (!check(TOKEN_ELSE) && !check(TOKEN_ELSIF) && !check(TOKEN_END) && !check(TOKEN_EOF)) {
+    declaration();
+  }
+  if (!taken) {
+    discardBranch(thenBranch);
+    current->localCount = localCount;
+    current->deadCode = deadCode;
+  }
+
+  BranchStart elseBranch = markBranch();
+  localCount = current->localCount;
+  deadCode = current->deadCode;
+  if (match(TOKEN_ELSE)) {
+    while (!check(TOKEN_END) && !check(TOKEN_EOF)) {
+      declaration();
+    }
+    consume(TOKEN_END, "Expect 'end' after if statement.");
+  } else if (match(TOKEN_ELSIF)) {
+    ifStatement();
+  } else {
+    consume(TOKEN_END, "Expect 'end' after if statement.");
+  }
+  if (taken) {
+    discardBranch(elseBranch);
+    current->localCount = localCount;
+    current->deadCode = deadCode;
+  }
+}
+
 static void ifStatement() {
   consume(TOKEN_LEFT_PAREN, "Expect '(' after 'if'.");
   expression();
   consume(TOKEN_RIGHT_PAREN, "Expect ')' after if condition.");
 
-  int thenJump = emitJump(OP_JUMP_IF_FALSE);
-  emitByte(OP_POP);
+  ConstantExpr condition;
+  if (endsWithConstant(&condition)) {
+    discardCode(condition.start);
+    releaseConstant(condition.constant);
+    constantIfStatement(!isFalseyConstant(condition.value));
+    return;
+  }
+
+  bool popCondition;
+  int thenJump = emitConditionJump(&popCondition);
+  if (popCondition) emitByte(OP_POP);
   
   // Parse the if body - simple loop like forStatement
   while (!check(TOKEN_ELSE) && !check(TOKEN_ELSIF) && !check(TOKEN_END) && !check(TOKEN_EOF)) {
@@ -2773,7 +3921,7 @@ static void ifStatement() {
   int elseJump = emitJump(OP_JUMP);
 
   patchJump(thenJump);
-  emitByte(OP_POP);
+  if (popCondition) emitByte(OP_POP);
 
   if (match(TOKEN_ELSE)) {
     // Parse the else body
@@ -2795,13 +3943,36 @@ static void whileStatement() {
   expression();
   consume(TOKEN_RIGHT_PAREN, "Expect ')' after condition.");
 
-  int exitJump = emitJump(OP_JUMP_IF_FALSE);
-  emitByte(OP_POP);
+  ConstantExpr condition;
+  if (endsWithConstant(&condition)) {
+    discardCode(condition.start);
+    releaseConstant(condition.constant);
+    if (isFalseyConstant(condition.value)) {
+      // The body never runs.
+      BranchStart body = markBranch();
+      int localCount = current->localCount;
+      bool deadCode = current->deadCode;
+      gemBlock();
+      discardBranch(body);
+      current->localCount = localCount;
+      current->deadCode = deadCode;
+    } else {
+      // Nothing leaves the loop, so nothing after it runs.
+      gemBlock();
+      emitLoop(loopStart);
+      current->deadCode = true;
+    }
+    return;
+  }
+
+  bool popCondition;
+  int exitJump = emitConditionJump(&popCondition);
+  if (popCondition) emitByte(OP_POP);
   gemBlock();
   emitLoop(loopStart);
 
   patchJump(exitJump);
-  emitByte(OP_POP);
+  if (popCondition) emitByte(OP_POP);
 }
 
 static void beginStatement() {
@@ -2825,6 +3996,9 @@ static void defDeclaration() {
     addFunction(nameString, functionReturnType);
     // Also register with enhanced parameter tracking
     addFunctionWithParams(nameString, functionReturnType, functionParams);
+//> Inlining register-function
+    addInlineCandidate(NULL, nameString, lastInlinableFunction);
+//< Inlining register-function
   }
 
   defineVariable(nameConstant);
@@ -2869,6 +4043,7 @@ static void synchronize() {
       case TOKEN_RETURNTYPE_FUNC:
       case TOKEN_RETURNTYPE_OBJ:
       case TOKEN_RETURNTYPE_HASH:
+      case TOKEN_RETURNTYPE_ARRAY:
       case TOKEN_FOR:
       case TOKEN_IF:
       case TOKEN_WHILE:
@@ -2896,6 +4071,10 @@ static void declaration() {
       check(TOKEN_EOF) || check(TOKEN_RIGHT_BRACE)) {
     return;
   }
+//> Constant Folding dead-declaration
+  bool deadCode = current->deadCode;
+  BranchStart start = markBranch();
+//< Constant Folding dead-declaration
   
   if (match(TOKEN_CLASS)) {
     classDeclaration();
@@ -2909,11 +4088,20 @@ static void declaration() {
     mutVarDeclaration();
   } else if (match(TOKEN_RETURNTYPE_INT) || match(TOKEN_RETURNTYPE_STRING) || 
              match(TOKEN_RETURNTYPE_BOOL) || match(TOKEN_RETURNTYPE_FUNC) ||
-             match(TOKEN_RETURNTYPE_OBJ) || match(TOKEN_RETURNTYPE_HASH)) {
+             match(TOKEN_RETURNTYPE_OBJ) || match(TOKEN_RETURNTYPE_HASH) ||
+             match(TOKEN_RETURNTYPE_ARRAY)) {
     typedVarDeclaration();
   } else {
     statement();
   }
+//> Constant Folding dead-declaration
+
+  // Nothing jumps into code that follows a return, so it never runs.
+  if (deadCode) {
+    discardBranch(start);
+    current->deadCode = true;
+  }
+//< Constant Folding dead-declaration
 
   if (parser.panicMode) synchronize();
 }
@@ -2931,6 +4119,9 @@ void initCompilerTables() {
   initFunctionTableWithParams();
   initMethodTableWithParams();
   initModuleFunctionTableWithParams();
+//> Inlining init-inline-candidates
+  inlineCandidates.count = 0;
+//< Inlining init-inline-candidates
 }
 
 ObjFunction* compile(const char* source) {
@@ -2957,6 +4148,106 @@ ObjFunction* compile(const char* source) {
   ObjFunction* function = endCompiler();
   return parser.hadError ? NULL : function;
 }
+//> Garbage Collection mark-compiler-roots
+static void markType(ReturnType type) {
+  markObject((Obj*)type.className);
+}
+
+static void markParams(FunctionParams* params) {
+  for (int i = 0; i < params->paramCount; i++) {
+    markType(params->paramTypes[i]);
+  }
+}
+
+void markCompilerRoots() {
+  Compiler* compiler = current;
+  while (compiler != NULL) {
+    markObject((Obj*)compiler->function);
+    // Functions being compiled may already be old, and their constants
+    // are added without a write barrier, so trace them directly.
+    ObjFunction* function = compiler->function;
+    markObject((Obj*)function->name);
+    markType(function->returnType);
+    for (int i = 0; i < function->chunk.constants.count; i++) {
+      markValue(function->chunk.constants.values[i]);
+    }
+    for (int i = 0; i < compiler->localCount; i++) {
+      markType(compiler->locals[i].type);
+    }
+    compiler = compiler->enclosing;
+  }
+
+  for (ClassCompiler* klass = currentClass; klass != NULL;
+       klass = klass->enclosing) {
+    markObject((Obj*)klass->className);
+  }
+
+  // The type tables hold interned names that must outlive any single
+  // compile, since later requires consult them.
+  for (int i = 0; i < globalVars.count; i++) {
+    markObject((Obj*)globalVars.globals[i].name);
+    markType(globalVars.globals[i].type);
+  }
+  for (int i = 0; i < classFields.classCount; i++) {
+    ClassFieldSignature* klass = &classFields.classes[i];
+    markObject((Obj*)klass->className);
+    for (int j = 0; j < klass->fieldCount; j++) {
+      markObject((Obj*)klass->fields[j].fieldName);
+      markType(klass->fields[j].fieldType);
+    }
+  }
+  for (int i = 0; i < globalFunctions.count; i++) {
+    markObject((Obj*)globalFunctions.functions[i].functionName);
+    markType(globalFunctions.functions[i].returnType);
+  }
+  for (int i = 0; i < globalMethods.count; i++) {
+    markObject((Obj*)globalMethods.methods[i].className);
+    markObject((Obj*)globalMethods.methods[i].methodName);
+    markType(globalMethods.methods[i].returnType);
+  }
+  for (int i = 0; i < globalClasses.count; i++) {
+    markObject((Obj*)globalClasses.classes[i].className);
+  }
+  for (int i = 0; i < moduleFunctions.count; i++) {
+    markObject((Obj*)moduleFunctions.functions[i].moduleName);
+    markObject((Obj*)moduleFunctions.functions[i].functionName);
+    markType(moduleFunctions.functions[i].returnType);
+  }
+  for (int i = 0; i < globalFunctionsWithParams.count; i++) {
+    FunctionSignatureWithParams* function = &globalFunctionsWithParams.functions[i];
+    markObject((Obj*)function->functionName);
+    markType(function->returnType);
+    markParams(&function->params);
+  }
+  for (int i = 0; i < globalMethodsWithParams.count; i++) {
+    MethodSignatureWithParams* method = &globalMethodsWithParams.methods[i];
+    markObject((Obj*)method->className);
+    markObject((Obj*)method->methodName);
+    markType(method->returnType);
+    markParams(&method->params);
+  }
+  for (int i = 0; i < moduleFunctionsWithParams.count; i++) {
+    ModuleFunctionSignatureWithParams* function = &moduleFunctionsWithParams.functions[i];
+    markObject((Obj*)function->moduleName);
+    markObject((Obj*)function->functionName);
+    markType(function->returnType);
+    markParams(&function->params);
+  }
+
+//> Inlining mark-inline-candidates
+  for (int i = 0; i < inlineCandidates.count; i++) {
+    InlineCandidate* candidate = &inlineCandidates.candidates[i];
+    markObject((Obj*)candidate->className);
+    markObject((Obj*)candidate->name);
+    markObject((Obj*)candidate->function);
+  }
+//< Inlining mark-inline-candidates
+
+  markObject((Obj*)lastAccessedIdentifier);
+  markType(lastExpressionType);
+  markParams(&lastCompiledFunctionParams);
+}
+//< Garbage Collection mark-compiler-roots
 //< Compilation Functions
 
 //> Embedded STL Modules for Compiler
@@ -2971,6 +4262,13 @@ static const char* getCompilerEmbeddedSTLModule(const char* moduleName) {
 //< Embedded STL Modules for Compiler
 
 // Helper function to consume either a semicolon or newline (optional semicolons)
+// Whether the current token ends a statement.
+static bool checkStatementEnd() {
+  return check(TOKEN_SEMICOLON) || check(TOKEN_NEWLINE) ||
+         check(TOKEN_EOF) || check(TOKEN_END) || check(TOKEN_ELSE) ||
+         check(TOKEN_ELSIF) || check(TOKEN_RIGHT_BRACE);
+}
+
 static void consumeStatementTerminator(const char* message) {
   if (match(TOKEN_SEMICOLON) || match(TOKEN_NEWLINE)) {
     return;
@@ -2992,8 +4290,9 @@ static void typeCast(bool canAssign) {
   
   // Parse the target type
   if (!match(TOKEN_RETURNTYPE_INT) && !match(TOKEN_RETURNTYPE_STRING) && 
-      !match(TOKEN_RETURNTYPE_BOOL) && !match(TOKEN_RETURNTYPE_HASH)) {
-    error("Expect type after 'as' keyword (int, string, bool, or hash).");
+      !match(TOKEN_RETURNTYPE_BOOL) && !match(TOKEN_RETURNTYPE_HASH) &&
+      !match(TOKEN_RETURNTYPE_ARRAY)) {
+    error("Expect type after 'as' keyword (int, string, bool, hash, or array).");
     return;
   }
   
@@ -3014,6 +4313,9 @@ static void typeCast(bool canAssign) {
     case TOKEN_RETURNTYPE_HASH:
       targetType = TYPE_HASH;
       break;
+    case TOKEN_RETURNTYPE_ARRAY:
+      targetType = TYPE_ARRAY;
+      break;
     default:
       error("Invalid cast target type.");
       return;
@@ -3055,6 +4357,11 @@ static void typeCast(bool canAssign) {
     validCast = true;
   }
   
+  // Allow casting from array elements to any type (runtime conversion)
+  if (sourceType.baseType == RETURN_TYPE_ARRAY) {
+    validCast = true;
+  }
+  
   // Allow casting from object types to any type (runtime conversion)
   if (sourceType.baseType == RETURN_TYPE_OBJ) {
     validCast = true;
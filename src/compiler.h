@@ -21,5 +21,8 @@ ObjFunction* compile(const char* source);
 //> Global Variable Table Initialization
 void initCompilerTables();
 //< Global Variable Table Initialization
+//> Garbage Collection mark-compiler-roots-h
+void markCompilerRoots();
+//< Garbage Collection mark-compiler-roots-h
 
 #endif
@@ -49,6 +49,40 @@ static int invokeInstruction(const char* name, Chunk* chunk,
   return offset + 4;
 }
 //< Methods and Initializers invoke-instruction
+//> Inline Caches property-instruction
+static int propertyInstruction(const char* name, Chunk* chunk,
+                               int offset) {
+  uint16_t constant = (uint16_t)(chunk->code[offset + 1] << 8);
+  constant |= chunk->code[offset + 2];
+  uint16_t cache = (uint16_t)(chunk->code[offset + 3] << 8);
+  cache |= chunk->code[offset + 4];
+  printf("%-16s %4d '", name, constant);
+  printValue(chunk->constants.values[constant]);
+  printf("' (cache %d)\n", cache);
+  return offset + 5;
+}
+
+static int callInstruction(const char* name, Chunk* chunk, int offset) {
+  uint8_t argCount = chunk->code[offset + 1];
+  uint16_t cache = (uint16_t)(chunk->code[offset + 2] << 8);
+  cache |= chunk->code[offset + 3];
+  printf("%-16s (%d args) (cache %d)\n", name, argCount, cache);
+  return offset + 4;
+}
+
+static int invokeCacheInstruction(const char* name, Chunk* chunk,
+                                  int offset) {
+  uint16_t constant = (uint16_t)(chunk->code[offset + 1] << 8);
+  constant |= chunk->code[offset + 2];
+  uint8_t argCount = chunk->code[offset + 3];
+  uint16_t cache = (uint16_t)(chunk->code[offset + 4] << 8);
+  cache |= chunk->code[offset + 5];
+  printf("%-16s (%d args) %4d '", name, argCount, constant);
+  printValue(chunk->constants.values[constant]);
+  printf("' (cache %d)\n", cache);
+  return offset + 6;
+}
+//< Inline Caches property-instruction
 //> simple-instruction
 static int simpleInstruction(const char* name, int offset) {
   printf("%s\n", name);
@@ -73,6 +107,72 @@ static int jumpInstruction(const char* name, int sign,
   return offset + 3;
 }
 //< Jumping Back and Forth jump-instruction
+//> Global Slots global-slot-instruction
+static int globalSlotInstruction(const char* name, Chunk* chunk,
+                                 int offset) {
+  uint16_t slot = (uint16_t)(chunk->code[offset + 1] << 8);
+  slot |= chunk->code[offset + 2];
+  printf("%-16s %4d\n", name, slot);
+  return offset + 3;
+}
+//< Global Slots global-slot-instruction
+//> Superinstructions superinstruction-disassembly
+// A fused instruction prints its operands and skips the bytes of the
+// sequence it stands for.
+static int localPairInstruction(const char* name, Chunk* chunk,
+                                int offset) {
+  printf("%-16s %4d %4d\n", name, chunk->code[offset + 1],
+         chunk->code[offset + 3]);
+  return offset + instructionLength(chunk, offset);
+}
+
+static int localConstantInstruction(const char* name, Chunk* chunk,
+                                    int offset) {
+  uint8_t constant = chunk->code[offset + 3];
+  printf("%-16s %4d %4d '", name, chunk->code[offset + 1], constant);
+  printValue(chunk->constants.values[constant]);
+  printf("'\n");
+  return offset + instructionLength(chunk, offset);
+}
+
+static int fusedPopInstruction(const char* name, Chunk* chunk, int offset) {
+  int slot = chunk->code[offset + 1];
+  if (chunk->code[offset] == OP_SET_GLOBAL_SLOT_POP) {
+    slot = (slot << 8) | chunk->code[offset + 2];
+  }
+  printf("%-16s %4d\n", name, slot);
+  return offset + instructionLength(chunk, offset);
+}
+//< Superinstructions superinstruction-disassembly
+//> Inlining inline-instruction
+static int inlineCallInstruction(const char* name, Chunk* chunk,
+                                 int offset) {
+  uint8_t argCount = chunk->code[offset + 1];
+  uint16_t constant = (uint16_t)(chunk->code[offset + 2] << 8);
+  constant |= chunk->code[offset + 3];
+  uint16_t skip = (uint16_t)(chunk->code[offset + 4] << 8);
+  skip |= chunk->code[offset + 5];
+  printf("%-16s (%d args) %4d ", name, argCount, constant);
+  printValue(chunk->constants.values[constant]);
+  printf(" else -> %d\n", offset + 6 + skip);
+  return offset + 6;
+}
+
+static int inlineInvokeInstruction(const char* name, Chunk* chunk,
+                                   int offset) {
+  uint16_t constant = (uint16_t)(chunk->code[offset + 1] << 8);
+  constant |= chunk->code[offset + 2];
+  uint8_t argCount = chunk->code[offset + 3];
+  uint16_t cache = (uint16_t)(chunk->code[offset + 6] << 8);
+  cache |= chunk->code[offset + 7];
+  uint16_t skip = (uint16_t)(chunk->code[offset + 8] << 8);
+  skip |= chunk->code[offset + 9];
+  printf("%-16s (%d args) %4d '", name, argCount, constant);
+  printValue(chunk->constants.values[constant]);
+  printf("' (cache %d) else -> %d\n", cache, offset + 10 + skip);
+  return offset + 10;
+}
+//< Inlining inline-instruction
 //> disassemble-instruction
 int disassembleInstruction(Chunk* chunk, int offset) {
   printf("%04d ", offset);
@@ -124,6 +224,14 @@ int disassembleInstruction(Chunk* chunk, int offset) {
     case OP_SET_GLOBAL:
       return constantInstruction("OP_SET_GLOBAL", chunk, offset);
 //< Global Variables disassemble-set-global
+//> Global Slots disassemble-global-slots
+    case OP_GET_GLOBAL_SLOT:
+      return globalSlotInstruction("OP_GET_GLOBAL_SLOT", chunk, offset);
+    case OP_DEFINE_GLOBAL_SLOT:
+      return globalSlotInstruction("OP_DEFINE_GLOBAL_SLOT", chunk, offset);
+    case OP_SET_GLOBAL_SLOT:
+      return globalSlotInstruction("OP_SET_GLOBAL_SLOT", chunk, offset);
+//< Global Slots disassemble-global-slots
 //> Closures disassemble-upvalue-ops
     case OP_GET_UPVALUE:
       return byteInstruction("OP_GET_UPVALUE", chunk, offset);
@@ -132,9 +240,9 @@ int disassembleInstruction(Chunk* chunk, int offset) {
 //< Closures disassemble-upvalue-ops
 //> Classes and Instances disassemble-property-ops
     case OP_GET_PROPERTY:
-      return constantInstruction("OP_GET_PROPERTY", chunk, offset);
+      return propertyInstruction("OP_GET_PROPERTY", chunk, offset);
     case OP_SET_PROPERTY:
-      return constantInstruction("OP_SET_PROPERTY", chunk, offset);
+      return propertyInstruction("OP_SET_PROPERTY", chunk, offset);
 //< Classes and Instances disassemble-property-ops
 //> Hash Objects disassemble-hash-ops
     case OP_GET_INDEX:
@@ -143,6 +251,12 @@ int disassembleInstruction(Chunk* chunk, int offset) {
       return simpleInstruction("OP_SET_INDEX", offset);
     case OP_HASH_LITERAL:
       return byteInstruction("OP_HASH_LITERAL", chunk, offset);
+    case OP_ARRAY_LITERAL:
+      return byteInstruction("OP_ARRAY_LITERAL", chunk, offset);
+    case OP_GET_ARRAY_INDEX:
+      return simpleInstruction("OP_GET_ARRAY_INDEX", offset);
+    case OP_SET_ARRAY_INDEX:
+      return simpleInstruction("OP_SET_ARRAY_INDEX", offset);
 //< Hash Objects disassemble-hash-ops
 //> Superclasses disassemble-get-super
     case OP_GET_SUPER:
@@ -210,11 +324,15 @@ int disassembleInstruction(Chunk* chunk, int offset) {
 //< Jumping Back and Forth disassemble-loop
 //> Calls and Functions disassemble-call
     case OP_CALL:
-      return byteInstruction("OP_CALL", chunk, offset);
+      return callInstruction("OP_CALL", chunk, offset);
+//> Tail Calls disassemble-tail-call
+    case OP_TAIL_CALL:
+      return callInstruction("OP_TAIL_CALL", chunk, offset);
+//< Tail Calls disassemble-tail-call
 //< Calls and Functions disassemble-call
 //> Methods and Initializers disassemble-invoke
     case OP_INVOKE:
-      return invokeInstruction("OP_INVOKE", chunk, offset);
+      return invokeCacheInstruction("OP_INVOKE", chunk, offset);
 //< Methods and Initializers disassemble-invoke
 //> Superclasses disassemble-super-invoke
     case OP_SUPER_INVOKE:
@@ -264,7 +382,12 @@ int disassembleInstruction(Chunk* chunk, int offset) {
 //< Module System disassemble-module-method
 //> Module System disassemble-module-call
     case OP_MODULE_CALL:
+/* Module System disassemble-module-call < Module Slots disassemble-module-call
       return invokeInstruction("OP_MODULE_CALL", chunk, offset);
+*/
+//> Module Slots disassemble-module-call
+      return invokeCacheInstruction("OP_MODULE_CALL", chunk, offset);
+//< Module Slots disassemble-module-call
 //< Module System disassemble-module-call
 //> Superclasses disassemble-inherit
     case OP_INHERIT:
@@ -276,6 +399,65 @@ int disassembleInstruction(Chunk* chunk, int offset) {
 //< Methods and Initializers disassemble-method
     case OP_INTERPOLATE:
       return byteInstruction("OP_INTERPOLATE", chunk, offset);
+//> Superinstructions disassemble-superinstructions
+    case OP_GET_LOCAL_GET_LOCAL:
+      return localPairInstruction("OP_GET_LOCAL_GET_LOCAL", chunk, offset);
+    case OP_GET_LOCAL_CONSTANT:
+      return localConstantInstruction("OP_GET_LOCAL_CONSTANT", chunk, offset);
+    case OP_ADD_LOCAL_LOCAL:
+      return localPairInstruction("OP_ADD_LOCAL_LOCAL", chunk, offset);
+    case OP_ADD_LOCAL_CONSTANT:
+      return localConstantInstruction("OP_ADD_LOCAL_CONSTANT", chunk, offset);
+    case OP_SUBTRACT_LOCAL_CONSTANT:
+      return localConstantInstruction("OP_SUBTRACT_LOCAL_CONSTANT", chunk,
+                                      offset);
+    case OP_SET_LOCAL_POP:
+      return fusedPopInstruction("OP_SET_LOCAL_POP", chunk, offset);
+    case OP_SET_GLOBAL_SLOT_POP:
+      return fusedPopInstruction("OP_SET_GLOBAL_SLOT_POP", chunk, offset);
+    case OP_POP_LOOP: {
+      uint16_t jump = (uint16_t)(chunk->code[offset + 2] << 8);
+      jump |= chunk->code[offset + 3];
+      printf("%-16s %4d -> %d\n", "OP_POP_LOOP", offset, offset + 4 - jump);
+      return offset + 4;
+    }
+//< Superinstructions disassemble-superinstructions
+//> Quickening disassemble-quickened
+    case OP_QUICK_ADD_NUMBER:
+      return simpleInstruction("OP_QUICK_ADD_NUMBER", offset);
+    case OP_QUICK_ADD_STRING:
+      return simpleInstruction("OP_QUICK_ADD_STRING", offset);
+    case OP_QUICK_LESS_NUMBER:
+      return simpleInstruction("OP_QUICK_LESS_NUMBER", offset);
+    case OP_QUICK_GREATER_NUMBER:
+      return simpleInstruction("OP_QUICK_GREATER_NUMBER", offset);
+    case OP_QUICK_EQUAL_NUMBER:
+      return simpleInstruction("OP_QUICK_EQUAL_NUMBER", offset);
+//< Quickening disassemble-quickened
+//> Fused Branches disassemble-compare-jumps
+    case OP_JUMP_IF_NOT_LESS_NUMBER:
+      return jumpInstruction("OP_JUMP_IF_NOT_LESS_NUMBER", 1, chunk, offset);
+    case OP_JUMP_IF_NOT_LESS_EQUAL_NUMBER:
+      return jumpInstruction("OP_JUMP_IF_NOT_LESS_EQUAL_NUMBER", 1, chunk, offset);
+    case OP_JUMP_IF_NOT_GREATER_NUMBER:
+      return jumpInstruction("OP_JUMP_IF_NOT_GREATER_NUMBER", 1, chunk, offset);
+    case OP_JUMP_IF_NOT_GREATER_EQUAL_NUMBER:
+      return jumpInstruction("OP_JUMP_IF_NOT_GREATER_EQUAL_NUMBER", 1, chunk, offset);
+    case OP_JUMP_IF_NOT_EQUAL_NUMBER:
+      return jumpInstruction("OP_JUMP_IF_NOT_EQUAL_NUMBER", 1, chunk, offset);
+//< Fused Branches disassemble-compare-jumps
+//> Inlining disassemble-inline
+    case OP_INLINE_CALL:
+      return inlineCallInstruction("OP_INLINE_CALL", chunk, offset);
+    case OP_INLINE_INVOKE:
+      return inlineInvokeInstruction("OP_INLINE_INVOKE", chunk, offset);
+    case OP_GET_STACK:
+      return byteInstruction("OP_GET_STACK", chunk, offset);
+    case OP_SET_STACK:
+      return byteInstruction("OP_SET_STACK", chunk, offset);
+    case OP_INLINE_RETURN:
+      return byteInstruction("OP_INLINE_RETURN", chunk, offset);
+//< Inlining disassemble-inline
     default:
       printf("Unknown opcode %d\n", instruction);
       return offset + 1;
@@ -10,6 +10,7 @@
 #include "jit.h"
 #include "memory.h"
 #include "debug.h"
+#include "peephole.h"
 #include "vm.h"
 
 // Global JIT context
@@ -24,6 +25,7 @@ typedef struct CodeBuffer {
     uint8_t* code;          // Executable memory
     size_t size;            // Current size
     size_t capacity;        // Total capacity
+    bool full;              // Growing failed and code was dropped
 } CodeBuffer;
 
 // x86-64 register encodings
@@ -34,17 +36,35 @@ typedef enum {
     R12 = 12, R13 = 13, R14 = 14, R15 = 15
 } X64Register;
 
-// VM register mapping for efficient access
-#define VM_REG RDI              // VM pointer (first argument)
-#define FRAME_REG RSI           // CallFrame pointer (second argument)
-#define STACK_REG R12           // VM stack pointer (cached)
+// Registers compiled code keeps for the whole call. All are callee-saved,
+// so they survive calls into the interpreter.
+#define VM_REG RBX              // The VM
+#define STACK_REG R12           // vm.stackTop, written back around calls out
+#define FRAME_REG R13           // The CallFrame being run
+#define SLOTS_REG R14           // frame->slots
+#define DEPTH_REG R15           // vm.frameCount while the frame is on top
 #define TEMP_REG_1 RAX          // Temporary register 1
 #define TEMP_REG_2 RDX          // Temporary register 2
 #define TEMP_REG_3 RCX          // Temporary register 3
+#define TEMP_XMM_1 RAX          // xmm0 (SSE operands share the encoding)
+#define TEMP_XMM_2 RCX          // xmm1
+#define VIRTUAL_XMM_FIRST 2     // xmm2-xmm7 hold numbers not yet pushed
+#define VIRTUAL_XMM_COUNT 6
+#define NUMBER_XMM_FIRST 8      // xmm8-xmm15 hold number locals
+#define NUMBER_XMM_COUNT 8
+
+// Condition codes for jcc (0F 80+cc)
+#define CC_ALWAYS -1            // jmp rather than jcc
+#define CC_B  0x2               // CF=1
+#define CC_E  0x4               // ZF=1
+#define CC_NE 0x5               // ZF=0
+#define CC_BE 0x6               // CF=1 or ZF=1
+#define CC_P  0xA               // PF=1 (unordered)
 
 // Forward declarations for code generation
 static CodeBuffer* createCodeBuffer(size_t capacity);
 static void freeCodeBuffer(CodeBuffer* buffer);
+static uint8_t* installCode(CodeBuffer* buffer);
 static void emitByte(CodeBuffer* buffer, uint8_t byte);
 static void emitInt32(CodeBuffer* buffer, int32_t value);
 static void emitInt64(CodeBuffer* buffer, int64_t value);
@@ -58,16 +78,24 @@ static void emitMovRegImm64(CodeBuffer* buffer, X64Register reg, int64_t imm);
 static void emitMovRegReg(CodeBuffer* buffer, X64Register dst, X64Register src);
 static void emitMovRegMem(CodeBuffer* buffer, X64Register reg, X64Register base, int32_t offset);
 static void emitMovMemReg(CodeBuffer* buffer, X64Register base, int32_t offset, X64Register reg);
-static void emitAddRegReg(CodeBuffer* buffer, X64Register dst, X64Register src);
-static void emitSubRegReg(CodeBuffer* buffer, X64Register dst, X64Register src);
 static void emitCmpRegReg(CodeBuffer* buffer, X64Register reg1, X64Register reg2);
-static void emitJe(CodeBuffer* buffer, int32_t offset);
-static void emitJne(CodeBuffer* buffer, int32_t offset);
+static void emitXorRegReg(CodeBuffer* buffer, X64Register dst, X64Register src);
+static void emitAndRegReg(CodeBuffer* buffer, X64Register dst, X64Register src);
+static void emitTestReg32(CodeBuffer* buffer, X64Register reg);
+static void emitMovReg32Mem(CodeBuffer* buffer, X64Register reg, X64Register base, int32_t offset);
+static void emitCmpMem32Reg(CodeBuffer* buffer, X64Register base, int32_t offset, X64Register reg);
+static void emitCmpMem32Imm8(CodeBuffer* buffer, X64Register base, int32_t offset, int8_t imm);
+static void emitIncMem32(CodeBuffer* buffer, void* address);
+static void emitDecMem32(CodeBuffer* buffer, X64Register base, int32_t offset);
+static void emitCmpMemImm8(CodeBuffer* buffer, X64Register base, int32_t offset, int8_t imm);
 static void emitJmp(CodeBuffer* buffer, int32_t offset);
+static void emitJmpReg(CodeBuffer* buffer, X64Register reg);
+static void emitJcc(CodeBuffer* buffer, uint8_t condition, int32_t offset);
 static void emitPushReg(CodeBuffer* buffer, X64Register reg);
 static void emitPopReg(CodeBuffer* buffer, X64Register reg);
 static void emitRet(CodeBuffer* buffer);
-static void emitCallImm(CodeBuffer* buffer, void* target);
+static void emitCallAbsolute(CodeBuffer* buffer, void* target);
+static void emitVzeroupper(CodeBuffer* buffer);
 
 // Helper functions for immediate values
 static void emitAddRegImm32(CodeBuffer* buffer, X64Register reg, int32_t imm);
@@ -80,24 +108,21 @@ static void emitAddsdRegReg(CodeBuffer* buffer, X64Register dst, X64Register src
 static void emitSubsdRegReg(CodeBuffer* buffer, X64Register dst, X64Register src);
 static void emitMulsdRegReg(CodeBuffer* buffer, X64Register dst, X64Register src);
 static void emitDivsdRegReg(CodeBuffer* buffer, X64Register dst, X64Register src);
+static void emitMovqXmmReg(CodeBuffer* buffer, X64Register dst, X64Register src);
+static void emitUcomisdRegReg(CodeBuffer* buffer, X64Register reg1, X64Register reg2);
+static void emitMovapdRegReg(CodeBuffer* buffer, X64Register dst, X64Register src);
+static void emitXorpdRegReg(CodeBuffer* buffer, X64Register dst, X64Register src);
 
 // Bytecode compilation
-static bool compileFunctionToNative(ObjClosure* closure, CodeBuffer* buffer);
-static bool compileInstruction(CodeBuffer* buffer, uint8_t** ip, Chunk* chunk);
+static bool compileFunctionToNative(ObjClosure* closure, CodeBuffer* buffer, bool specialize,
+                                    JitEntry** entries, int* entryCount,
+                                    LiveInterval** intervals, int* intervalCount);
 
 // VM stack operations (efficient)
 static void emitVMPush(CodeBuffer* buffer, X64Register valueReg) {
-    // vm->stackTop[0] = value; vm->stackTop++;
+    // stackTop[0] = value; stackTop++;
     emitMovMemReg(buffer, STACK_REG, 0, valueReg);
     emitAddRegImm32(buffer, STACK_REG, 8);
-    emitMovMemReg(buffer, VM_REG, offsetof(VM, stackTop), STACK_REG);
-}
-
-static void emitVMPop(CodeBuffer* buffer, X64Register valueReg) {
-    // vm->stackTop--; value = vm->stackTop[0];
-    emitSubRegImm32(buffer, STACK_REG, 8);
-    emitMovMemReg(buffer, VM_REG, offsetof(VM, stackTop), STACK_REG);
-    emitMovRegMem(buffer, valueReg, STACK_REG, 0);
 }
 
 static void emitVMPeek(CodeBuffer* buffer, X64Register valueReg, int distance) {
@@ -119,15 +144,28 @@ static void emitFunctionPrologue(CodeBuffer* buffer) {
     emitPushReg(buffer, R14);
     emitPushReg(buffer, R15);
     
-    // Cache VM stack pointer in R12
+    // The pushes and the return address leave the stack 8 bytes short of
+    // the 16-byte alignment calls out expect
+    emitSubRegImm32(buffer, RSP, 8);
+    
+    // Load the registers kept for the whole call (VM in RDI, frame in RSI)
+    emitMovRegReg(buffer, VM_REG, RDI);
+    emitMovRegReg(buffer, FRAME_REG, RSI);
     emitMovRegMem(buffer, STACK_REG, VM_REG, offsetof(VM, stackTop));
+    emitMovRegMem(buffer, SLOTS_REG, FRAME_REG, offsetof(CallFrame, slots));
+    emitMovReg32Mem(buffer, DEPTH_REG, VM_REG, offsetof(VM, frameCount));
+    emitVzeroupper(buffer);
+    
+    // Start at the entry point passed in RDX
+    emitJmpReg(buffer, RDX);
 }
 
-static void emitFunctionEpilogue(CodeBuffer* buffer) {
+static void emitFunctionEpilogue(CodeBuffer* buffer, InterpretResult result) {
     // Update VM stack pointer
     emitMovMemReg(buffer, VM_REG, offsetof(VM, stackTop), STACK_REG);
     
     // Restore callee-saved registers
+    emitAddRegImm32(buffer, RSP, 8);
     emitPopReg(buffer, R15);
     emitPopReg(buffer, R14);
     emitPopReg(buffer, R13);
@@ -138,8 +176,7 @@ static void emitFunctionEpilogue(CodeBuffer* buffer) {
     emitMovRegReg(buffer, RSP, RBP);
     emitPopReg(buffer, RBP);
     
-    // Return INTERPRET_OK
-    emitMovRegImm64(buffer, RAX, INTERPRET_OK);
+    emitMovRegImm64(buffer, RAX, result);
     emitRet(buffer);
 }
 
@@ -189,14 +226,23 @@ void initJIT() {
     jitContext.enabled = false;  // JIT is now off by default
     jitContext.hotSpots = NULL;
     jitContext.compiledFunctions = NULL;
+    jitContext.codeArenas = NULL;
     jitContext.blacklistedFunctions = NULL;
-    jitContext.defaultOptLevel = JIT_OPT_BASIC;
+    jitContext.defaultOptLevel = JIT_OPT_ADVANCED;
     jitContext.totalCompilations = 0;
     jitContext.totalExecutions = 0;
     jitContext.totalOptimizations = 0;
+    jitContext.totalSideExits = 0;
+    jitContext.totalOsrEntries = 0;
     jitContext.totalCompileTime = 0.0;
     jitContext.totalExecutionTime = 0.0;
     jitContext.allocator = NULL;
+    jitContext.stackBase = (uintptr_t)__builtin_frame_address(0);
+#if defined(__x86_64__)
+    jitContext.hasAvx = __builtin_cpu_supports("avx");
+#else
+    jitContext.hasAvx = false;
+#endif
     
     // No output for performance
 }
@@ -214,13 +260,21 @@ void freeJIT() {
     JitFunction* function = jitContext.compiledFunctions;
     while (function != NULL) {
         JitFunction* next = function->next;
-        if (function->nativeCode != NULL) {
-            munmap((void*)function->nativeCode, function->codeSize);
-        }
+        free(function->entries);
+        free(function->intervals);
         FREE(JitFunction, function);
         function = next;
     }
     
+    CodeArena* arena = jitContext.codeArenas;
+    while (arena != NULL) {
+        CodeArena* next = arena->next;
+        munmap(arena->base, arena->size);
+        free(arena);
+        arena = next;
+    }
+    jitContext.codeArenas = NULL;
+    
     // Free blacklisted functions
     BlacklistedFunction* blacklisted = jitContext.blacklistedFunctions;
     while (blacklisted != NULL) {
@@ -240,54 +294,81 @@ void freeJIT() {
     // No output for performance
 }
 
+static HotSpot* newHotSpot(uint8_t* bytecode, bool isFunction) {
+    HotSpot* hotSpot = ALLOCATE(HotSpot, 1);
+    if (hotSpot == NULL) return NULL;
+    
+    hotSpot->bytecode = bytecode;
+    hotSpot->hitCount = 1;
+    hotSpot->backEdgeCount = 0;
+    hotSpot->isFunction = isFunction;
+    hotSpot->isLoop = false;
+    hotSpot->optLevel = JIT_OPT_NONE;
+    hotSpot->next = jitContext.hotSpots;
+    jitContext.hotSpots = hotSpot;
+    return hotSpot;
+}
+
+static void countFunctionHit(HotSpot* hotSpot) {
+    hotSpot->hitCount++;
+    
+    // Promote hot spot if it gets hot enough
+    if (hotSpot->hitCount >= JIT_HOT_THRESHOLD && hotSpot->optLevel == JIT_OPT_NONE) {
+        promoteHotSpot(hotSpot);
+    }
+}
+
 void trackHotSpot(uint8_t* bytecode, bool isFunction) {
     if (!jitContext.enabled) return;
     
     HotSpot* hotSpot = findHotSpot(bytecode);
     if (hotSpot == NULL) {
-        hotSpot = ALLOCATE(HotSpot, 1);
-        if (hotSpot == NULL) return;
-        
-        hotSpot->bytecode = bytecode;
-        hotSpot->hitCount = 1;
-        hotSpot->isFunction = isFunction;
-        hotSpot->isLoop = false;
-        hotSpot->optLevel = JIT_OPT_NONE;
-        hotSpot->next = jitContext.hotSpots;
-        jitContext.hotSpots = hotSpot;
+        newHotSpot(bytecode, isFunction);
     } else {
-        hotSpot->hitCount++;
-        
-        // Promote hot spot if it gets hot enough
-        if (hotSpot->hitCount >= JIT_HOT_THRESHOLD && hotSpot->optLevel == JIT_OPT_NONE) {
-            promoteHotSpot(hotSpot);
-        }
+        countFunctionHit(hotSpot);
     }
 }
 
-void trackLoopBackEdge(uint8_t* bytecode) {
-    if (!jitContext.enabled) return;
+JitFunction* trackFunctionCall(ObjClosure* closure) {
+    if (!jitContext.enabled) return NULL;
     
-    HotSpot* hotSpot = findHotSpot(bytecode);
-    if (hotSpot == NULL) {
-        hotSpot = ALLOCATE(HotSpot, 1);
-        if (hotSpot == NULL) return;
+    // The hot spot and compiled code hang off the function itself, so a
+    // call costs the same however many functions the program has.
+    ObjFunction* function = closure->function;
+    if (function->hotSpot == NULL) {
+        function->hotSpot = newHotSpot(function->chunk.code, true);
+        return function->jitFunction;
+    }
+    
+    countFunctionHit(function->hotSpot);
+    if (function->jitFunction == NULL && !function->jitBlacklisted &&
+        function->hotSpot->hitCount >= JIT_HOT_THRESHOLD) {
+        compileFunction(closure);
+    }
+    return function->jitFunction;
+}
+
+JitFunction* trackLoopBackEdge(ObjClosure* closure) {
+    if (!jitContext.enabled) return NULL;
+    
+    // Back-edges are counted per function rather than per loop. Compiling
+    // the function gives every loop in it an entry, so whichever loop got
+    // hot carries on in compiled code from its header.
+    ObjFunction* function = closure->function;
+    if (function->jitBlacklisted) return NULL;
+    if (function->jitFunction == NULL) {
+        if (function->hotSpot == NULL) {
+            function->hotSpot = newHotSpot(function->chunk.code, true);
+            if (function->hotSpot == NULL) return NULL;
+        }
         
-        hotSpot->bytecode = bytecode;
-        hotSpot->hitCount = 1;
-        hotSpot->isFunction = false;
+        HotSpot* hotSpot = function->hotSpot;
         hotSpot->isLoop = true;
-        hotSpot->optLevel = JIT_OPT_NONE;
-        hotSpot->next = jitContext.hotSpots;
-        jitContext.hotSpots = hotSpot;
-    } else {
-        hotSpot->hitCount++;
-        
-        // Loops get promoted faster
-        if (hotSpot->hitCount >= JIT_HOT_LOOP_THRESHOLD && hotSpot->optLevel == JIT_OPT_NONE) {
-            promoteHotSpot(hotSpot);
-        }
+        if (++hotSpot->backEdgeCount < JIT_HOT_LOOP_THRESHOLD) return NULL;
+        promoteHotSpot(hotSpot);
+        compileFunction(closure);
     }
+    return function->jitFunction;
 }
 
 bool isHotSpot(uint8_t* bytecode) {
@@ -355,48 +436,76 @@ JitFunction* compileFunction(ObjClosure* closure) {
 JitFunction* compileFunctionWithOptLevel(ObjClosure* closure, JitOptLevel optLevel) {
     if (!jitContext.enabled || closure == NULL) return NULL;
     
-    if (isBlacklisted(closure->function->chunk.code)) {
+    if (closure->function->jitBlacklisted) {
         return NULL;
     }
     
     startJitTimer();
     
-    CodeBuffer* buffer = createCodeBuffer(4096);
+    // Room for the largest translation of every instruction
+    size_t capacity = (size_t)closure->function->chunk.count * JIT_CODE_PER_BYTE + 512;
+    CodeBuffer* buffer = createCodeBuffer(capacity);
     if (buffer == NULL) return NULL;
     
     // No debug output for performance
     
-    if (!compileFunctionToNative(closure, buffer)) {
+    // Advanced code is specialized for the function's number locals, when
+    // it has any the compiler could type
+    uint8_t* code = NULL;
+    JitEntry* entries = NULL;
+    int entryCount = 0;
+    LiveInterval* intervals = NULL;
+    int intervalCount = 0;
+    if (compileFunctionToNative(closure, buffer, optLevel >= JIT_OPT_ADVANCED,
+                                &entries, &entryCount, &intervals, &intervalCount)) {
+        code = installCode(buffer);
+    }
+    if (intervals == NULL && optLevel > JIT_OPT_BASIC) optLevel = JIT_OPT_BASIC;
+    if (code == NULL) {
+        free(entries);
+        free(intervals);
         freeCodeBuffer(buffer);
         addToBlacklist(closure->function->chunk.code);
+        closure->function->jitBlacklisted = true;
         return NULL;
     }
     
     JitFunction* jitFunc = ALLOCATE(JitFunction, 1);
     if (jitFunc == NULL) {
+        free(entries);
+        free(intervals);
         freeCodeBuffer(buffer);
         return NULL;
     }
     
     jitFunc->bytecodeStart = closure->function->chunk.code;
     jitFunc->bytecodeEnd = closure->function->chunk.code + closure->function->chunk.count;
-    jitFunc->nativeCode = (JitCompiledFn)buffer->code;
+    jitFunc->nativeCode = (JitCompiledFn)code;
     jitFunc->codeSize = buffer->size;
+    jitFunc->entries = entries;
+    jitFunc->entryCount = entryCount;
     jitFunc->callCount = 0;
     jitFunc->optLevel = optLevel;
     jitFunc->avgExecutionTime = 0.0;
     jitFunc->isInlined = false;
     jitFunc->paramCount = closure->function->arity;
     jitFunc->localCount = 0;
+    jitFunc->intervals = intervals;
+    jitFunc->intervalCount = intervalCount;
+    jitFunc->spillCount = 0;
+    for (int i = 0; i < intervalCount; i++) {
+        if (intervals[i].reg < 0) jitFunc->spillCount++;
+    }
     
     jitFunc->next = jitContext.compiledFunctions;
     jitContext.compiledFunctions = jitFunc;
+    closure->function->jitFunction = jitFunc;
     
     jitContext.totalCompilations++;
     double compileTime = stopJitTimer();
     jitContext.totalCompileTime += compileTime;
     
-    free(buffer);
+    freeCodeBuffer(buffer);
     return jitFunc;
 }
 
@@ -405,84 +514,123 @@ InterpretResult executeJitFunction(JitFunction* function, VM* vm, CallFrame* fra
         return INTERPRET_RUNTIME_ERROR;
     }
     
+    // Compiled code nests on the C stack for each call it makes into other
+    // compiled code. Past the limit, the frame is left to the interpreter.
+    uintptr_t depth = jitContext.stackBase - (uintptr_t)__builtin_frame_address(0);
+    if (depth > JIT_MAX_NATIVE_STACK) return INTERPRET_OK;
+    
+    // Calls start at the top. Anywhere else is a loop the interpreter has
+    // been running, entered at its header.
+    JitEntry* entry = &function->entries[0];
+    int offset = (int)(frame->ip - function->bytecodeStart);
+    if (offset != 0) {
+        entry = NULL;
+        for (int i = 1; i < function->entryCount; i++) {
+            if (function->entries[i].bytecodeOffset == offset) {
+                entry = &function->entries[i];
+                break;
+            }
+        }
+        if (entry == NULL) return INTERPRET_OK;
+        jitContext.totalOsrEntries++;
+    }
+    
     function->callCount++;
     jitContext.totalExecutions++;
-    
-    struct timeval start, end;
-    gettimeofday(&start, NULL);
-    
-    InterpretResult result = function->nativeCode(vm, frame);
-    
-    gettimeofday(&end, NULL);
-    double executionTime = (end.tv_sec - start.tv_sec) * 1000000.0 + (end.tv_usec - start.tv_usec);
-    updateExecutionStats(function, executionTime);
-    
-    return result;
+    return function->nativeCode(vm, frame, (uint8_t*)function->nativeCode + entry->nativeOffset);
 }
 
-// Register allocation (simplified for performance)
-void initRegisterAllocator(RegisterAllocator* allocator) {
+// Register allocation
+//
+// Linear scan over live intervals: each interval, in order of its start,
+// takes a register freed by one that has already ended. When none is
+// free, whichever interval ends last gives up its register and stays in
+// its stack slot, as it would have kept the register longest.
+void initRegisterAllocator(RegisterAllocator* allocator, int registerCount) {
     for (int i = 0; i < JIT_MAX_REGISTERS; i++) {
         allocator->registers[i].state = REG_FREE;
-        allocator->registers[i].value = NIL_VAL;
+        allocator->registers[i].interval = -1;
         allocator->registers[i].lastUse = -1;
-        allocator->registers[i].isDirty = false;
     }
-    allocator->nextSpillSlot = 0;
+    allocator->registerCount = registerCount < JIT_MAX_REGISTERS ? registerCount : JIT_MAX_REGISTERS;
+    allocator->spillCount = 0;
     allocator->currentInstruction = 0;
 }
 
-int allocateRegister(RegisterAllocator* allocator, Value value) {
-    for (int i = 0; i < JIT_MAX_REGISTERS; i++) {
-        if (allocator->registers[i].state == REG_FREE) {
-            allocator->registers[i].state = REG_ALLOCATED;
-            allocator->registers[i].value = value;
-            allocator->registers[i].lastUse = allocator->currentInstruction;
-            allocator->registers[i].isDirty = false;
-            return i;
+// Returns the register given to `interval`, which runs from the current
+// instruction to `end`, or -1 if every register is still in use
+int allocateRegister(RegisterAllocator* allocator, int interval, int end) {
+    for (int i = 0; i < allocator->registerCount; i++) {
+        RegisterInfo* info = &allocator->registers[i];
+        if (info->state == REG_ALLOCATED && info->lastUse < allocator->currentInstruction) {
+            freeRegister(allocator, i);
         }
     }
     
-    int spillReg = findBestRegisterToSpill(allocator);
-    spillRegister(allocator, spillReg);
-    
-    allocator->registers[spillReg].state = REG_ALLOCATED;
-    allocator->registers[spillReg].value = value;
-    allocator->registers[spillReg].lastUse = allocator->currentInstruction;
-    allocator->registers[spillReg].isDirty = false;
-    
-    return spillReg;
+    for (int i = 0; i < allocator->registerCount; i++) {
+        RegisterInfo* info = &allocator->registers[i];
+        if (info->state == REG_FREE) {
+            info->state = REG_ALLOCATED;
+            info->interval = interval;
+            info->lastUse = end;
+            return i;
+        }
+    }
+    return -1;
 }
 
 void freeRegister(RegisterAllocator* allocator, int reg) {
-    if (reg >= 0 && reg < JIT_MAX_REGISTERS) {
+    if (reg >= 0 && reg < allocator->registerCount) {
         allocator->registers[reg].state = REG_FREE;
-        allocator->registers[reg].value = NIL_VAL;
-        allocator->registers[reg].isDirty = false;
+        allocator->registers[reg].interval = -1;
+        allocator->registers[reg].lastUse = -1;
     }
 }
 
+// Sends the interval in `reg` to its stack slot, freeing the register
 void spillRegister(RegisterAllocator* allocator, int reg) {
-    if (reg >= 0 && reg < JIT_MAX_REGISTERS) {
-        allocator->registers[reg].state = REG_SPILLED;
-        allocator->nextSpillSlot++;
+    if (reg >= 0 && reg < allocator->registerCount &&
+        allocator->registers[reg].state == REG_ALLOCATED) {
+        freeRegister(allocator, reg);
+        allocator->spillCount++;
     }
 }
 
+// The register whose interval ends last, or -1 if none is in use
 int findBestRegisterToSpill(RegisterAllocator* allocator) {
-    int bestReg = 0;
-    int oldestUse = allocator->registers[0].lastUse;
-    
-    for (int i = 1; i < JIT_MAX_REGISTERS; i++) {
-        if (allocator->registers[i].lastUse < oldestUse) {
-            oldestUse = allocator->registers[i].lastUse;
+    int bestReg = -1;
+    int latestUse = -1;
+    for (int i = 0; i < allocator->registerCount; i++) {
+        RegisterInfo* info = &allocator->registers[i];
+        if (info->state == REG_ALLOCATED && info->lastUse > latestUse) {
+            latestUse = info->lastUse;
             bestReg = i;
         }
     }
-    
     return bestReg;
 }
 
+// Sets each interval's register, or -1 for one left in its slot. The
+// intervals must be sorted by start.
+void allocateRegisters(RegisterAllocator* allocator, LiveInterval* intervals, int count) {
+    for (int i = 0; i < count; i++) {
+        LiveInterval* interval = &intervals[i];
+        allocator->currentInstruction = interval->start;
+        int reg = allocateRegister(allocator, i, interval->end);
+        if (reg < 0) {
+            int victim = findBestRegisterToSpill(allocator);
+            if (victim >= 0 && allocator->registers[victim].lastUse > interval->end) {
+                intervals[allocator->registers[victim].interval].reg = -1;
+                spillRegister(allocator, victim);
+                reg = allocateRegister(allocator, i, interval->end);
+            } else {
+                allocator->spillCount++;
+            }
+        }
+        interval->reg = reg;
+    }
+}
+
 // Performance monitoring
 void startJitTimer() {
     gettimeofday(&jitStartTime, NULL);
@@ -518,19 +666,15 @@ void printJitStats() {
     printf("Total Compilations: %d\n", jitContext.totalCompilations);
     printf("Total Executions: %d\n", jitContext.totalExecutions);
     printf("Total Optimizations: %d\n", jitContext.totalOptimizations);
+    printf("Side Exits: %d\n", jitContext.totalSideExits);
+    printf("OSR Entries: %d\n", jitContext.totalOsrEntries);
     printf("Total Compile Time: %.2f ms\n", jitContext.totalCompileTime / 1000.0);
-    printf("Total Execution Time Saved: %.2f ms\n", jitContext.totalExecutionTime / 1000.0);
     
     if (jitContext.totalCompilations > 0) {
         printf("Average Compile Time: %.2f ms\n", 
                (jitContext.totalCompileTime / jitContext.totalCompilations) / 1000.0);
     }
     
-    if (jitContext.totalExecutions > 0) {
-        printf("Average Execution Time: %.2f μs\n", 
-               jitContext.totalExecutionTime / jitContext.totalExecutions);
-    }
-    
     // Count hot spots
     int hotSpotCount = 0;
     HotSpot* hotSpot = jitContext.hotSpots;
@@ -596,19 +740,23 @@ void printDetailedJitStats() {
 }
 
 // Code buffer management
+//
+// Functions are compiled into a scratch buffer and then copied into an
+// arena. The code only refers to itself through relative jumps, so it
+// runs wherever it lands.
 static CodeBuffer* createCodeBuffer(size_t capacity) {
     CodeBuffer* buffer = malloc(sizeof(CodeBuffer));
     if (buffer == NULL) return NULL;
     
-    buffer->code = mmap(NULL, capacity, PROT_READ | PROT_WRITE | PROT_EXEC,
-                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
-    if (buffer->code == MAP_FAILED) {
+    buffer->code = malloc(capacity);
+    if (buffer->code == NULL) {
         free(buffer);
         return NULL;
     }
     
     buffer->size = 0;
     buffer->capacity = capacity;
+    buffer->full = false;
     
     return buffer;
 }
@@ -616,16 +764,54 @@ static CodeBuffer* createCodeBuffer(size_t capacity) {
 static void freeCodeBuffer(CodeBuffer* buffer) {
     if (buffer == NULL) return;
     
-    if (buffer->code != NULL && buffer->code != MAP_FAILED) {
-        munmap(buffer->code, buffer->capacity);
-    }
+    free(buffer->code);
     free(buffer);
 }
 
+// Copies the finished code into executable memory and returns where it
+// went, or NULL. Arena pages are writable only while code is copied in.
+static uint8_t* installCode(CodeBuffer* buffer) {
+    size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+    size_t size = (buffer->size + 15) & ~(size_t)15;
+    
+    CodeArena* arena = jitContext.codeArenas;
+    if (arena == NULL || arena->size - arena->used < size) {
+        arena = malloc(sizeof(CodeArena));
+        if (arena == NULL) return NULL;
+        arena->size = size > JIT_CODE_ARENA_SIZE ? size : JIT_CODE_ARENA_SIZE;
+        arena->size = (arena->size + pageSize - 1) & ~(pageSize - 1);
+        arena->base = mmap(NULL, arena->size, PROT_READ | PROT_EXEC,
+                           MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (arena->base == MAP_FAILED) {
+            free(arena);
+            return NULL;
+        }
+        arena->used = 0;
+        arena->next = jitContext.codeArenas;
+        jitContext.codeArenas = arena;
+    }
+    
+    uint8_t* code = arena->base + arena->used;
+    uint8_t* first = (uint8_t*)((uintptr_t)code & ~(uintptr_t)(pageSize - 1));
+    size_t span = (size_t)(code + buffer->size - first);
+    if (mprotect(first, span, PROT_READ | PROT_WRITE) != 0) return NULL;
+    memcpy(code, buffer->code, buffer->size);
+    if (mprotect(first, span, PROT_READ | PROT_EXEC) != 0) return NULL;
+    
+    arena->used += size;
+    return code;
+}
+
 static void emitByte(CodeBuffer* buffer, uint8_t byte) {
     if (buffer->size >= buffer->capacity) {
-        // Buffer overflow - should not happen with proper sizing
-        return;
+        // The scratch buffer grows; a full one means the code is dropped
+        uint8_t* code = realloc(buffer->code, buffer->capacity * 2);
+        if (code == NULL) {
+            buffer->full = true;
+            return;
+        }
+        buffer->code = code;
+        buffer->capacity *= 2;
     }
     buffer->code[buffer->size++] = byte;
 }
@@ -659,6 +845,29 @@ static void emitModRM(CodeBuffer* buffer, uint8_t mod, uint8_t reg, uint8_t rm)
     emitByte(buffer, (mod << 6) | ((reg & 7) << 3) | (rm & 7));
 }
 
+// The ModRM byte and displacement for [base + offset]. RSP and R12 as a
+// base need a SIB byte, and RBP and R13 have no form without displacement.
+static void emitMemOperand(CodeBuffer* buffer, uint8_t reg, X64Register base, int32_t offset) {
+    uint8_t mod;
+    if (offset == 0 && (base & 7) != RBP) {
+        mod = 0;
+    } else if (offset >= -128 && offset <= 127) {
+        mod = 1;
+    } else {
+        mod = 2;
+    }
+    
+    emitModRM(buffer, mod, reg, base);
+    if ((base & 7) == RSP) {
+        emitByte(buffer, 0x24);  // SIB: base only, no index
+    }
+    if (mod == 1) {
+        emitByte(buffer, offset & 0xFF);
+    } else if (mod == 2) {
+        emitInt32(buffer, offset);
+    }
+}
+
 // Essential x86-64 instruction emitters
 static void emitMovRegImm64(CodeBuffer* buffer, X64Register reg, int64_t imm) {
     // mov reg, imm64 (REX.W + B8+ rd io)
@@ -678,67 +887,86 @@ static void emitMovRegMem(CodeBuffer* buffer, X64Register reg, X64Register base,
     // mov reg, [base + offset] (REX.W + 8B /r)
     emitRex(buffer, true, reg, 0, base);
     emitByte(buffer, 0x8B);
-    
-    if (offset == 0 && (base & 7) != RBP) {
-        emitModRM(buffer, 0, reg, base);
-    } else if (offset >= -128 && offset <= 127) {
-        emitModRM(buffer, 1, reg, base);
-        emitByte(buffer, offset & 0xFF);
-    } else {
-        emitModRM(buffer, 2, reg, base);
-        emitInt32(buffer, offset);
-    }
+    emitMemOperand(buffer, reg, base, offset);
 }
 
 static void emitMovMemReg(CodeBuffer* buffer, X64Register base, int32_t offset, X64Register reg) {
     // mov [base + offset], reg (REX.W + 89 /r)
     emitRex(buffer, true, reg, 0, base);
     emitByte(buffer, 0x89);
-    
-    if (offset == 0 && (base & 7) != RBP) {
-        emitModRM(buffer, 0, reg, base);
-    } else if (offset >= -128 && offset <= 127) {
-        emitModRM(buffer, 1, reg, base);
-        emitByte(buffer, offset & 0xFF);
-    } else {
-        emitModRM(buffer, 2, reg, base);
-        emitInt32(buffer, offset);
-    }
+    emitMemOperand(buffer, reg, base, offset);
 }
 
-static void emitAddRegReg(CodeBuffer* buffer, X64Register dst, X64Register src) {
-    // add dst, src (REX.W + 01 /r)
+static void emitCmpRegReg(CodeBuffer* buffer, X64Register reg1, X64Register reg2) {
+    // cmp reg1, reg2 (REX.W + 39 /r)
+    emitRex(buffer, true, reg2, 0, reg1);
+    emitByte(buffer, 0x39);
+    emitModRM(buffer, 3, reg2, reg1);
+}
+
+static void emitXorRegReg(CodeBuffer* buffer, X64Register dst, X64Register src) {
+    // xor dst, src (REX.W + 31 /r)
     emitRex(buffer, true, src, 0, dst);
-    emitByte(buffer, 0x01);
+    emitByte(buffer, 0x31);
     emitModRM(buffer, 3, src, dst);
 }
 
-static void emitSubRegReg(CodeBuffer* buffer, X64Register dst, X64Register src) {
-    // sub dst, src (REX.W + 29 /r)
+static void emitAndRegReg(CodeBuffer* buffer, X64Register dst, X64Register src) {
+    // and dst, src (REX.W + 21 /r)
     emitRex(buffer, true, src, 0, dst);
-    emitByte(buffer, 0x29);
+    emitByte(buffer, 0x21);
     emitModRM(buffer, 3, src, dst);
 }
 
-static void emitCmpRegReg(CodeBuffer* buffer, X64Register reg1, X64Register reg2) {
-    // cmp reg1, reg2 (REX.W + 39 /r)
-    emitRex(buffer, true, reg2, 0, reg1);
+static void emitTestReg32(CodeBuffer* buffer, X64Register reg) {
+    // test reg32, reg32 (85 /r)
+    emitRex(buffer, false, reg, 0, reg);
+    emitByte(buffer, 0x85);
+    emitModRM(buffer, 3, reg, reg);
+}
+
+static void emitMovReg32Mem(CodeBuffer* buffer, X64Register reg, X64Register base, int32_t offset) {
+    // mov reg32, [base + offset] (8B /r)
+    emitRex(buffer, false, reg, 0, base);
+    emitByte(buffer, 0x8B);
+    emitMemOperand(buffer, reg, base, offset);
+}
+
+static void emitCmpMem32Reg(CodeBuffer* buffer, X64Register base, int32_t offset, X64Register reg) {
+    // cmp dword [base + offset], reg32 (39 /r)
+    emitRex(buffer, false, reg, 0, base);
     emitByte(buffer, 0x39);
-    emitModRM(buffer, 3, reg2, reg1);
+    emitMemOperand(buffer, reg, base, offset);
 }
 
-static void emitJe(CodeBuffer* buffer, int32_t offset) {
-    // je offset (0F 84 cd)
-    emitByte(buffer, 0x0F);
-    emitByte(buffer, 0x84);
-    emitInt32(buffer, offset);
+static void emitCmpMem32Imm8(CodeBuffer* buffer, X64Register base, int32_t offset, int8_t imm) {
+    // cmp dword [base + offset], imm8 (83 /7 ib)
+    emitRex(buffer, false, 0, 0, base);
+    emitByte(buffer, 0x83);
+    emitMemOperand(buffer, 7, base, offset);
+    emitByte(buffer, (uint8_t)imm);
 }
 
-static void emitJne(CodeBuffer* buffer, int32_t offset) {
-    // jne offset (0F 85 cd)
-    emitByte(buffer, 0x0F);
-    emitByte(buffer, 0x85);
-    emitInt32(buffer, offset);
+static void emitCmpMemImm8(CodeBuffer* buffer, X64Register base, int32_t offset, int8_t imm) {
+    // cmp qword [base + offset], imm8 (REX.W + 83 /7 ib)
+    emitRex(buffer, true, 0, 0, base);
+    emitByte(buffer, 0x83);
+    emitMemOperand(buffer, 7, base, offset);
+    emitByte(buffer, (uint8_t)imm);
+}
+
+static void emitDecMem32(CodeBuffer* buffer, X64Register base, int32_t offset) {
+    // dec dword [base + offset] (FF /1)
+    emitRex(buffer, false, 0, 0, base);
+    emitByte(buffer, 0xFF);
+    emitMemOperand(buffer, 1, base, offset);
+}
+
+static void emitIncMem32(CodeBuffer* buffer, void* address) {
+    // mov rax, address; inc dword [rax] (FF /0)
+    emitMovRegImm64(buffer, RAX, (int64_t)address);
+    emitByte(buffer, 0xFF);
+    emitModRM(buffer, 0, 0, RAX);
 }
 
 static void emitJmp(CodeBuffer* buffer, int32_t offset) {
@@ -747,6 +975,20 @@ static void emitJmp(CodeBuffer* buffer, int32_t offset) {
     emitInt32(buffer, offset);
 }
 
+static void emitJmpReg(CodeBuffer* buffer, X64Register reg) {
+    // jmp reg (FF /4)
+    emitRex(buffer, false, 0, 0, reg);
+    emitByte(buffer, 0xFF);
+    emitModRM(buffer, 3, 4, reg);
+}
+
+static void emitJcc(CodeBuffer* buffer, uint8_t condition, int32_t offset) {
+    // jcc offset (0F 80+cc cd)
+    emitByte(buffer, 0x0F);
+    emitByte(buffer, 0x80 | condition);
+    emitInt32(buffer, offset);
+}
+
 static void emitPushReg(CodeBuffer* buffer, X64Register reg) {
     // push reg (50+ rd)
     if (reg >= R8) {
@@ -768,12 +1010,22 @@ static void emitRet(CodeBuffer* buffer) {
     emitByte(buffer, 0xC3);
 }
 
-static void emitCallImm(CodeBuffer* buffer, void* target) {
-    // call target (E8 cd)
-    emitByte(buffer, 0xE8);
-    // Calculate relative offset from next instruction
-    int64_t offset = (int64_t)target - (int64_t)(buffer->code + buffer->size + 4);
-    emitInt32(buffer, (int32_t)offset);
+static void emitCallAbsolute(CodeBuffer* buffer, void* target) {
+    // mov rax, target; call rax (FF /2). The code buffer can be mapped
+    // anywhere, out of reach of a rel32 call.
+    emitMovRegImm64(buffer, RAX, (int64_t)target);
+    emitByte(buffer, 0xFF);
+    emitModRM(buffer, 3, 2, RAX);
+}
+
+static void emitVzeroupper(CodeBuffer* buffer) {
+    // vzeroupper (C5 F8 77). C code that leaves the upper halves of the
+    // ymm registers dirty makes every legacy SSE instruction on xmm8-xmm15
+    // wait on them, so compiled code clears them whenever it gets control.
+    if (!jitContext.hasAvx) return;
+    emitByte(buffer, 0xC5);
+    emitByte(buffer, 0xF8);
+    emitByte(buffer, 0x77);
 }
 
 // SSE floating point instructions (simplified)
@@ -783,16 +1035,7 @@ static void emitMovsdRegMem(CodeBuffer* buffer, X64Register reg, X64Register bas
     emitRex(buffer, false, reg, 0, base);
     emitByte(buffer, 0x0F);
     emitByte(buffer, 0x10);
-    
-    if (offset == 0 && (base & 7) != RBP) {
-        emitModRM(buffer, 0, reg, base);
-    } else if (offset >= -128 && offset <= 127) {
-        emitModRM(buffer, 1, reg, base);
-        emitByte(buffer, offset & 0xFF);
-    } else {
-        emitModRM(buffer, 2, reg, base);
-        emitInt32(buffer, offset);
-    }
+    emitMemOperand(buffer, reg, base, offset);
 }
 
 static void emitMovsdMemReg(CodeBuffer* buffer, X64Register base, int32_t offset, X64Register reg) {
@@ -801,266 +1044,1221 @@ static void emitMovsdMemReg(CodeBuffer* buffer, X64Register base, int32_t offset
     emitRex(buffer, false, reg, 0, base);
     emitByte(buffer, 0x0F);
     emitByte(buffer, 0x11);
-    
-    if (offset == 0 && (base & 7) != RBP) {
-        emitModRM(buffer, 0, reg, base);
-    } else if (offset >= -128 && offset <= 127) {
-        emitModRM(buffer, 1, reg, base);
-        emitByte(buffer, offset & 0xFF);
-    } else {
-        emitModRM(buffer, 2, reg, base);
-        emitInt32(buffer, offset);
-    }
+    emitMemOperand(buffer, reg, base, offset);
 }
 
 static void emitAddsdRegReg(CodeBuffer* buffer, X64Register dst, X64Register src) {
-    // addsd xmm_dst, xmm_src (F2 0F 58 /r)
+    // addsd xmm_dst, xmm_src (F2 REX 0F 58 /r)
     emitByte(buffer, 0xF2);
+    emitRex(buffer, false, dst, 0, src);
     emitByte(buffer, 0x0F);
     emitByte(buffer, 0x58);
     emitModRM(buffer, 3, dst, src);
 }
 
 static void emitSubsdRegReg(CodeBuffer* buffer, X64Register dst, X64Register src) {
-    // subsd xmm_dst, xmm_src (F2 0F 5C /r)
+    // subsd xmm_dst, xmm_src (F2 REX 0F 5C /r)
     emitByte(buffer, 0xF2);
+    emitRex(buffer, false, dst, 0, src);
     emitByte(buffer, 0x0F);
     emitByte(buffer, 0x5C);
     emitModRM(buffer, 3, dst, src);
 }
 
 static void emitMulsdRegReg(CodeBuffer* buffer, X64Register dst, X64Register src) {
-    // mulsd xmm_dst, xmm_src (F2 0F 59 /r)
+    // mulsd xmm_dst, xmm_src (F2 REX 0F 59 /r)
     emitByte(buffer, 0xF2);
+    emitRex(buffer, false, dst, 0, src);
     emitByte(buffer, 0x0F);
     emitByte(buffer, 0x59);
     emitModRM(buffer, 3, dst, src);
 }
 
 static void emitDivsdRegReg(CodeBuffer* buffer, X64Register dst, X64Register src) {
-    // divsd xmm_dst, xmm_src (F2 0F 5E /r)
+    // divsd xmm_dst, xmm_src (F2 REX 0F 5E /r)
     emitByte(buffer, 0xF2);
+    emitRex(buffer, false, dst, 0, src);
     emitByte(buffer, 0x0F);
     emitByte(buffer, 0x5E);
     emitModRM(buffer, 3, dst, src);
 }
 
-// Bytecode compilation - much more efficient implementation
-static bool compileFunctionToNative(ObjClosure* closure, CodeBuffer* buffer) {
-    Chunk* chunk = &closure->function->chunk;
-    
-    emitFunctionPrologue(buffer);
+static void emitMovqXmmReg(CodeBuffer* buffer, X64Register dst, X64Register src) {
+    // movq xmm_dst, src (66 REX.W 0F 6E /r)
+    emitByte(buffer, 0x66);
+    emitRex(buffer, true, dst, 0, src);
+    emitByte(buffer, 0x0F);
+    emitByte(buffer, 0x6E);
+    emitModRM(buffer, 3, dst, src);
+}
+
+static void emitUcomisdRegReg(CodeBuffer* buffer, X64Register reg1, X64Register reg2) {
+    // ucomisd xmm_reg1, xmm_reg2 (66 REX 0F 2E /r)
+    emitByte(buffer, 0x66);
+    emitRex(buffer, false, reg1, 0, reg2);
+    emitByte(buffer, 0x0F);
+    emitByte(buffer, 0x2E);
+    emitModRM(buffer, 3, reg1, reg2);
+}
+
+static void emitMovapdRegReg(CodeBuffer* buffer, X64Register dst, X64Register src) {
+    // movapd xmm_dst, xmm_src (66 REX 0F 28 /r)
+    emitByte(buffer, 0x66);
+    emitRex(buffer, false, dst, 0, src);
+    emitByte(buffer, 0x0F);
+    emitByte(buffer, 0x28);
+    emitModRM(buffer, 3, dst, src);
+}
+
+static void emitXorpdRegReg(CodeBuffer* buffer, X64Register dst, X64Register src) {
+    // xorpd xmm_dst, xmm_src (66 REX 0F 57 /r)
+    emitByte(buffer, 0x66);
+    emitRex(buffer, false, dst, 0, src);
+    emitByte(buffer, 0x0F);
+    emitByte(buffer, 0x57);
+    emitModRM(buffer, 3, dst, src);
+}
+
+// Bytecode compilation
+//
+// Every instruction gets its own native code, so any of them can be a
+// jump target, including the instructions a superinstruction leaves in
+// place. Loads, stores, number arithmetic and branches are translated
+// against the VM stack directly. Everything else is handed to the
+// interpreter one instruction at a time through runInstruction(), which
+// is how property access, invocation, closures, upvalues, indexing,
+// interpolation and module calls all run exactly as they do in run().
+//
+// After each of those steps the code checks that its frame is still on
+// top and that ip is where it expected. If not, the call has gone
+// somewhere only the interpreter can follow, such as into a function that
+// isn't compiled, and the code side-exits: it returns with the frame's ip
+// at the next instruction and run() carries on from there.
+
+#define JIT_TARGET_EXIT -1      // Leave the frame to run() at its ip
+#define JIT_TARGET_RETURN -2    // The frame has already returned
+#define JIT_TARGET_ERROR -3     // A runtime error has been reported
+
+// A rel32 operand to fill in once every instruction has been placed
+typedef struct {
+    size_t position;            // Where the rel32 sits in the buffer
+    int target;                 // Bytecode offset or JIT_TARGET_*
+} JumpFixup;
+
+typedef struct {
+    CodeBuffer* buffer;
+    Chunk* chunk;
+    int* nativeOffsets;         // Where each instruction starts, or -1
+    JumpFixup* fixups;
+    int fixupCount;
+    int fixupCapacity;
+    bool failed;
+    
+    // Type-specialized code only
+    bool specialized;
+    LiveInterval* intervals;    // The chunk's number locals, by start
+    int intervalCount;
+    bool* labels;               // Instructions reached other than in order
+    int virtualCount;           // Numbers above stackTop, from xmm2 up
+    int offset;                 // The instruction being compiled, or -1
+} JitCompiler;
+
+static size_t emitLocalJump(CodeBuffer* buffer, int condition);
+static void bindLocalJump(CodeBuffer* buffer, size_t position);
+static bool jumpStartsNumberLocals(JitCompiler* compiler, int target);
+static void emitJumpNumberLocals(JitCompiler* compiler, int target);
+
+static void emitJumpFixup(JitCompiler* compiler, int condition, int target) {
+    if (condition == CC_ALWAYS) {
+        emitJmp(compiler->buffer, 0);
+    } else {
+        emitJcc(compiler->buffer, (uint8_t)condition, 0);
+    }
     
-    uint8_t* ip = chunk->code;
-    uint8_t* end = chunk->code + chunk->count;
+    if (compiler->fixupCount == compiler->fixupCapacity) {
+        int capacity = compiler->fixupCapacity < 64 ? 64 : compiler->fixupCapacity * 2;
+        JumpFixup* fixups = realloc(compiler->fixups, sizeof(JumpFixup) * capacity);
+        if (fixups == NULL) {
+            compiler->failed = true;
+            return;
+        }
+        compiler->fixups = fixups;
+        compiler->fixupCapacity = capacity;
+    }
+    JumpFixup* fixup = &compiler->fixups[compiler->fixupCount++];
+    fixup->position = compiler->buffer->size - 4;
+    fixup->target = target;
+}
+
+static void emitJumpTo(JitCompiler* compiler, int condition, int target) {
+    if (!jumpStartsNumberLocals(compiler, target)) {
+        emitJumpFixup(compiler, condition, target);
+        return;
+    }
     
-    while (ip < end) {
-        if (!compileInstruction(buffer, &ip, chunk)) {
-            return false;
+    // Locals that start where the jump lands are loaded on the way. Jcc
+    // conditions come in pairs that differ in the low bit.
+    size_t notTaken = 0;
+    if (condition != CC_ALWAYS) notTaken = emitLocalJump(compiler->buffer, condition ^ 1);
+    emitJumpNumberLocals(compiler, target);
+    emitJumpFixup(compiler, CC_ALWAYS, target);
+    if (condition != CC_ALWAYS) bindLocalJump(compiler->buffer, notTaken);
+}
+
+// A jump to code later in the same instruction, bound by bindLocalJump()
+static size_t emitLocalJump(CodeBuffer* buffer, int condition) {
+    if (condition == CC_ALWAYS) {
+        emitJmp(buffer, 0);
+    } else {
+        emitJcc(buffer, (uint8_t)condition, 0);
+    }
+    return buffer->size - 4;
+}
+
+static void bindLocalJump(CodeBuffer* buffer, size_t position) {
+    if (position + 4 > buffer->capacity) return;
+    int32_t rel = (int32_t)(buffer->size - (position + 4));
+    memcpy(buffer->code + position, &rel, sizeof(rel));
+}
+
+static uint16_t readShort(uint8_t* code) {
+    return (uint16_t)((code[0] << 8) | code[1]);
+}
+
+static void jitSafepoint() {
+    gcSafepoint();
+}
+
+// Calls out to C with the VM stack written back and reloaded around it
+static void emitCallOut(CodeBuffer* buffer, void* target) {
+    emitMovMemReg(buffer, VM_REG, offsetof(VM, stackTop), STACK_REG);
+    emitCallAbsolute(buffer, target);
+    emitVzeroupper(buffer);
+    emitMovRegMem(buffer, STACK_REG, VM_REG, offsetof(VM, stackTop));
+}
+
+static void emitStoreNumberLocals(JitCompiler* compiler, int offset, bool started);
+static void emitLoadNumberLocals(JitCompiler* compiler, int offset, bool started, bool checked);
+
+// Runs the instruction at `offset` in the interpreter
+static void emitInterpreterStep(JitCompiler* compiler, int offset) {
+    CodeBuffer* buffer = compiler->buffer;
+    emitStoreNumberLocals(compiler, offset, true);
+    emitMovRegImm64(buffer, TEMP_REG_1, (int64_t)(compiler->chunk->code + offset));
+    emitMovMemReg(buffer, FRAME_REG, offsetof(CallFrame, ip), TEMP_REG_1);
+    emitCallOut(buffer, (void*)runInstruction);
+    emitTestReg32(buffer, RAX);
+    emitJumpTo(compiler, CC_NE, JIT_TARGET_ERROR);
+}
+
+// After a step, continues at whichever of `successors` the interpreter
+// left ip at, falling through when it is `next`. Anything else exits.
+// Number locals are reloaded on the way, as the step may have changed them.
+static void emitResume(JitCompiler* compiler, int next, const int* successors, int count) {
+    CodeBuffer* buffer = compiler->buffer;
+    emitCmpMem32Reg(buffer, VM_REG, offsetof(VM, frameCount), DEPTH_REG);
+    emitJumpTo(compiler, CC_NE, JIT_TARGET_EXIT);
+    emitMovRegMem(buffer, TEMP_REG_1, FRAME_REG, offsetof(CallFrame, ip));
+    
+    bool fallsThrough = false;
+    for (int i = 0; i < count; i++) {
+        if (successors[i] == next) {
+            fallsThrough = true;
+            continue;
         }
+        emitMovRegImm64(buffer, TEMP_REG_3, (int64_t)(compiler->chunk->code + successors[i]));
+        emitCmpRegReg(buffer, TEMP_REG_1, TEMP_REG_3);
+        size_t other = emitLocalJump(buffer, CC_NE);
+        emitLoadNumberLocals(compiler, successors[i], true, true);
+        emitJumpTo(compiler, CC_ALWAYS, successors[i]);
+        bindLocalJump(buffer, other);
     }
     
-    emitFunctionEpilogue(buffer);
-    return true;
+    if (fallsThrough) {
+        emitMovRegImm64(buffer, TEMP_REG_3, (int64_t)(compiler->chunk->code + next));
+        emitCmpRegReg(buffer, TEMP_REG_1, TEMP_REG_3);
+        emitJumpTo(compiler, CC_NE, JIT_TARGET_EXIT);
+        emitLoadNumberLocals(compiler, next, false, true);
+    } else {
+        emitJumpTo(compiler, CC_ALWAYS, JIT_TARGET_EXIT);
+    }
+}
+
+// Steps an instruction that has no special successors
+static void emitSteppedInstruction(JitCompiler* compiler, int offset, int next) {
+    // The interpreter runs a superinstruction's whole sequence
+    int successor = offset + instructionLength(compiler->chunk, offset);
+    emitInterpreterStep(compiler, offset);
+    emitResume(compiler, next, &successor, 1);
+}
+
+// Pops two numbers into xmm0 and xmm1
+static void emitPopNumbers(CodeBuffer* buffer) {
+    emitMovsdRegMem(buffer, TEMP_XMM_1, STACK_REG, -16);
+    emitMovsdRegMem(buffer, TEMP_XMM_2, STACK_REG, -8);
+    emitSubRegImm32(buffer, STACK_REG, 16);
+}
+
+// Jumps to `slow` unless the value `distance` slots down is a number
+static void emitNumberGuard(CodeBuffer* buffer, int distance, size_t* slow) {
+    emitVMPeek(buffer, TEMP_REG_1, distance);
+    emitMovRegImm64(buffer, TEMP_REG_3, (int64_t)QNAN);
+    emitAndRegReg(buffer, TEMP_REG_1, TEMP_REG_3);
+    emitCmpRegReg(buffer, TEMP_REG_1, TEMP_REG_3);
+    *slow = emitLocalJump(buffer, CC_E);
 }
 
-static bool compileInstruction(CodeBuffer* buffer, uint8_t** ip, Chunk* chunk) {
-    uint8_t instruction = **ip;
-    (*ip)++;
+// Sets rax to whether comparison `instruction` holds for numbers a and b
+static void emitCompareNumbers(CodeBuffer* buffer, uint8_t instruction, X64Register a, X64Register b) {
+    // The result starts false and is flipped when the comparison holds.
+    // NaN compares unordered, which reads as false for all three.
+    size_t isFalse[2];
+    int falseJumps = 1;
+    emitMovRegImm64(buffer, TEMP_REG_1, (int64_t)BOOL_VAL(false));
+    switch (instruction) {
+        case OP_LESS:
+        case OP_QUICK_LESS_NUMBER:
+            emitUcomisdRegReg(buffer, b, a);
+            isFalse[0] = emitLocalJump(buffer, CC_BE);
+            break;
+        case OP_GREATER:
+        case OP_QUICK_GREATER_NUMBER:
+            emitUcomisdRegReg(buffer, a, b);
+            isFalse[0] = emitLocalJump(buffer, CC_BE);
+            break;
+        default:
+            emitUcomisdRegReg(buffer, a, b);
+            isFalse[0] = emitLocalJump(buffer, CC_NE);
+            isFalse[1] = emitLocalJump(buffer, CC_P);
+            falseJumps = 2;
+            break;
+    }
+    emitMovRegImm64(buffer, TEMP_REG_1, (int64_t)BOOL_VAL(true));
+    for (int i = 0; i < falseJumps; i++) bindLocalJump(buffer, isFalse[i]);
+}
+
+// Jumps to `target` unless fused comparison `instruction` holds for
+// numbers a and b
+static void emitCompareJump(JitCompiler* compiler, uint8_t instruction,
+                            X64Register a, X64Register b, int target) {
+    CodeBuffer* buffer = compiler->buffer;
     
+    // ucomisd sets CF=ZF=PF=1 when unordered, so each jcc below also
+    // jumps when either operand is NaN, as the interpreter does.
     switch (instruction) {
-        case OP_CONSTANT: {
-            uint8_t constantIndex = **ip;
-            (*ip)++;
-            
-            if (constantIndex >= chunk->constants.count) return false;
-            Value constant = chunk->constants.values[constantIndex];
-            
-            emitMovRegImm64(buffer, TEMP_REG_1, (int64_t)constant);
-            emitVMPush(buffer, TEMP_REG_1);
+        case OP_JUMP_IF_NOT_LESS_NUMBER:
+            // !(a < b) is !(b > a)
+            emitUcomisdRegReg(buffer, b, a);
+            emitJumpTo(compiler, CC_BE, target);
             break;
+        case OP_JUMP_IF_NOT_LESS_EQUAL_NUMBER:
+            // !(a <= b) is !(b >= a)
+            emitUcomisdRegReg(buffer, b, a);
+            emitJumpTo(compiler, CC_B, target);
+            break;
+        case OP_JUMP_IF_NOT_GREATER_NUMBER:
+            emitUcomisdRegReg(buffer, a, b);
+            emitJumpTo(compiler, CC_BE, target);
+            break;
+        case OP_JUMP_IF_NOT_GREATER_EQUAL_NUMBER:
+            emitUcomisdRegReg(buffer, a, b);
+            emitJumpTo(compiler, CC_B, target);
+            break;
+        default:
+            // Equal means ZF=1 and PF=0.
+            emitUcomisdRegReg(buffer, a, b);
+            emitJumpTo(compiler, CC_NE, target);
+            emitJumpTo(compiler, CC_P, target);
+            break;
+    }
+}
+
+// Generic arithmetic and comparisons take a native path for two numbers
+// and leave every other operand type to the interpreter.
+static void emitGuardedNumberOp(JitCompiler* compiler, uint8_t instruction, int offset, int next) {
+    CodeBuffer* buffer = compiler->buffer;
+    size_t slow[2];
+    emitNumberGuard(buffer, 0, &slow[0]);
+    emitNumberGuard(buffer, 1, &slow[1]);
+    emitPopNumbers(buffer);  // a in xmm0, b in xmm1
+    
+    if (instruction == OP_ADD || instruction == OP_QUICK_ADD_NUMBER) {
+        emitAddsdRegReg(buffer, TEMP_XMM_1, TEMP_XMM_2);
+        emitMovsdMemReg(buffer, STACK_REG, 0, TEMP_XMM_1);
+        emitAddRegImm32(buffer, STACK_REG, 8);
+    } else {
+        emitCompareNumbers(buffer, instruction, TEMP_XMM_1, TEMP_XMM_2);
+        emitVMPush(buffer, TEMP_REG_1);
+    }
+    emitJumpTo(compiler, CC_ALWAYS, next);
+    
+    bindLocalJump(buffer, slow[0]);
+    bindLocalJump(buffer, slow[1]);
+    emitSteppedInstruction(compiler, offset, next);
+}
+
+// Loads the global in `slot` into rax, jumping to `slow` while undefined
+static void emitLoadGlobalSlot(CodeBuffer* buffer, uint16_t slot, size_t* slow) {
+    emitMovRegMem(buffer, TEMP_REG_1, VM_REG,
+                  offsetof(VM, globalValues) + offsetof(ValueArray, values));
+    emitMovRegMem(buffer, TEMP_REG_1, TEMP_REG_1, slot * (int32_t)sizeof(Value));
+    emitMovRegImm64(buffer, TEMP_REG_3, (int64_t)UNDEFINED_VAL);
+    emitCmpRegReg(buffer, TEMP_REG_1, TEMP_REG_3);
+    *slow = emitLocalJump(buffer, CC_E);
+}
+
+static void emitLoadConstant(JitCompiler* compiler, uint32_t index) {
+    if (index >= (uint32_t)compiler->chunk->constants.count) {
+        compiler->failed = true;
+        return;
+    }
+    emitMovRegImm64(compiler->buffer, TEMP_REG_1, (int64_t)compiler->chunk->constants.values[index]);
+    emitVMPush(compiler->buffer, TEMP_REG_1);
+}
+
+// Type-specialized code
+//
+// At JIT_OPT_ADVANCED, locals the compiler typed as non-nullable ints stay
+// unboxed in xmm8-xmm15 over the intervals they are live for, and the
+// numbers an expression works on stay in xmm2-xmm7 rather than being
+// pushed, for as long as the instructions consuming them want numbers. A
+// NaN-boxed number is its double's bits, so boxing one is just a store.
+//
+// The stack is only brought up to date where something else looks at it.
+// Registers are written back before each step into the interpreter and
+// reloaded after it, checking the tags since a call may have stored
+// anything there, and the same check guards the loads where compiled code
+// is entered. Everything else is a number by the compiler's types or by
+// having been computed here, and generic operators the interpreter has
+// quickened for numbers are trusted to see numbers while their operands
+// are ones computed in registers. A failed check leaves the frame to the
+// interpreter with the stack written back.
+//
+// Numbers still in xmm2-xmm7 are pushed before any jump and at each
+// instruction something jumps to, so those see the stack the interpreter
+// would.
+
+static X64Register intervalRegister(JitCompiler* compiler, int index) {
+    return (X64Register)(NUMBER_XMM_FIRST + compiler->intervals[index].reg);
+}
+
+// Whether the interval's register holds its local when the instruction at
+// `offset` runs. A local is loaded just before the instruction it starts
+// at, so it is only held there once `started`.
+static bool intervalHeld(JitCompiler* compiler, int index, int offset, bool started) {
+    LiveInterval* interval = &compiler->intervals[index];
+    if (interval->reg < 0) return false;
+    int first = started ? interval->start : interval->start + 1;
+    return first <= offset && offset <= interval->end;
+}
+
+// The register holding the local in `slot` at `offset`, or -1
+static int numberRegister(JitCompiler* compiler, int slot, int offset) {
+    for (int i = 0; i < compiler->intervalCount; i++) {
+        if (compiler->intervals[i].slot == slot && intervalHeld(compiler, i, offset, true)) {
+            return intervalRegister(compiler, i);
+        }
+    }
+    return -1;
+}
+
+// Writes the number locals held at `offset` back to their slots
+static void emitStoreNumberLocals(JitCompiler* compiler, int offset, bool started) {
+    if (!compiler->specialized) return;
+    for (int i = 0; i < compiler->intervalCount; i++) {
+        if (!intervalHeld(compiler, i, offset, started)) continue;
+        emitMovsdMemReg(compiler->buffer, SLOTS_REG, compiler->intervals[i].slot * (int32_t)sizeof(Value),
+                        intervalRegister(compiler, i));
+    }
+}
+
+// Loads the number locals held at `offset` from their slots. When
+// `checked`, a slot that no longer holds a number exits.
+static void emitLoadNumberLocals(JitCompiler* compiler, int offset, bool started, bool checked) {
+    if (!compiler->specialized) return;
+    CodeBuffer* buffer = compiler->buffer;
+    bool tagLoaded = false;
+    for (int i = 0; i < compiler->intervalCount; i++) {
+        if (!intervalHeld(compiler, i, offset, started)) continue;
+        X64Register reg = intervalRegister(compiler, i);
+        int32_t slot = compiler->intervals[i].slot * (int32_t)sizeof(Value);
+        if (!checked) {
+            emitMovsdRegMem(buffer, reg, SLOTS_REG, slot);
+            continue;
         }
         
+        if (!tagLoaded) {
+            emitMovRegImm64(buffer, TEMP_REG_3, (int64_t)QNAN);
+            tagLoaded = true;
+        }
+        emitMovRegMem(buffer, TEMP_REG_1, SLOTS_REG, slot);
+        emitMovRegReg(buffer, TEMP_REG_2, TEMP_REG_1);
+        emitAndRegReg(buffer, TEMP_REG_2, TEMP_REG_3);
+        emitCmpRegReg(buffer, TEMP_REG_2, TEMP_REG_3);
+        emitJumpTo(compiler, CC_E, JIT_TARGET_EXIT);
+        emitMovqXmmReg(buffer, reg, TEMP_REG_1);
+    }
+}
+
+// Loads the value at [base + displacement] into `reg`, first checking it
+// is a number. If not, the instruction at `offset` is left to the
+// interpreter, with the registers held there written back.
+static void emitLoadCheckedNumber(JitCompiler* compiler, X64Register reg, X64Register base,
+                                  int32_t displacement, int offset, bool started) {
+    CodeBuffer* buffer = compiler->buffer;
+    emitMovRegMem(buffer, TEMP_REG_1, base, displacement);
+    emitMovRegReg(buffer, TEMP_REG_2, TEMP_REG_1);
+    emitMovRegImm64(buffer, TEMP_REG_3, (int64_t)QNAN);
+    emitAndRegReg(buffer, TEMP_REG_2, TEMP_REG_3);
+    emitCmpRegReg(buffer, TEMP_REG_2, TEMP_REG_3);
+    size_t isNumber = emitLocalJump(buffer, CC_NE);
+    emitStoreNumberLocals(compiler, offset, started);
+    emitMovRegImm64(buffer, TEMP_REG_1, (int64_t)(compiler->chunk->code + offset));
+    emitMovMemReg(buffer, FRAME_REG, offsetof(CallFrame, ip), TEMP_REG_1);
+    emitJumpTo(compiler, CC_ALWAYS, JIT_TARGET_EXIT);
+    bindLocalJump(buffer, isNumber);
+    emitMovqXmmReg(buffer, reg, TEMP_REG_1);
+}
+
+// Whether a jump from the current instruction to `target` lands where a
+// local starts without having it loaded
+static bool jumpStartsNumberLocals(JitCompiler* compiler, int target) {
+    if (!compiler->specialized || compiler->offset < 0 || target < 0) return false;
+    for (int i = 0; i < compiler->intervalCount; i++) {
+        if (compiler->intervals[i].start == target && compiler->intervals[i].reg >= 0 &&
+            !intervalHeld(compiler, i, compiler->offset, true)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Loads those locals from the stack, where the jump leaves them
+static void emitJumpNumberLocals(JitCompiler* compiler, int target) {
+    for (int i = 0; i < compiler->intervalCount; i++) {
+        LiveInterval* interval = &compiler->intervals[i];
+        if (interval->start != target || interval->reg < 0 ||
+            intervalHeld(compiler, i, compiler->offset, true)) {
+            continue;
+        }
+        emitLoadCheckedNumber(compiler, intervalRegister(compiler, i), SLOTS_REG,
+                              interval->slot * (int32_t)sizeof(Value), target, false);
+    }
+}
+
+static X64Register virtualRegister(int index) {
+    return (X64Register)(VIRTUAL_XMM_FIRST + index);
+}
+
+// Pushes the numbers held in registers onto the VM stack
+static void emitFlushNumbers(JitCompiler* compiler) {
+    int count = compiler->virtualCount;
+    if (count == 0) return;
+    for (int i = 0; i < count; i++) {
+        emitMovsdMemReg(compiler->buffer, STACK_REG, i * 8, virtualRegister(i));
+    }
+    emitAddRegImm32(compiler->buffer, STACK_REG, count * 8);
+    compiler->virtualCount = 0;
+}
+
+// The register for a number pushed on top
+static X64Register pushNumber(JitCompiler* compiler) {
+    if (compiler->virtualCount == VIRTUAL_XMM_COUNT) emitFlushNumbers(compiler);
+    return virtualRegister(compiler->virtualCount++);
+}
+
+// Loads the locals whose intervals start at `offset`, ahead of anything
+// that jumps there from inside the interval. A local's value is the one
+// its declaration has just pushed, or its argument.
+static void emitStartNumberLocals(JitCompiler* compiler, int offset) {
+    for (int i = 0; i < compiler->intervalCount; i++) {
+        LiveInterval* interval = &compiler->intervals[i];
+        if (interval->start != offset || interval->reg < 0) continue;
+        X64Register reg = intervalRegister(compiler, i);
+        if (compiler->virtualCount > 0) {
+            emitMovapdRegReg(compiler->buffer, reg, virtualRegister(compiler->virtualCount - 1));
+            emitFlushNumbers(compiler);
+        } else {
+            emitLoadCheckedNumber(compiler, reg, SLOTS_REG, interval->slot * (int32_t)sizeof(Value),
+                                  offset, false);
+        }
+    }
+}
+
+// Pops two numbers and pushes the result of arithmetic `instruction`
+static void emitNumberArithmetic(JitCompiler* compiler, uint8_t instruction) {
+    CodeBuffer* buffer = compiler->buffer;
+    X64Register a, b, result;
+    int count = compiler->virtualCount;
+    if (count >= 2) {
+        a = virtualRegister(count - 2);
+        b = virtualRegister(count - 1);
+        result = a;
+        compiler->virtualCount--;
+    } else if (count == 1) {
+        emitMovsdRegMem(buffer, TEMP_XMM_1, STACK_REG, -8);
+        emitSubRegImm32(buffer, STACK_REG, 8);
+        a = TEMP_XMM_1;
+        b = virtualRegister(0);
+        result = b;
+    } else {
+        emitPopNumbers(buffer);
+        a = TEMP_XMM_1;
+        b = TEMP_XMM_2;
+        result = pushNumber(compiler);
+    }
+    
+    switch (instruction) {
+        case OP_ADD_NUMBER:      emitAddsdRegReg(buffer, a, b); break;
+        case OP_SUBTRACT_NUMBER: emitSubsdRegReg(buffer, a, b); break;
+        case OP_MULTIPLY_NUMBER: emitMulsdRegReg(buffer, a, b); break;
+        default:                 emitDivsdRegReg(buffer, a, b); break;
+    }
+    if (result != a) emitMovapdRegReg(buffer, result, a);
+}
+
+// Compiles an instruction against numbers held in registers. Returns
+// false to have it translated against the stack instead, once the numbers
+// have been pushed.
+static bool compileNumberInstruction(JitCompiler* compiler, int offset, int length) {
+    CodeBuffer* buffer = compiler->buffer;
+    uint8_t* code = compiler->chunk->code + offset;
+    int next = offset + length;
+    int count = compiler->virtualCount;
+    uint8_t instruction = unfusedOpcode(code[0]);
+    switch (instruction) {
+        case OP_CONSTANT:
         case OP_CONSTANT_LONG: {
-            uint32_t constantIndex = ((*ip)[0] << 16) | ((*ip)[1] << 8) | (*ip)[2];
-            (*ip) += 3;
-            
-            if (constantIndex >= chunk->constants.count) return false;
-            Value constant = chunk->constants.values[constantIndex];
-            
-            emitMovRegImm64(buffer, TEMP_REG_1, (int64_t)constant);
+            uint32_t index = instruction == OP_CONSTANT
+                ? code[1] : ((uint32_t)code[1] << 16) | (code[2] << 8) | code[3];
+            if (index >= (uint32_t)compiler->chunk->constants.count) return false;
+            Value value = compiler->chunk->constants.values[index];
+            if (!IS_NUMBER(value)) return false;
+            emitMovRegImm64(buffer, TEMP_REG_1, (int64_t)value);
+            emitMovqXmmReg(buffer, pushNumber(compiler), TEMP_REG_1);
+            return true;
+        }
+        
+        case OP_GET_LOCAL: {
+            int reg = numberRegister(compiler, code[1], offset);
+            if (reg < 0) return false;
+            emitMovapdRegReg(buffer, pushNumber(compiler), (X64Register)reg);
+            return true;
+        }
+        
+        case OP_SET_LOCAL: {
+            int reg = numberRegister(compiler, code[1], offset);
+            if (count > 0) {
+                X64Register top = virtualRegister(count - 1);
+                if (reg >= 0) {
+                    emitMovapdRegReg(buffer, (X64Register)reg, top);
+                } else {
+                    emitMovsdMemReg(buffer, SLOTS_REG, code[1] * (int32_t)sizeof(Value), top);
+                }
+                return true;
+            }
+            if (reg < 0) return false;
+            // Only the compiler's types say a value the interpreter pushed
+            // is a number
+            emitLoadCheckedNumber(compiler, (X64Register)reg, STACK_REG, -8, offset, true);
+            return true;
+        }
+        
+        case OP_POP:
+            if (count == 0) return false;
+            compiler->virtualCount--;
+            return true;
+        
+        case OP_ADD_NUMBER:
+        case OP_SUBTRACT_NUMBER:
+        case OP_MULTIPLY_NUMBER:
+        case OP_DIVIDE_NUMBER:
+            emitNumberArithmetic(compiler, instruction);
+            return true;
+        
+        case OP_ADD:
+        case OP_QUICK_ADD_NUMBER:
+            if (count < 2) return false;
+            emitNumberArithmetic(compiler, OP_ADD_NUMBER);
+            return true;
+        
+        case OP_LESS:
+        case OP_QUICK_LESS_NUMBER:
+        case OP_GREATER:
+        case OP_QUICK_GREATER_NUMBER:
+        case OP_EQUAL:
+        case OP_QUICK_EQUAL_NUMBER:
+            if (count < 2) return false;
+            compiler->virtualCount -= 2;
+            emitCompareNumbers(buffer, instruction, virtualRegister(count - 2), virtualRegister(count - 1));
+            emitFlushNumbers(compiler);
             emitVMPush(buffer, TEMP_REG_1);
-            break;
+            return true;
+        
+        case OP_NEGATE_NUMBER:
+            if (count == 0) return false;
+            emitMovRegImm64(buffer, TEMP_REG_1, (int64_t)SIGN_BIT);
+            emitMovqXmmReg(buffer, TEMP_XMM_1, TEMP_REG_1);
+            emitXorpdRegReg(buffer, virtualRegister(count - 1), TEMP_XMM_1);
+            return true;
+        
+        case OP_NOT:
+            // A number is never falsey
+            if (count == 0) return false;
+            compiler->virtualCount--;
+            emitFlushNumbers(compiler);
+            emitMovRegImm64(buffer, TEMP_REG_1, (int64_t)BOOL_VAL(false));
+            emitVMPush(buffer, TEMP_REG_1);
+            return true;
+        
+        case OP_JUMP_IF_FALSE:
+            // Nor does one take this jump
+            return count > 0;
+        
+        case OP_JUMP_IF_NOT_LESS_NUMBER:
+        case OP_JUMP_IF_NOT_LESS_EQUAL_NUMBER:
+        case OP_JUMP_IF_NOT_GREATER_NUMBER:
+        case OP_JUMP_IF_NOT_GREATER_EQUAL_NUMBER:
+        case OP_JUMP_IF_NOT_EQUAL_NUMBER: {
+            if (count == 0) return false;
+            X64Register a, b = virtualRegister(count - 1);
+            if (count >= 2) {
+                a = virtualRegister(count - 2);
+                compiler->virtualCount -= 2;
+            } else {
+                emitMovsdRegMem(buffer, TEMP_XMM_1, STACK_REG, -8);
+                emitSubRegImm32(buffer, STACK_REG, 8);
+                a = TEMP_XMM_1;
+                compiler->virtualCount = 0;
+            }
+            emitFlushNumbers(compiler);
+            emitCompareJump(compiler, instruction, a, b, next + readShort(code + 1));
+            return true;
         }
         
+        default:
+            return false;
+    }
+}
+
+static void compileInstruction(JitCompiler* compiler, int offset, int length) {
+    CodeBuffer* buffer = compiler->buffer;
+    uint8_t* code = compiler->chunk->code + offset;
+    int next = offset + length;
+    
+    if (compiler->specialized) {
+        if (compileNumberInstruction(compiler, offset, length)) return;
+        emitFlushNumbers(compiler);
+    }
+    
+    // Superinstructions leave the rest of their sequence in place, so
+    // translating the first opcode and carrying on covers them.
+    uint8_t instruction = unfusedOpcode(code[0]);
+    switch (instruction) {
+        case OP_CONSTANT:
+            emitLoadConstant(compiler, code[1]);
+            return;
+            
+        case OP_CONSTANT_LONG:
+            emitLoadConstant(compiler, ((uint32_t)code[1] << 16) | (code[2] << 8) | code[3]);
+            return;
+        
         case OP_NIL:
             emitMovRegImm64(buffer, TEMP_REG_1, (int64_t)NIL_VAL);
             emitVMPush(buffer, TEMP_REG_1);
-            break;
+            return;
             
         case OP_TRUE:
             emitMovRegImm64(buffer, TEMP_REG_1, (int64_t)BOOL_VAL(true));
             emitVMPush(buffer, TEMP_REG_1);
-            break;
+            return;
             
         case OP_FALSE:
             emitMovRegImm64(buffer, TEMP_REG_1, (int64_t)BOOL_VAL(false));
             emitVMPush(buffer, TEMP_REG_1);
-            break;
+            return;
             
         case OP_POP:
-            emitVMPop(buffer, TEMP_REG_1);
-            break;
-            
-        case OP_GET_LOCAL: {
-            uint8_t slot = **ip;
-            (*ip)++;
+            emitSubRegImm32(buffer, STACK_REG, 8);
+            return;
             
-            // Load from frame->slots[slot]
-            int32_t offset = offsetof(CallFrame, slots) + slot * sizeof(Value);
-            emitMovRegMem(buffer, TEMP_REG_1, FRAME_REG, offset);
+        case OP_GET_LOCAL:
+            emitMovRegMem(buffer, TEMP_REG_1, SLOTS_REG, code[1] * (int32_t)sizeof(Value));
             emitVMPush(buffer, TEMP_REG_1);
-            break;
-        }
+            return;
         
-        case OP_SET_LOCAL: {
-            uint8_t slot = **ip;
-            (*ip)++;
-            
-            // Pop value and store in frame->slots[slot]
-            emitVMPeek(buffer, TEMP_REG_1, 0);  // Peek instead of pop to leave on stack
-            int32_t offset = offsetof(CallFrame, slots) + slot * sizeof(Value);
-            emitMovMemReg(buffer, FRAME_REG, offset, TEMP_REG_1);
-            break;
-        }
+        case OP_SET_LOCAL:
+            // The value stays on the stack
+            emitVMPeek(buffer, TEMP_REG_1, 0);
+            emitMovMemReg(buffer, SLOTS_REG, code[1] * (int32_t)sizeof(Value), TEMP_REG_1);
+            return;
         
-        case OP_GET_GLOBAL: {
-            // For now, fall back to interpreter for global access
-            // This requires calling into the VM's global table lookup
-            return false;
-        }
+        case OP_GET_STACK:
+            emitVMPeek(buffer, TEMP_REG_1, code[1]);
+            emitVMPush(buffer, TEMP_REG_1);
+            return;
         
-        case OP_SET_GLOBAL: {
-            // For now, fall back to interpreter for global access
-            return false;
-        }
+        case OP_SET_STACK:
+            emitVMPeek(buffer, TEMP_REG_1, 0);
+            emitMovMemReg(buffer, STACK_REG, -(1 + code[1]) * 8, TEMP_REG_1);
+            return;
         
-        case OP_DEFINE_GLOBAL: {
-            // For now, fall back to interpreter for global access
-            return false;
-        }
+        case OP_INLINE_RETURN:
+            // Drop the inlined callee's slots from under its result
+            emitVMPeek(buffer, TEMP_REG_1, 0);
+            emitSubRegImm32(buffer, STACK_REG, code[1] * 8);
+            emitMovMemReg(buffer, STACK_REG, -8, TEMP_REG_1);
+            return;
         
-        case OP_ADD:
-        case OP_SUBTRACT:
-        case OP_MULTIPLY:
-        case OP_DIVIDE: {
-            // Generic arithmetic - fall back to interpreter for type checking
-            return false;
-        }
+        // The compiler only emits these for operands it knows are numbers
+        case OP_ADD_NUMBER:
+        case OP_SUBTRACT_NUMBER:
+        case OP_MULTIPLY_NUMBER:
+        case OP_DIVIDE_NUMBER:
+            emitPopNumbers(buffer);
+            switch (instruction) {
+                case OP_ADD_NUMBER:      emitAddsdRegReg(buffer, TEMP_XMM_1, TEMP_XMM_2); break;
+                case OP_SUBTRACT_NUMBER: emitSubsdRegReg(buffer, TEMP_XMM_1, TEMP_XMM_2); break;
+                case OP_MULTIPLY_NUMBER: emitMulsdRegReg(buffer, TEMP_XMM_1, TEMP_XMM_2); break;
+                default:                 emitDivsdRegReg(buffer, TEMP_XMM_1, TEMP_XMM_2); break;
+            }
+            emitMovsdMemReg(buffer, STACK_REG, 0, TEMP_XMM_1);
+            emitAddRegImm32(buffer, STACK_REG, 8);
+            return;
         
-        case OP_ADD_NUMBER: {
-            // Optimized number addition - implement with SSE
-            emitVMPop(buffer, TEMP_REG_2);  // Second operand
-            emitVMPop(buffer, TEMP_REG_1);  // First operand
-            
-            // For now, assume they are already numbers and just add the raw values
-            // This is a simplified implementation - real version would extract doubles
-            emitAddRegReg(buffer, TEMP_REG_1, TEMP_REG_2);
+        case OP_GET_GLOBAL_SLOT: {
+            // An undefined global is the interpreter's error to report
+            size_t slow;
+            emitLoadGlobalSlot(buffer, readShort(code + 1), &slow);
             emitVMPush(buffer, TEMP_REG_1);
-            break;
+            emitJumpTo(compiler, CC_ALWAYS, next);
+            bindLocalJump(buffer, slow);
+            emitSteppedInstruction(compiler, offset, next);
+            return;
         }
         
-        case OP_SUBTRACT_NUMBER: {
-            emitVMPop(buffer, TEMP_REG_2);  // Second operand
-            emitVMPop(buffer, TEMP_REG_1);  // First operand
-            emitSubRegReg(buffer, TEMP_REG_1, TEMP_REG_2);
-            emitVMPush(buffer, TEMP_REG_1);
-            break;
+        case OP_SET_GLOBAL_SLOT: {
+            // globalValues is a root of every collection, so no barrier
+            size_t slow;
+            emitLoadGlobalSlot(buffer, readShort(code + 1), &slow);
+            emitMovRegMem(buffer, TEMP_REG_1, VM_REG,
+                          offsetof(VM, globalValues) + offsetof(ValueArray, values));
+            emitVMPeek(buffer, TEMP_REG_2, 0);
+            emitMovMemReg(buffer, TEMP_REG_1, readShort(code + 1) * (int32_t)sizeof(Value), TEMP_REG_2);
+            emitJumpTo(compiler, CC_ALWAYS, next);
+            bindLocalJump(buffer, slow);
+            emitSteppedInstruction(compiler, offset, next);
+            return;
         }
         
-        case OP_MULTIPLY_NUMBER:
-        case OP_DIVIDE_NUMBER: {
-            // These require proper floating point handling
-            return false;
-        }
+        case OP_ADD:
+        case OP_QUICK_ADD_NUMBER:
+        case OP_LESS:
+        case OP_QUICK_LESS_NUMBER:
+        case OP_GREATER:
+        case OP_QUICK_GREATER_NUMBER:
+        case OP_EQUAL:
+        case OP_QUICK_EQUAL_NUMBER:
+            emitGuardedNumberOp(compiler, instruction, offset, next);
+            return;
         
-        case OP_NEGATE:
-        case OP_NEGATE_NUMBER: {
-            // For now, fall back to interpreter
-            return false;
+        case OP_NOT: {
+            size_t isFalsey[2];
+            emitVMPeek(buffer, TEMP_REG_2, 0);
+            emitMovRegImm64(buffer, TEMP_REG_1, (int64_t)BOOL_VAL(true));
+            emitMovRegImm64(buffer, TEMP_REG_3, (int64_t)NIL_VAL);
+            emitCmpRegReg(buffer, TEMP_REG_2, TEMP_REG_3);
+            isFalsey[0] = emitLocalJump(buffer, CC_E);
+            emitMovRegImm64(buffer, TEMP_REG_3, (int64_t)BOOL_VAL(false));
+            emitCmpRegReg(buffer, TEMP_REG_2, TEMP_REG_3);
+            isFalsey[1] = emitLocalJump(buffer, CC_E);
+            emitMovRegImm64(buffer, TEMP_REG_1, (int64_t)BOOL_VAL(false));
+            bindLocalJump(buffer, isFalsey[0]);
+            bindLocalJump(buffer, isFalsey[1]);
+            emitMovMemReg(buffer, STACK_REG, -8, TEMP_REG_1);
+            return;
         }
         
-        case OP_EQUAL: {
-            emitVMPop(buffer, TEMP_REG_2);
-            emitVMPop(buffer, TEMP_REG_1);
-            emitCmpRegReg(buffer, TEMP_REG_1, TEMP_REG_2);
-            
-            // Set result based on comparison
+        case OP_NEGATE_NUMBER:
+            emitVMPeek(buffer, TEMP_REG_1, 0);
+            emitMovRegImm64(buffer, TEMP_REG_3, (int64_t)SIGN_BIT);
+            emitXorRegReg(buffer, TEMP_REG_1, TEMP_REG_3);
+            emitMovMemReg(buffer, STACK_REG, -8, TEMP_REG_1);
+            return;
+        
+        case OP_JUMP:
+            emitJumpTo(compiler, CC_ALWAYS, next + readShort(code + 1));
+            return;
+        
+        case OP_JUMP_IF_FALSE: {
+            // nil and false are the only falsey values
+            int target = next + readShort(code + 1);
+            emitVMPeek(buffer, TEMP_REG_1, 0);
+            emitMovRegImm64(buffer, TEMP_REG_3, (int64_t)NIL_VAL);
+            emitCmpRegReg(buffer, TEMP_REG_1, TEMP_REG_3);
+            emitJumpTo(compiler, CC_E, target);
             emitMovRegImm64(buffer, TEMP_REG_3, (int64_t)BOOL_VAL(false));
-            emitJne(buffer, 10);  // Skip next instruction if not equal
-            emitMovRegImm64(buffer, TEMP_REG_3, (int64_t)BOOL_VAL(true));
-            
-            emitVMPush(buffer, TEMP_REG_3);
-            break;
+            emitCmpRegReg(buffer, TEMP_REG_1, TEMP_REG_3);
+            emitJumpTo(compiler, CC_E, target);
+            return;
         }
         
-        case OP_GREATER:
-        case OP_LESS: {
-            // For now, fall back to interpreter for proper comparison
-            return false;
+        case OP_LOOP: {
+            // Back-edges give an incremental collection its turn, as the
+            // interpreter's do
+            int target = next - readShort(code + 1);
+            emitCmpMem32Imm8(buffer, VM_REG, offsetof(VM, gcPhase), GC_PHASE_IDLE);
+            emitJumpTo(compiler, CC_E, target);
+            emitStoreNumberLocals(compiler, offset, true);
+            emitCallOut(buffer, (void*)jitSafepoint);
+            emitLoadNumberLocals(compiler, target, true, false);
+            emitJumpTo(compiler, CC_ALWAYS, target);
+            return;
         }
         
-        case OP_NOT: {
-            // For now, fall back to interpreter
-            return false;
+        case OP_JUMP_IF_NOT_LESS_NUMBER:
+        case OP_JUMP_IF_NOT_LESS_EQUAL_NUMBER:
+        case OP_JUMP_IF_NOT_GREATER_NUMBER:
+        case OP_JUMP_IF_NOT_GREATER_EQUAL_NUMBER:
+        case OP_JUMP_IF_NOT_EQUAL_NUMBER: {
+            // Both operands are known numbers: one ucomisd and a jcc.
+            emitPopNumbers(buffer);  // a in xmm0, b in xmm1
+            emitCompareJump(compiler, instruction, TEMP_XMM_1, TEMP_XMM_2, next + readShort(code + 1));
+            return;
         }
         
-        case OP_PRINT: {
-            // Fall back to interpreter for print
-            return false;
+        case OP_TAIL_CALL: {
+            // A closure callee takes over the frame and starts at its first
+            // instruction, which is ours again when the function calls itself
+            int successors[] = {next, 0};
+            emitInterpreterStep(compiler, offset);
+            emitResume(compiler, next, successors, 2);
+            return;
         }
         
-        case OP_JUMP: {
-            uint16_t offset = ((*ip)[0] << 8) | (*ip)[1];
-            (*ip) += 2;
-            emitJmp(buffer, offset);
-            break;
+        case OP_INLINE_CALL:
+        case OP_INLINE_INVOKE: {
+            // The guard either falls into the inlined body or makes the call
+            // and skips it
+            uint16_t skip = readShort(code + length - 2);
+            int successors[] = {next, next + skip};
+            emitInterpreterStep(compiler, offset);
+            emitResume(compiler, next, successors, 2);
+            return;
         }
         
-        case OP_JUMP_IF_FALSE: {
-            uint16_t offset = ((*ip)[0] << 8) | (*ip)[1];
-            (*ip) += 2;
+        case OP_RETURN: {
+            // Open upvalues to close and the script's own return are left to
+            // the interpreter. Otherwise the result replaces the callee.
+            size_t slow[2];
+            emitCmpMemImm8(buffer, VM_REG, offsetof(VM, openUpvalues), 0);
+            slow[0] = emitLocalJump(buffer, CC_NE);
+            emitCmpMem32Imm8(buffer, VM_REG, offsetof(VM, frameCount), 1);
+            slow[1] = emitLocalJump(buffer, CC_E);
+            emitVMPeek(buffer, TEMP_REG_1, 0);
+            emitMovMemReg(buffer, SLOTS_REG, 0, TEMP_REG_1);
+            emitMovRegReg(buffer, STACK_REG, SLOTS_REG);
+            emitAddRegImm32(buffer, STACK_REG, 8);
+            emitDecMem32(buffer, VM_REG, offsetof(VM, frameCount));
+            emitCmpMem32Imm8(buffer, VM_REG, offsetof(VM, gcPhase), GC_PHASE_IDLE);
+            emitJumpTo(compiler, CC_E, JIT_TARGET_RETURN);
+            emitCallOut(buffer, (void*)jitSafepoint);
+            emitJumpTo(compiler, CC_ALWAYS, JIT_TARGET_RETURN);
             
-            emitVMPop(buffer, TEMP_REG_1);
-            // Check if value is falsey (simplified - just check if 0)
-            emitMovRegImm64(buffer, TEMP_REG_2, 0);
-            emitCmpRegReg(buffer, TEMP_REG_1, TEMP_REG_2);
-            emitJe(buffer, offset);
-            break;
+            bindLocalJump(buffer, slow[0]);
+            bindLocalJump(buffer, slow[1]);
+            emitInterpreterStep(compiler, offset);
+            emitJumpTo(compiler, CC_ALWAYS, JIT_TARGET_RETURN);
+            return;
         }
         
-        case OP_LOOP: {
-            uint16_t offset = ((*ip)[0] << 8) | (*ip)[1];
-            (*ip) += 2;
-            emitJmp(buffer, -(int32_t)offset);
-            break;
+        default:
+            emitSteppedInstruction(compiler, offset, next);
+            return;
+    }
+}
+
+// Compiles the function and fills in where it can be entered
+// Lists the start of the function and every loop header as entry points,
+// so the interpreter can hand over a frame in the middle of a loop
+static bool collectEntries(JitCompiler* compiler, JitEntry** entries, int* entryCount) {
+    Chunk* chunk = compiler->chunk;
+    int capacity = 1;
+    for (int offset = 0; offset < chunk->count; offset += unfusedLength(chunk, offset)) {
+        if (unfusedOpcode(chunk->code[offset]) == OP_LOOP) capacity++;
+    }
+    
+    JitEntry* list = malloc(sizeof(JitEntry) * capacity);
+    if (list == NULL) return false;
+    list[0].bytecodeOffset = 0;
+    list[0].nativeOffset = compiler->nativeOffsets[0];
+    int count = 1;
+    
+    for (int offset = 0; offset < chunk->count;) {
+        int length = unfusedLength(chunk, offset);
+        if (unfusedOpcode(chunk->code[offset]) == OP_LOOP) {
+            int header = offset + length - readShort(chunk->code + offset + 1);
+            bool seen = false;
+            for (int i = 0; i < count; i++) {
+                if (list[i].bytecodeOffset == header) seen = true;
+            }
+            if (!seen) {
+                list[count].bytecodeOffset = header;
+                list[count].nativeOffset = compiler->nativeOffsets[header];
+                count++;
+            }
+        }
+        offset += length;
+    }
+    
+    *entries = list;
+    *entryCount = count;
+    return true;
+}
+
+// Live intervals
+//
+// A local's NumberRange runs to the end of its scope, but its interval
+// ends at the last instruction that reads or writes its slot, so the
+// register can go to another local once this one is dead. A local live
+// at a loop's header stays live around the whole loop, since the next
+// iteration reads it again.
+
+static int compareIntervals(const void* a, const void* b) {
+    return ((const LiveInterval*)a)->start - ((const LiveInterval*)b)->start;
+}
+
+// The chunk's live intervals, sorted by start, or NULL if out of memory
+static LiveInterval* buildLiveIntervals(Chunk* chunk) {
+    int count = chunk->numberRangeCount;
+    LiveInterval* intervals = malloc(sizeof(LiveInterval) * count);
+    if (intervals == NULL) return NULL;
+    for (int i = 0; i < count; i++) {
+        NumberRange* range = &chunk->numberRanges[i];
+        intervals[i].start = range->start;
+        intervals[i].end = range->start;
+        intervals[i].slot = range->slot;
+        intervals[i].reg = -1;
+    }
+    
+    for (int offset = 0; offset < chunk->count; offset += unfusedLength(chunk, offset)) {
+        uint8_t instruction = unfusedOpcode(chunk->code[offset]);
+        if (instruction != OP_GET_LOCAL && instruction != OP_SET_LOCAL) continue;
+        int slot = chunk->code[offset + 1];
+        for (int i = 0; i < count; i++) {
+            NumberRange* range = &chunk->numberRanges[i];
+            if (range->slot == slot && range->start <= offset && offset <= range->end) {
+                intervals[i].end = offset;
+            }
+        }
+    }
+    
+    // Extending an interval over one loop can carry it into the header of
+    // an enclosing one
+    bool extended = true;
+    while (extended) {
+        extended = false;
+        for (int offset = 0; offset < chunk->count; offset += unfusedLength(chunk, offset)) {
+            if (unfusedOpcode(chunk->code[offset]) != OP_LOOP) continue;
+            int header = offset + unfusedLength(chunk, offset) - readShort(chunk->code + offset + 1);
+            for (int i = 0; i < count; i++) {
+                LiveInterval* interval = &intervals[i];
+                if (interval->start <= header && header <= interval->end && interval->end < offset) {
+                    interval->end = offset;
+                    extended = true;
+                }
+            }
+        }
+    }
+    
+    qsort(intervals, count, sizeof(LiveInterval), compareIntervals);
+    return intervals;
+}
+
+// Builds the number locals' intervals and allocates their registers, and
+// finds the instructions reached other than in order. Returns false if a
+// jump lands inside a local's interval from outside it, which leaves the
+// function unspecialized.
+static bool planNumberLocals(JitCompiler* compiler) {
+    Chunk* chunk = compiler->chunk;
+    if (chunk->numberRangeCount == 0) return false;
+    
+    compiler->intervals = buildLiveIntervals(chunk);
+    compiler->labels = calloc(chunk->count + 1, sizeof(bool));
+    if (compiler->intervals == NULL || compiler->labels == NULL) return false;
+    compiler->intervalCount = chunk->numberRangeCount;
+    
+    RegisterAllocator allocator;
+    initRegisterAllocator(&allocator, NUMBER_XMM_COUNT);
+    allocateRegisters(&allocator, compiler->intervals, compiler->intervalCount);
+    
+    compiler->labels[0] = true;
+    for (int offset = 0; offset < chunk->count;) {
+        int length = unfusedLength(chunk, offset);
+        uint8_t* code = chunk->code + offset;
+        int next = offset + length;
+        int target = -1;
+        switch (unfusedOpcode(code[0])) {
+            case OP_JUMP:
+            case OP_JUMP_IF_FALSE:
+            case OP_JUMP_IF_NOT_LESS_NUMBER:
+            case OP_JUMP_IF_NOT_LESS_EQUAL_NUMBER:
+            case OP_JUMP_IF_NOT_GREATER_NUMBER:
+            case OP_JUMP_IF_NOT_GREATER_EQUAL_NUMBER:
+            case OP_JUMP_IF_NOT_EQUAL_NUMBER:
+                target = next + readShort(code + 1);
+                break;
+            case OP_LOOP:
+                target = next - readShort(code + 1);
+                break;
+            case OP_INLINE_CALL:
+            case OP_INLINE_INVOKE: {
+                // Resuming past the inlined body reloads the locals
+                int skipped = next + readShort(code + length - 2);
+                if (skipped <= chunk->count) compiler->labels[skipped] = true;
+                break;
+            }
+            default:
+                break;
         }
         
-        case OP_CALL: {
-            // Fall back to interpreter for function calls
-            return false;
+        if (target >= 0) {
+            if (target > chunk->count) return false;
+            compiler->labels[target] = true;
+            for (int i = 0; i < compiler->intervalCount; i++) {
+                if (intervalHeld(compiler, i, target, true) &&
+                    !intervalHeld(compiler, i, offset, true) &&
+                    compiler->intervals[i].start != target) {
+                    return false;
+                }
+            }
+        }
+        offset = next;
+    }
+    return true;
+}
+
+static bool compileFunctionToNative(ObjClosure* closure, CodeBuffer* buffer, bool specialize,
+                                    JitEntry** entries, int* entryCount,
+                                    LiveInterval** intervals, int* intervalCount) {
+#if !defined(__x86_64__) || !defined(NAN_BOXING)
+    // The code is x86-64 and reads NaN-boxed values directly
+    (void)closure;
+    (void)buffer;
+    (void)specialize;
+    (void)entries;
+    (void)entryCount;
+    (void)intervals;
+    (void)intervalCount;
+    return false;
+#else
+    Chunk* chunk = &closure->function->chunk;
+    JitCompiler compiler;
+    compiler.buffer = buffer;
+    compiler.chunk = chunk;
+    compiler.nativeOffsets = malloc(sizeof(int) * (chunk->count + 1));
+    compiler.fixups = NULL;
+    compiler.fixupCount = 0;
+    compiler.fixupCapacity = 0;
+    compiler.failed = compiler.nativeOffsets == NULL;
+    compiler.intervals = NULL;
+    compiler.intervalCount = 0;
+    compiler.labels = NULL;
+    compiler.virtualCount = 0;
+    compiler.offset = -1;
+    compiler.specialized = specialize && !compiler.failed && planNumberLocals(&compiler);
+    if (compiler.failed) return false;
+    for (int i = 0; i <= chunk->count; i++) {
+        compiler.nativeOffsets[i] = -1;
+    }
+    
+    emitFunctionPrologue(buffer);
+    int functionStart = (int)buffer->size;
+    
+    for (int offset = 0; offset < chunk->count && !compiler.failed;) {
+        int length = unfusedLength(chunk, offset);
+        if (compiler.specialized) {
+            emitStartNumberLocals(&compiler, offset);
+            if (compiler.labels[offset]) emitFlushNumbers(&compiler);
+        }
+        compiler.nativeOffsets[offset] = (int)buffer->size;
+        compiler.offset = offset;
+        compileInstruction(&compiler, offset, length);
+        offset += length;
+    }
+    compiler.offset = -1;
+    
+    JitEntry* list = NULL;
+    int count = 0;
+    if (!compiler.failed) {
+        compiler.failed = !collectEntries(&compiler, &list, &count);
+    }
+    
+    // Calls start with the arguments still to load, and a loop entered
+    // from the interpreter with all its locals in memory
+    if (count > 0 && compiler.specialized) list[0].nativeOffset = functionStart;
+    for (int i = 1; i < count && compiler.specialized; i++) {
+        list[i].nativeOffset = (int)buffer->size;
+        emitLoadNumberLocals(&compiler, list[i].bytecodeOffset, true, true);
+        emitJumpTo(&compiler, CC_ALWAYS, list[i].bytecodeOffset);
+    }
+    
+    // Shared exits
+    int exitStub = (int)buffer->size;
+    emitIncMem32(buffer, &jitContext.totalSideExits);
+    emitFunctionEpilogue(buffer, INTERPRET_OK);
+    int returnStub = (int)buffer->size;
+    emitFunctionEpilogue(buffer, INTERPRET_OK);
+    int errorStub = (int)buffer->size;
+    emitFunctionEpilogue(buffer, INTERPRET_RUNTIME_ERROR);
+    
+    if (buffer->full) compiler.failed = true;
+    
+    for (int i = 0; i < compiler.fixupCount && !compiler.failed; i++) {
+        JumpFixup* fixup = &compiler.fixups[i];
+        int target;
+        switch (fixup->target) {
+            case JIT_TARGET_EXIT:   target = exitStub; break;
+            case JIT_TARGET_RETURN: target = returnStub; break;
+            case JIT_TARGET_ERROR:  target = errorStub; break;
+            default:
+                // Jumps may only land on instructions
+                if (fixup->target < 0 || fixup->target > chunk->count) {
+                    target = -1;
+                } else {
+                    target = compiler.nativeOffsets[fixup->target];
+                }
+                break;
+        }
+        if (target < 0) {
+            compiler.failed = true;
+            break;
         }
         
-        case OP_RETURN:
-            emitFunctionEpilogue(buffer);
-            return true;
-            
-        default:
-            // For unimplemented instructions, fall back to interpreter
-            return false;
+        int32_t rel = target - (int32_t)(fixup->position + 4);
+        memcpy(buffer->code + fixup->position, &rel, sizeof(rel));
     }
     
-    return true;
+    if (compiler.failed) {
+        free(list);
+    } else {
+        *entries = list;
+        *entryCount = count;
+    }
+    
+    // Specialized code hands back its intervals for dumpJitFunction()
+    if (!compiler.failed && compiler.specialized) {
+        *intervals = compiler.intervals;
+        *intervalCount = compiler.intervalCount;
+    } else {
+        free(compiler.intervals);
+    }
+    
+    free(compiler.nativeOffsets);
+    free(compiler.fixups);
+    free(compiler.labels);
+    return !compiler.failed;
+#endif
 }
 
 // Blacklist management
@@ -1121,6 +2319,19 @@ void dumpJitFunction(JitFunction* function) {
     printf("  Optimization Level: %d\n", function->optLevel);
     printf("  Average Execution Time: %.2f μs\n", function->avgExecutionTime);
     
+    // Where the number locals went, by bytecode offset
+    printf("  Register Allocation: %d intervals, %d spilled\n",
+           function->intervalCount, function->spillCount);
+    for (int i = 0; i < function->intervalCount; i++) {
+        LiveInterval* interval = &function->intervals[i];
+        printf("    slot %d [%d, %d]: ", interval->slot, interval->start, interval->end);
+        if (interval->reg < 0) {
+            printf("spilled\n");
+        } else {
+            printf("xmm%d\n", NUMBER_XMM_FIRST + interval->reg);
+        }
+    }
+    
     // Dump machine code bytes
     printf("  Machine Code: ");
     uint8_t* code = (uint8_t*)function->nativeCode;
@@ -18,6 +18,9 @@ typedef struct RegisterAllocator RegisterAllocator;
 #define JIT_MAX_INLINE_SIZE 100     
 #define JIT_MAX_REGISTERS 16        
 #define JIT_STACK_SLOTS 256         
+#define JIT_CODE_PER_BYTE 96        // Native bytes first reserved per bytecode byte
+#define JIT_MAX_NATIVE_STACK (1024 * 1024) // C stack compiled calls may nest in
+#define JIT_CODE_ARENA_SIZE (1024 * 1024)  // Compiled code is packed into these
 
 // JIT optimization levels
 typedef enum {
@@ -36,46 +39,80 @@ typedef enum {
 
 typedef struct {
     RegisterState state;
-    Value value;           
-    int lastUse;          
-    bool isDirty;         
+    int interval;                   // Live interval held, or -1
+    int lastUse;                    // Where that interval ends
 } RegisterInfo;
 
-// Register allocator
+// The bytecode a number local is live over, from where it takes its
+// value to its last use, and the register it was given
+typedef struct {
+    int start;
+    int end;
+    int slot;
+    int reg;                        // Allocator register, or -1 if spilled
+} LiveInterval;
+
+// Linear-scan register allocator. Intervals are handed registers in order
+// of their start; when none is free, whichever interval ends last stays
+// in its stack slot instead.
 typedef struct RegisterAllocator {
     RegisterInfo registers[JIT_MAX_REGISTERS];
-    int nextSpillSlot;
-    int currentInstruction;
+    int registerCount;              // Registers that can be handed out
+    int spillCount;                 // Intervals left in their stack slots
+    int currentInstruction;         // Start of the interval being placed
 } RegisterAllocator;
 
-// JIT function signature
-typedef InterpretResult (*JitCompiledFn)(VM* vm, CallFrame* frame);
+// JIT function signature. Compiled code starts running the frame at
+// `entry`, one of its JitEntry points.
+typedef InterpretResult (*JitCompiledFn)(VM* vm, CallFrame* frame, void* entry);
 
 // Hot spot tracking for tiered compilation
 typedef struct HotSpot {
     uint8_t* bytecode;      
     int hitCount;           
+    int backEdgeCount;              // Loop iterations run by the interpreter
     bool isFunction;        
     bool isLoop;            
     JitOptLevel optLevel;   
     struct HotSpot* next;   
 } HotSpot;
 
+// A bytecode offset compiled code can be entered at: the start of the
+// function, or the header of one of its loops
+typedef struct {
+    int bytecodeOffset;
+    int nativeOffset;
+} JitEntry;
+
 // Compiled JIT function
 typedef struct JitFunction {
     uint8_t* bytecodeStart;         
     uint8_t* bytecodeEnd;           
     JitCompiledFn nativeCode;       
     size_t codeSize;                
+    JitEntry* entries;              // Function start first, then loop headers
+    int entryCount;
     int callCount;                  
     JitOptLevel optLevel;           
     double avgExecutionTime;        
     bool isInlined;                 
     int localCount;                 
     int paramCount;                 
+    LiveInterval* intervals;        // Number locals and where they were put
+    int intervalCount;
+    int spillCount;
     struct JitFunction* next;       
 } JitFunction;
 
+// Executable memory that compiled functions are packed into, so calls
+// between small functions stay within a few pages
+typedef struct CodeArena {
+    uint8_t* base;
+    size_t size;
+    size_t used;
+    struct CodeArena* next;
+} CodeArena;
+
 // Blacklisted function entry
 typedef struct BlacklistedFunction {
     uint8_t* bytecodeStart;         
@@ -86,15 +123,20 @@ typedef struct BlacklistedFunction {
 typedef struct JitContext {
     HotSpot* hotSpots;              
     JitFunction* compiledFunctions; 
+    CodeArena* codeArenas;          // Newest first
     BlacklistedFunction* blacklistedFunctions; 
     bool enabled;                   
     JitOptLevel defaultOptLevel;    
     int totalCompilations;          
     int totalExecutions;            
     int totalOptimizations;         
+    int totalSideExits;             // Calls that left compiled code early
+    int totalOsrEntries;            // Loops entered mid-execution
     double totalCompileTime;        
     double totalExecutionTime;      
     RegisterAllocator* allocator;   
+    uintptr_t stackBase;            // C stack address when the JIT started
+    bool hasAvx;                    // Compiled code may clear upper AVX state
 } JitContext;
 
 // Global JIT context
@@ -106,7 +148,8 @@ void freeJIT();
 
 // Hot spot detection and management
 void trackHotSpot(uint8_t* bytecode, bool isFunction);
-void trackLoopBackEdge(uint8_t* bytecode);
+JitFunction* trackFunctionCall(ObjClosure* closure);
+JitFunction* trackLoopBackEdge(ObjClosure* closure);
 bool isHotSpot(uint8_t* bytecode);
 HotSpot* findHotSpot(uint8_t* bytecode);
 void promoteHotSpot(HotSpot* hotSpot);
@@ -122,11 +165,12 @@ bool shouldRecompile(JitFunction* function);
 InterpretResult executeJitFunction(JitFunction* function, VM* vm, CallFrame* frame);
 
 // Register allocation
-void initRegisterAllocator(RegisterAllocator* allocator);
-int allocateRegister(RegisterAllocator* allocator, Value value);
+void initRegisterAllocator(RegisterAllocator* allocator, int registerCount);
+int allocateRegister(RegisterAllocator* allocator, int interval, int end);
 void freeRegister(RegisterAllocator* allocator, int reg);
 void spillRegister(RegisterAllocator* allocator, int reg);
 int findBestRegisterToSpill(RegisterAllocator* allocator);
+void allocateRegisters(RegisterAllocator* allocator, LiveInterval* intervals, int count);
 
 // Optimization passes
 void applyBasicOptimizations(uint8_t* bytecode, size_t length);
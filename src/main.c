@@ -1,5 +1,6 @@
 //> Chunks of Bytecode main-c
 //> Scanning on Demand main-includes
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -12,6 +13,9 @@
 //> main-include-debug
 #include "debug.h"
 //< main-include-debug
+//> Pool Allocator main-include-memory
+#include "memory.h"
+//< Pool Allocator main-include-memory
 //> A Virtual Machine main-include-vm
 #include "vm.h"
 //< A Virtual Machine main-include-vm
@@ -33,6 +37,10 @@ static void printUsage() {
   fprintf(stderr, "  --jit-stats         Print JIT statistics at exit\n");
   fprintf(stderr, "  --jit-threshold N   Set function compilation threshold (default: 100)\n");
   fprintf(stderr, "  --jit-loop-threshold N Set loop compilation threshold (default: 50)\n");
+  fprintf(stderr, "  --pool-stats        Print memory pool occupancy at exit\n");
+  fprintf(stderr, "  --ic-stats          Print property inline cache counters at exit\n");
+  fprintf(stderr, "  --gc-pause-us N     Collect incrementally in slices of at most N microseconds\n");
+  fprintf(stderr, "  --max-frames N      Allow call depth up to N (default: %d)\n", FRAMES_MAX);
   fprintf(stderr, "  --repl              Enter REPL after executing script\n");
   fprintf(stderr, "  --version           Show version information\n");
   fprintf(stderr, "  --help              Show this help message\n");
@@ -52,6 +60,15 @@ static void printVersion() {
 static bool showJitStats = false;
 static bool enterReplAfterScript = false;
 //< JIT Integration command line parsing
+//> Pool Allocator stats-flag
+static bool showPoolStats = false;
+//< Pool Allocator stats-flag
+//> Inline Caches stats-flag
+static bool showIcStats = false;
+//< Inline Caches stats-flag
+//> Incremental GC pause-flag
+static int gcPauseUs = 0;
+//< Incremental GC pause-flag
 
 //> Scanning on Demand repl
 
@@ -161,6 +178,26 @@ int main(int argc, const char* argv[]) {
       // Enable JIT - we'll do this after initVM()
     } else if (strcmp(argv[i], "--jit-stats") == 0) {
       showJitStats = true;
+    } else if (strcmp(argv[i], "--pool-stats") == 0) {
+      showPoolStats = true;
+    } else if (strcmp(argv[i], "--ic-stats") == 0) {
+      showIcStats = true;
+    } else if (strcmp(argv[i], "--gc-pause-us") == 0) {
+      if (i + 1 >= argc || atoi(argv[i + 1]) <= 0) {
+        fprintf(stderr, "Error: --gc-pause-us requires a positive number\n");
+        exit(64);
+      }
+      gcPauseUs = atoi(argv[++i]);
+//> Stack Guards max-frames-flag
+    } else if (strcmp(argv[i], "--max-frames") == 0) {
+      if (i + 1 >= argc || atoi(argv[i + 1]) <= 0 ||
+          atoi(argv[i + 1]) > INT_MAX / STACK_SLOTS_PER_FRAME) {
+        fprintf(stderr, "Error: --max-frames requires a positive number up to %d\n",
+                INT_MAX / STACK_SLOTS_PER_FRAME);
+        exit(64);
+      }
+      setMaxFrames(atoi(argv[++i]));
+//< Stack Guards max-frames-flag
     } else if (strcmp(argv[i], "--repl") == 0) {
       enterReplAfterScript = true;
     } else if (strcmp(argv[i], "--jit-threshold") == 0) {
@@ -213,6 +250,9 @@ int main(int argc, const char* argv[]) {
     }
   }
 //< JIT Integration post-init setup
+//> Incremental GC post-init setup
+  vm.gcPauseUs = gcPauseUs;
+//< Incremental GC post-init setup
 
 //> Scanning on Demand args
   if (scriptPath == NULL) {
@@ -230,6 +270,16 @@ int main(int argc, const char* argv[]) {
     printJitStats();
   }
 //< JIT Integration print stats
+//> Pool Allocator print stats
+  if (showPoolStats) {
+    printPoolStats();
+  }
+//< Pool Allocator print stats
+//> Inline Caches print stats
+  if (showIcStats) {
+    printInlineCacheStats();
+  }
+//< Inline Caches print stats
   
   freeVM();
 //< Scanning on Demand args
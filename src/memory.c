@@ -1,12 +1,59 @@
 //> Chunks of Bytecode memory-c
+#include <stdint.h>
+//> Pool Allocator memory-include-stdio
+#include <stdio.h>
+//< Pool Allocator memory-include-stdio
 #include <stdlib.h>
+//> Incremental GC memory-include-time
+#include <sys/time.h>
+//< Incremental GC memory-include-time
 
 #include "memory.h"
 //> Strings memory-include-vm
 #include "vm.h"
 //< Strings memory-include-vm
+//> Garbage Collection memory-include-compiler
+#include "compiler.h"
+//< Garbage Collection memory-include-compiler
+//> Garbage Collection debug-log-includes
+
+#ifdef DEBUG_LOG_GC
+#include <stdio.h>
+#include "debug.h"
+#endif
+//< Garbage Collection debug-log-includes
+//> Garbage Collection heap-grow-factor
+
+#define GC_HEAP_GROW_FACTOR 2
+#define GC_HEAP_MIN_THRESHOLD (1024 * 1024)
+//< Garbage Collection heap-grow-factor
+//> Incremental GC start-collection-declaration
+
+static void startCollection();
+//< Incremental GC start-collection-declaration
 
 void* reallocate(void* pointer, size_t oldSize, size_t newSize) {
+//> Garbage Collection updated-bytes-allocated
+  vm.bytesAllocated += newSize - oldSize;
+//< Garbage Collection updated-bytes-allocated
+//> Garbage Collection call-collect
+  if (newSize > oldSize) {
+#ifdef DEBUG_STRESS_GC
+    collectGarbage();
+#endif
+//> collect-on-next
+    if (vm.bytesAllocated > vm.nextGC) {
+/* Garbage Collection collect-on-next < Incremental GC start-on-next
+      collectGarbage();
+*/
+//> Incremental GC start-on-next
+      startCollection();
+//< Incremental GC start-on-next
+    }
+//< collect-on-next
+  }
+
+//< Garbage Collection call-collect
   if (newSize == 0) {
     free(pointer);
     return NULL;
@@ -19,12 +66,463 @@ void* reallocate(void* pointer, size_t oldSize, size_t newSize) {
   return result;
 }
 
+//> Pool Allocator pools
+#define POOL_CLASS_OF(size) (((size) + POOL_GRANULE - 1) / POOL_GRANULE - 1)
+#define POOL_CELL_SIZE(sizeClass) (((sizeClass) + 1) * POOL_GRANULE)
+
+typedef struct PoolCell {
+  struct PoolCell* next;
+} PoolCell;
+
+typedef struct PoolSlab {
+  struct PoolSlab* next;
+  // Pads the header so the cells that follow stay 16-byte aligned.
+  max_align_t align;
+} PoolSlab;
+
+typedef struct {
+  PoolCell* freeList;
+  PoolSlab* slabs;
+  int slabCount;
+  int liveCount;
+} SizeClassPool;
+
+// Free lists are per thread, so VMs embedded on separate threads never
+// contend on a shared allocator lock.
+static _Thread_local SizeClassPool pools[POOL_CLASS_COUNT];
+
+static void growPool(SizeClassPool* pool, size_t cellSize) {
+  PoolSlab* slab = (PoolSlab*)malloc(POOL_SLAB_SIZE);
+  if (slab == NULL) exit(1);
+  slab->next = pool->slabs;
+  pool->slabs = slab;
+  pool->slabCount++;
+
+  // Thread every cell in the slab onto the free list, lowest address first
+  // so consecutive allocations are adjacent in memory.
+  uint8_t* start = (uint8_t*)(slab + 1);
+  size_t cellCount = (POOL_SLAB_SIZE - sizeof(PoolSlab)) / cellSize;
+  for (size_t i = cellCount; i > 0; i--) {
+    PoolCell* cell = (PoolCell*)(start + (i - 1) * cellSize);
+    cell->next = pool->freeList;
+    pool->freeList = cell;
+  }
+}
+
+void* poolAllocate(size_t size) {
+  vm.bytesAllocated += size;
+#ifdef DEBUG_STRESS_GC
+  collectGarbage();
+#endif
+  if (vm.bytesAllocated > vm.nextGC) {
+    startCollection();
+  }
+
+  int sizeClass = POOL_CLASS_OF(size);
+  SizeClassPool* pool = &pools[sizeClass];
+  if (pool->freeList == NULL) growPool(pool, POOL_CELL_SIZE(sizeClass));
+
+  PoolCell* cell = pool->freeList;
+  pool->freeList = cell->next;
+  pool->liveCount++;
+  return cell;
+}
+
+void poolFree(void* pointer, size_t size) {
+  vm.bytesAllocated -= size;
+
+  SizeClassPool* pool = &pools[POOL_CLASS_OF(size)];
+  PoolCell* cell = (PoolCell*)pointer;
+  cell->next = pool->freeList;
+  pool->freeList = cell;
+  pool->liveCount--;
+}
+
+void freePools() {
+  for (int i = 0; i < POOL_CLASS_COUNT; i++) {
+    SizeClassPool* pool = &pools[i];
+    while (pool->slabs != NULL) {
+      PoolSlab* next = pool->slabs->next;
+      free(pool->slabs);
+      pool->slabs = next;
+    }
+    pool->freeList = NULL;
+    pool->slabCount = 0;
+    pool->liveCount = 0;
+  }
+}
+
+void printPoolStats() {
+  printf("=== Memory Pool Statistics ===\n");
+  printf("Size Class  Slabs  Live Cells  Free Cells  Occupancy\n");
+  for (int i = 0; i < POOL_CLASS_COUNT; i++) {
+    SizeClassPool* pool = &pools[i];
+    if (pool->slabCount == 0) continue;
+
+    size_t cellSize = POOL_CELL_SIZE(i);
+    int capacity = pool->slabCount *
+        (int)((POOL_SLAB_SIZE - sizeof(PoolSlab)) / cellSize);
+    printf("%7zu B  %5d  %10d  %10d  %8.1f%%\n", cellSize, pool->slabCount,
+           pool->liveCount, capacity - pool->liveCount,
+           100.0 * pool->liveCount / capacity);
+  }
+
+  int nurseryLive = 0;
+  size_t nurseryUsed = 0;
+  for (NurseryBlock* block = vm.nursery; block != NULL; block = block->next) {
+    nurseryLive += block->liveCount;
+    nurseryUsed += block->top - (uint8_t*)block;
+  }
+  printf("Nursery: %d blocks, %zu KB bump-allocated, %d live objects\n",
+         vm.nurseryBlockCount, nurseryUsed / 1024, nurseryLive);
+  printf("Heap: %zu bytes allocated, next GC at %zu\n",
+         vm.bytesAllocated, vm.nextGC);
+  printf("==============================\n");
+}
+//< Pool Allocator pools
+
+//> Generational GC nursery
+#define NURSERY_ALIGN(size) (((size) + 7) & ~(size_t)7)
+#define NURSERY_BLOCK_START(block) \
+    ((uint8_t*)(block) + NURSERY_ALIGN(sizeof(NurseryBlock)))
+#define NURSERY_BLOCK_OF(object) \
+    ((NurseryBlock*)((uintptr_t)(object) & ~(uintptr_t)(NURSERY_BLOCK_SIZE - 1)))
+
+static NurseryBlock* newNurseryBlock() {
+  // Blocks are aligned to their size so an object's block can be found by
+  // masking its address.
+  NurseryBlock* block = (NurseryBlock*)aligned_alloc(NURSERY_BLOCK_SIZE,
+                                                     NURSERY_BLOCK_SIZE);
+  if (block == NULL) exit(1);
+
+  block->next = NULL;
+  block->top = NURSERY_BLOCK_START(block);
+  block->end = (uint8_t*)block + NURSERY_BLOCK_SIZE;
+  block->liveCount = 0;
+  block->retired = false;
+  vm.bytesAllocated += NURSERY_BLOCK_SIZE;
+  return block;
+}
+
+static void freeNurseryBlock(NurseryBlock* block) {
+  vm.bytesAllocated -= NURSERY_BLOCK_SIZE;
+  free(block);
+}
+
+// Moves allocation on to the next block with free space, growing the
+// nursery up to NURSERY_BLOCK_COUNT blocks. Returns NULL when the nursery
+// is exhausted and a minor collection is due.
+static NurseryBlock* nextNurseryBlock() {
+  if (vm.nurseryCurrent == NULL && vm.nursery != NULL) {
+    vm.nurseryCurrent = vm.nursery;
+    return vm.nurseryCurrent;
+  }
+
+  if (vm.nurseryCurrent != NULL && vm.nurseryCurrent->next != NULL) {
+    vm.nurseryCurrent = vm.nurseryCurrent->next;
+    return vm.nurseryCurrent;
+  }
+
+  if (vm.nurseryBlockCount >= NURSERY_BLOCK_COUNT) return NULL;
+
+  NurseryBlock* block = newNurseryBlock();
+  if (vm.nurseryCurrent == NULL) {
+    vm.nursery = block;
+  } else {
+    vm.nurseryCurrent->next = block;
+  }
+  vm.nurseryBlockCount++;
+  vm.nurseryCurrent = block;
+  return block;
+}
+
+void* nurseryAllocate(size_t size) {
+  size = NURSERY_ALIGN(size);
+#ifdef DEBUG_STRESS_GC
+  collectYoung();
+#endif
+
+  NurseryBlock* block = vm.nurseryCurrent;
+  while (block == NULL || block->top + size > block->end) {
+    block = nextNurseryBlock();
+    if (block == NULL) {
+      collectYoung();
+      block = vm.nurseryCurrent;
+    }
+  }
+
+  void* result = block->top;
+  block->top += size;
+  block->liveCount++;
+  return result;
+}
+
+// After a collection every object left in a nursery block is old. Empty
+// blocks are rewound for reuse, blocks with little room left are retired
+// to the old generation, and the rest keep bump-allocating after their
+// survivors.
+static void recycleNursery() {
+  NurseryBlock** link = &vm.nursery;
+  while (*link != NULL) {
+    NurseryBlock* block = *link;
+    if (block->liveCount == 0) {
+      block->top = NURSERY_BLOCK_START(block);
+      link = &block->next;
+    } else if (block->end - block->top < NURSERY_BLOCK_SIZE / 4) {
+      block->retired = true;
+      *link = block->next;
+      block->next = NULL;
+      vm.nurseryBlockCount--;
+    } else {
+      link = &block->next;
+    }
+  }
+
+  vm.nurseryCurrent = vm.nursery;
+}
+
+static void freeObjectMemory(Obj* object, size_t size) {
+  if (!object->inNursery) {
+/* Generational GC nursery < Pool Allocator free-from-pool
+    reallocate(object, size, 0);
+*/
+//> Pool Allocator free-from-pool
+    if (size <= POOL_MAX_SIZE) {
+      poolFree(object, size);
+    } else {
+      reallocate(object, size, 0);
+    }
+//< Pool Allocator free-from-pool
+    return;
+  }
+
+  NurseryBlock* block = NURSERY_BLOCK_OF(object);
+  block->liveCount--;
+  if (block->retired && block->liveCount == 0) {
+    freeNurseryBlock(block);
+  }
+}
+
+#define FREE_OBJECT(type, object) \
+    freeObjectMemory((Obj*)(object), sizeof(type))
+//< Generational GC nursery
+//> Generational GC remember-object
+void rememberObject(Obj* object) {
+  if (object->isRemembered) return;
+  object->isRemembered = true;
+
+  if (vm.rememberedCapacity < vm.rememberedCount + 1) {
+    vm.rememberedCapacity = GROW_CAPACITY(vm.rememberedCapacity);
+    vm.rememberedSet = (Obj**)realloc(vm.rememberedSet,
+                                      sizeof(Obj*) * vm.rememberedCapacity);
+    if (vm.rememberedSet == NULL) exit(1);
+  }
+
+  vm.rememberedSet[vm.rememberedCount++] = object;
+}
+
+static void clearRememberedSet() {
+  for (int i = 0; i < vm.rememberedCount; i++) {
+    vm.rememberedSet[i]->isRemembered = false;
+  }
+  vm.rememberedCount = 0;
+}
+//< Generational GC remember-object
+//> Garbage Collection mark-object
+void markObject(Obj* object) {
+  if (object == NULL) return;
+//> Incremental GC mark-for-cycle
+  if (vm.gcMarkingIncremental) {
+    shadeObject(object);
+    return;
+  }
+//< Incremental GC mark-for-cycle
+//> check-is-marked
+  if (object->isMarked) return;
+//< check-is-marked
+//> log-mark-object
+#ifdef DEBUG_LOG_GC
+  printf("%p mark ", (void*)object);
+  printValue(OBJ_VAL(object));
+  printf("\n");
+#endif
+
+//< log-mark-object
+  object->isMarked = true;
+//> add-to-gray-stack
+
+  if (vm.grayCapacity < vm.grayCount + 1) {
+    vm.grayCapacity = GROW_CAPACITY(vm.grayCapacity);
+    // The gray stack is owned by the collector, so it is grown with the
+    // system allocator rather than reallocate() to avoid recursing into GC.
+    vm.grayStack = (Obj**)realloc(vm.grayStack,
+                                  sizeof(Obj*) * vm.grayCapacity);
+//> exit-gray-stack
+    if (vm.grayStack == NULL) exit(1);
+//< exit-gray-stack
+  }
+
+  vm.grayStack[vm.grayCount++] = object;
+//< add-to-gray-stack
+}
+//< Garbage Collection mark-object
+//> Garbage Collection mark-value
+void markValue(Value value) {
+  if (IS_OBJ(value)) markObject(AS_OBJ(value));
+}
+//< Garbage Collection mark-value
+//> Garbage Collection mark-array
+static void markArray(ValueArray* array) {
+  for (int i = 0; i < array->count; i++) {
+    markValue(array->values[i]);
+  }
+}
+//< Garbage Collection mark-array
+//> Garbage Collection blacken-object
+static void blackenObject(Obj* object) {
+//> log-blacken-object
+#ifdef DEBUG_LOG_GC
+  printf("%p blacken ", (void*)object);
+  printValue(OBJ_VAL(object));
+  printf("\n");
+#endif
+
+//< log-blacken-object
+  switch (object->type) {
+//> Arrays blacken-array
+    case OBJ_ARRAY:
+      markArray(&((ObjArray*)object)->elements);
+      break;
+//< Arrays blacken-array
+//> blacken-bound-method
+    case OBJ_BOUND_METHOD: {
+      ObjBoundMethod* bound = (ObjBoundMethod*)object;
+      markValue(bound->receiver);
+      markObject((Obj*)bound->method);
+      break;
+    }
+//< blacken-bound-method
+//> blacken-class
+    case OBJ_CLASS: {
+      ObjClass* klass = (ObjClass*)object;
+      markObject((Obj*)klass->name);
+      markTable(&klass->methods);
+//> Shapes blacken-class-shape
+      markObject((Obj*)klass->emptyShape);
+//< Shapes blacken-class-shape
+      break;
+    }
+//< blacken-class
+//> blacken-closure
+    case OBJ_CLOSURE: {
+      ObjClosure* closure = (ObjClosure*)object;
+      markObject((Obj*)closure->function);
+      for (int i = 0; i < closure->upvalueCount; i++) {
+        markObject((Obj*)closure->upvalues[i]);
+      }
+      break;
+    }
+//< blacken-closure
+//> blacken-function
+    case OBJ_FUNCTION: {
+      ObjFunction* function = (ObjFunction*)object;
+      markObject((Obj*)function->name);
+      markObject((Obj*)function->returnType.className);
+      markArray(&function->chunk.constants);
+//> Inline Caches mark-property-caches
+      for (int i = 0; i < function->chunk.propertyCacheCount; i++) {
+        PropertyCache* cache = &function->chunk.propertyCaches[i];
+        for (int j = 0; j < cache->count; j++) {
+          markObject((Obj*)cache->entries[j].shape);
+          markObject((Obj*)cache->entries[j].transition);
+          markValue(cache->entries[j].method);
+        }
+      }
+      for (int i = 0; i < function->chunk.callCacheCount; i++) {
+        markObject(function->chunk.callCaches[i].key);
+        markObject((Obj*)function->chunk.callCaches[i].closure);
+      }
+//< Inline Caches mark-property-caches
+      break;
+    }
+//< blacken-function
+//> blacken-hash
+    case OBJ_HASH: {
+      ObjHash* hash = (ObjHash*)object;
+      markTable(&hash->table);
+      break;
+    }
+//< blacken-hash
+//> blacken-instance
+    case OBJ_INSTANCE: {
+      ObjInstance* instance = (ObjInstance*)object;
+      markObject((Obj*)instance->klass);
+/* Classes and Instances blacken-instance < Shapes blacken-instance-slots
+      markTable(&instance->fields);
+*/
+//> Shapes blacken-instance-slots
+      markObject((Obj*)instance->shape);
+      for (int i = 0; i < instance->shape->fieldCount; i++) {
+        markValue(instance->fields[i]);
+      }
+//< Shapes blacken-instance-slots
+      break;
+    }
+//< blacken-instance
+//> blacken-module
+    case OBJ_MODULE: {
+      ObjModule* module = (ObjModule*)object;
+      markObject((Obj*)module->name);
+      markTable(&module->functions);
+//> Module Slots blacken-module-slots
+      markArray(&module->slots);
+//< Module Slots blacken-module-slots
+      break;
+    }
+//< blacken-module
+//> Shapes blacken-shape
+    case OBJ_SHAPE: {
+      // Earlier names are reached through the parent chain.
+      ObjShape* shape = (ObjShape*)object;
+      markObject((Obj*)shape->parent);
+      if (shape->fieldCount > 0) {
+        markObject((Obj*)shape->names[shape->fieldCount - 1]);
+      }
+      markTable(&shape->transitions);
+      break;
+    }
+//< Shapes blacken-shape
+//> blacken-upvalue
+    case OBJ_UPVALUE:
+      markValue(((ObjUpvalue*)object)->closed);
+      break;
+//< blacken-upvalue
+    case OBJ_NATIVE:
+    case OBJ_STRING:
+      break;
+  }
+}
+//< Garbage Collection blacken-object
 //> Strings free-object
 static void freeObject(Obj* object) {
+//> Garbage Collection log-free-object
+#ifdef DEBUG_LOG_GC
+  printf("%p free type %d\n", (void*)object, object->type);
+#endif
+
+//< Garbage Collection log-free-object
   switch (object->type) {
+//> Arrays free-array
+    case OBJ_ARRAY: {
+      ObjArray* array = (ObjArray*)object;
+      freeValueArray(&array->elements);
+      FREE_OBJECT(ObjArray, object);
+      break;
+    }
+//< Arrays free-array
 //> Methods and Initializers free-bound-method
     case OBJ_BOUND_METHOD:
-      FREE(ObjBoundMethod, object);
+      FREE_OBJECT(ObjBoundMethod, object);
       break;
 //< Methods and Initializers free-bound-method
 //> Classes and Instances free-class
@@ -33,7 +531,7 @@ static void freeObject(Obj* object) {
       ObjClass* klass = (ObjClass*)object;
       freeTable(&klass->methods);
 //< Methods and Initializers free-methods
-      FREE(ObjClass, object);
+      FREE_OBJECT(ObjClass, object);
       break;
     } // [braces]
 //< Classes and Instances free-class
@@ -44,7 +542,7 @@ static void freeObject(Obj* object) {
       FREE_ARRAY(ObjUpvalue*, closure->upvalues,
                  closure->upvalueCount);
 //< free-upvalues
-      FREE(ObjClosure, object);
+      FREE_OBJECT(ObjClosure, object);
       break;
     }
 //< Closures free-closure
@@ -52,15 +550,24 @@ static void freeObject(Obj* object) {
     case OBJ_FUNCTION: {
       ObjFunction* function = (ObjFunction*)object;
       freeChunk(&function->chunk);
-      FREE(ObjFunction, object);
+      FREE_OBJECT(ObjFunction, object);
       break;
     }
 //< Calls and Functions free-function
 //> Classes and Instances free-instance
     case OBJ_INSTANCE: {
       ObjInstance* instance = (ObjInstance*)object;
+/* Classes and Instances free-instance < Shapes free-instance-slots
       freeTable(&instance->fields);
-      FREE(ObjInstance, object);
+      FREE_OBJECT(ObjInstance, object);
+*/
+//> Shapes free-instance-slots
+      if (instance->fields != instance->inlineFields) {
+        FREE_ARRAY(Value, instance->fields, instance->capacity);
+      }
+      freeObjectMemory(object, sizeof(ObjInstance) +
+                               sizeof(Value) * instance->inlineCapacity);
+//< Shapes free-instance-slots
       break;
     }
 //< Classes and Instances free-instance
@@ -68,37 +575,50 @@ static void freeObject(Obj* object) {
     case OBJ_MODULE: {
       ObjModule* module = (ObjModule*)object;
       freeTable(&module->functions);
-      FREE(ObjModule, object);
+//> Module Slots free-module-slots
+      freeValueArray(&module->slots);
+//< Module Slots free-module-slots
+      FREE_OBJECT(ObjModule, object);
       break;
     }
 //< Module System free-module
 //> Calls and Functions free-native
     case OBJ_NATIVE:
-      FREE(ObjNative, object);
+      FREE_OBJECT(ObjNative, object);
       break;
 //< Calls and Functions free-native
+//> Shapes free-shape
+    case OBJ_SHAPE: {
+      ObjShape* shape = (ObjShape*)object;
+      FREE_ARRAY(ObjString*, shape->names, shape->fieldCount);
+      freeTable(&shape->transitions);
+      freeTable(&shape->index);
+      FREE_OBJECT(ObjShape, object);
+      break;
+    }
+//< Shapes free-shape
     case OBJ_STRING: {
       ObjString* string = (ObjString*)object;
       if (string->ownsChars) {
         // For owned strings with embedded chars, calculate total size including flexible array
         size_t totalSize = sizeof(ObjString) + (string->length + 1) * sizeof(char);
-        reallocate(string, totalSize, 0);
+        freeObjectMemory(object, totalSize);
       } else {
         // For constant strings, only free the ObjString structure (not the external chars)
-        FREE(ObjString, object);
+        FREE_OBJECT(ObjString, object);
       }
       break;
     }
 //> Closures free-upvalue
     case OBJ_UPVALUE:
-      FREE(ObjUpvalue, object);
+      FREE_OBJECT(ObjUpvalue, object);
       break;
 //< Closures free-upvalue
 //> Hash Objects free-hash
     case OBJ_HASH: {
       ObjHash* hash = (ObjHash*)object;
       freeTable(&hash->table);
-      FREE(ObjHash, object);
+      FREE_OBJECT(ObjHash, object);
       break;
     }
 //< Hash Objects free-hash
@@ -106,6 +626,418 @@ static void freeObject(Obj* object) {
 }
 //< Strings free-object
 
+//> Garbage Collection mark-roots
+static void markRoots() {
+#if FAST_STACK_ENABLED
+  Value* stackBase = vm.fastStack;
+#else
+  Value* stackBase = vm.stack;
+#endif
+  for (Value* slot = stackBase; slot < vm.stackTop; slot++) {
+    markValue(*slot);
+  }
+//> mark-closures
+
+  for (int i = 0; i < vm.frameCount; i++) {
+    markObject((Obj*)vm.frames[i].closure);
+  }
+//< mark-closures
+//> mark-open-upvalues
+
+  for (ObjUpvalue* upvalue = vm.openUpvalues;
+       upvalue != NULL;
+       upvalue = upvalue->next) {
+    markObject((Obj*)upvalue);
+  }
+//< mark-open-upvalues
+
+/* Garbage Collection mark-globals < Global Slots mark-global-slots
+  markTable(&vm.globals);
+*/
+//> Global Slots mark-global-slots
+  markTable(&vm.globalNames);
+  markArray(&vm.globalValues);
+//< Global Slots mark-global-slots
+  markTable(&vm.modules);
+//> call-mark-compiler-roots
+  markCompilerRoots();
+//< call-mark-compiler-roots
+//> mark-init-string
+  markObject((Obj*)vm.initString);
+//< mark-init-string
+//> Arrays mark-array-method-names
+  markObject((Obj*)vm.pushString);
+  markObject((Obj*)vm.popString);
+  markObject((Obj*)vm.lenString);
+//< Arrays mark-array-method-names
+//> mark-vm-caches
+  markVMCaches();
+//< mark-vm-caches
+//> Memory Safety mark-scope-objects
+  // Scope tracking holds raw pointers until the scope closes.
+  for (int i = 0; i < vm.scopeObjectCount; i++) {
+    markObject(vm.scopeObjects[i]);
+  }
+//< Memory Safety mark-scope-objects
+}
+//< Garbage Collection mark-roots
+//> Garbage Collection trace-references
+static void traceReferences() {
+  while (vm.grayCount > 0) {
+    Obj* object = vm.grayStack[--vm.grayCount];
+    blackenObject(object);
+  }
+}
+//< Garbage Collection trace-references
+//> Garbage Collection sweep
+static void sweep() {
+  Obj* previous = NULL;
+  Obj* object = vm.objects;
+  while (object != NULL) {
+    if (object->isMarked) {
+/* Garbage Collection sweep < Generational GC sticky-mark
+      object->isMarked = false;
+*/
+      // Survivors keep their mark bit: marked means old.
+      previous = object;
+      object = object->next;
+    } else {
+      Obj* unreached = object;
+      object = object->next;
+      if (previous != NULL) {
+        previous->next = object;
+      } else {
+        vm.objects = object;
+      }
+
+      freeObject(unreached);
+    }
+  }
+}
+//< Garbage Collection sweep
+//> Generational GC sweep-young
+static void sweepYoung() {
+  Obj* object = vm.youngObjects;
+  while (object != NULL) {
+    Obj* next = object->next;
+    if (object->isMarked) {
+      // Promote: the object joins the old list and keeps its mark.
+      object->next = vm.objects;
+      vm.objects = object;
+//> Incremental GC promote-during-sweep
+      // The incremental sweep may still reach the head of the old list,
+      // and this object is known to be live.
+      if (vm.gcPhase == GC_PHASE_SWEEP) object->markEpoch = vm.gcEpoch;
+//< Incremental GC promote-during-sweep
+    } else {
+      freeObject(object);
+    }
+    object = next;
+  }
+
+  vm.youngObjects = NULL;
+}
+//< Generational GC sweep-young
+//> Generational GC remove-white-young-strings
+// Only strings allocated since the last collection can have died in a
+// minor collection, so drop those from the intern table directly rather
+// than scanning every entry in it.
+static void removeWhiteYoungStrings() {
+  for (Obj* object = vm.youngObjects; object != NULL; object = object->next) {
+    if (object->type == OBJ_STRING && !object->isMarked) {
+      tableDelete(&vm.strings, (ObjString*)object);
+    }
+  }
+}
+//< Generational GC remove-white-young-strings
+//> Generational GC collect-young
+void collectYoung() {
+#ifdef DEBUG_LOG_GC
+  printf("-- minor gc begin\n");
+  size_t before = vm.bytesAllocated;
+#endif
+
+  // Old objects are already marked, so marking stops at the generation
+  // boundary. Old objects written to since the last collection are
+  // rescanned instead.
+  markRoots();
+  for (int i = 0; i < vm.rememberedCount; i++) {
+    blackenObject(vm.rememberedSet[i]);
+  }
+//> Incremental GC minor-gray-roots
+  // Young objects waiting on an incremental cycle's gray stack must
+  // outlive this collection so the cycle can still scan them.
+  for (int i = 0; i < vm.incrementalGrayCount; i++) {
+    markObject(vm.incrementalGrayStack[i]);
+  }
+  markObject((Obj*)vm.gcScanHash);
+//< Incremental GC minor-gray-roots
+  clearRememberedSet();
+  traceReferences();
+  removeWhiteYoungStrings();
+  sweepYoung();
+  recycleNursery();
+
+#ifdef DEBUG_LOG_GC
+  printf("-- minor gc end\n");
+  printf("   heap %zu bytes (was %zu)\n", vm.bytesAllocated, before);
+#endif
+
+  if (vm.bytesAllocated > vm.nextGC) {
+    startCollection();
+  }
+}
+//< Generational GC collect-young
+//> Garbage Collection collect-garbage
+void collectGarbage() {
+//> log-before-collect
+#ifdef DEBUG_LOG_GC
+  printf("-- gc begin\n");
+//> log-before-size
+  size_t before = vm.bytesAllocated;
+//< log-before-size
+#endif
+//< log-before-collect
+//> Generational GC clear-old-marks
+
+  // A full collection traces the old generation too, so start it white.
+  for (Obj* object = vm.objects; object != NULL; object = object->next) {
+    object->isMarked = false;
+  }
+  clearRememberedSet();
+//< Generational GC clear-old-marks
+//> Incremental GC abort-cycle
+
+  // A full collection supersedes any incremental cycle in progress.
+  vm.gcPhase = GC_PHASE_IDLE;
+  vm.incrementalGrayCount = 0;
+  vm.gcScanHash = NULL;
+//< Incremental GC abort-cycle
+//> call-mark-roots
+
+  markRoots();
+//< call-mark-roots
+//> call-trace-references
+  traceReferences();
+//< call-trace-references
+//> sweep-strings
+  tableRemoveWhite(&vm.strings);
+//< sweep-strings
+//> call-sweep
+  sweep();
+//< call-sweep
+//> Generational GC full-sweep-young
+  sweepYoung();
+  recycleNursery();
+//< Generational GC full-sweep-young
+//> update-next-gc
+
+  vm.nextGC = vm.bytesAllocated * GC_HEAP_GROW_FACTOR;
+  if (vm.nextGC < GC_HEAP_MIN_THRESHOLD) {
+    vm.nextGC = GC_HEAP_MIN_THRESHOLD;
+  }
+//< update-next-gc
+//> log-after-collect
+
+#ifdef DEBUG_LOG_GC
+  printf("-- gc end\n");
+//> log-collected-amount
+  printf("   collected %zu bytes (from %zu to %zu) next at %zu\n",
+         before - vm.bytesAllocated, before, vm.bytesAllocated,
+         vm.nextGC);
+//< log-collected-amount
+#endif
+//< log-after-collect
+}
+//> Incremental GC incremental
+static uint64_t currentMicros() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return (uint64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+void shadeObject(Obj* object) {
+  if (object->markEpoch == vm.gcEpoch) return;
+  object->markEpoch = vm.gcEpoch;
+
+  if (vm.incrementalGrayCapacity < vm.incrementalGrayCount + 1) {
+    vm.incrementalGrayCapacity = GROW_CAPACITY(vm.incrementalGrayCapacity);
+    vm.incrementalGrayStack = (Obj**)realloc(vm.incrementalGrayStack,
+        sizeof(Obj*) * vm.incrementalGrayCapacity);
+    if (vm.incrementalGrayStack == NULL) exit(1);
+  }
+
+  vm.incrementalGrayStack[vm.incrementalGrayCount++] = object;
+}
+
+static void beginIncrementalCycle() {
+#ifdef DEBUG_LOG_GC
+  printf("-- incremental gc begin\n");
+#endif
+  // Epoch 0 is never used by a cycle, so new objects always start white.
+  vm.gcEpoch = vm.gcEpoch == UINT8_MAX ? 1 : vm.gcEpoch + 1;
+  vm.gcPhase = GC_PHASE_MARK;
+  vm.gcSafepointCountdown = GC_SAFEPOINT_INTERVAL;
+  vm.gcLastSliceEnd = 0;
+
+  vm.gcMarkingIncremental = true;
+  markRoots();
+  vm.gcMarkingIncremental = false;
+}
+
+// Blackening a hash with hundreds of thousands of entries in one go would
+// blow the pause budget, so large hashes are scanned GC_SCAN_CHUNK entries
+// at a time. Entries stored behind the cursor are shaded by the write
+// barrier. If the table is resized the entries move, so the scan restarts.
+static void scanHashChunk() {
+  Table* table = &vm.gcScanHash->table;
+  if (table->entries != vm.gcScanEntries ||
+      table->capacity != vm.gcScanCapacity) {
+    vm.gcScanEntries = table->entries;
+    vm.gcScanCapacity = table->capacity;
+    vm.gcScanIndex = 0;
+  }
+
+  int end = vm.gcScanIndex + GC_SCAN_CHUNK;
+  if (end > table->capacity) end = table->capacity;
+  for (int i = vm.gcScanIndex; i < end; i++) {
+    markValue(table->entries[i].key);
+    markValue(table->entries[i].value);
+  }
+
+  vm.gcScanIndex = end;
+  if (end == table->capacity) vm.gcScanHash = NULL;
+}
+
+// Scans gray objects until the stack is empty or `deadline` passes.
+// A deadline of 0 means no limit. Returns true when marking has caught up.
+static bool markSlice(uint64_t deadline) {
+  vm.gcMarkingIncremental = true;
+  int work = 0;
+  while (vm.gcScanHash != NULL || vm.incrementalGrayCount > 0) {
+    if (deadline != 0 && ++work % 64 == 0 && currentMicros() >= deadline) {
+      break;
+    }
+
+    if (vm.gcScanHash != NULL) {
+      scanHashChunk();
+      continue;
+    }
+
+    Obj* object = vm.incrementalGrayStack[--vm.incrementalGrayCount];
+    if (object->type == OBJ_HASH &&
+        ((ObjHash*)object)->table.capacity > GC_SCAN_CHUNK) {
+      vm.gcScanHash = (ObjHash*)object;
+      vm.gcScanEntries = NULL;
+      continue;
+    }
+    blackenObject(object);
+  }
+  vm.gcMarkingIncremental = false;
+  return vm.gcScanHash == NULL && vm.incrementalGrayCount == 0;
+}
+
+static void finishMarking() {
+  // The stack, globals and other roots are written without barriers, so
+  // they are rescanned atomically before anything is swept.
+  vm.gcMarkingIncremental = true;
+  markRoots();
+  vm.gcMarkingIncremental = false;
+  markSlice(0);
+
+  // Old objects this cycle found dead must not be rescanned by the next
+  // minor collection.
+  int kept = 0;
+  for (int i = 0; i < vm.rememberedCount; i++) {
+    Obj* object = vm.rememberedSet[i];
+    if (object->markEpoch == vm.gcEpoch) {
+      vm.rememberedSet[kept++] = object;
+    } else {
+      object->isRemembered = false;
+    }
+  }
+  vm.rememberedCount = kept;
+
+  vm.gcPhase = GC_PHASE_SWEEP;
+  vm.gcSweepLink = &vm.objects;
+}
+
+// Frees unreached old objects until the list is done or `deadline`
+// passes. Returns true when the sweep has finished.
+static bool sweepSlice(uint64_t deadline) {
+  int work = 0;
+  while (*vm.gcSweepLink != NULL) {
+    if (deadline != 0 && ++work % 64 == 0 && currentMicros() >= deadline) {
+      return false;
+    }
+
+    Obj* object = *vm.gcSweepLink;
+    if (object->markEpoch == vm.gcEpoch) {
+      vm.gcSweepLink = &object->next;
+      continue;
+    }
+
+    *vm.gcSweepLink = object->next;
+    if (object->type == OBJ_STRING) {
+      tableDelete(&vm.strings, (ObjString*)object);
+    }
+    freeObject(object);
+  }
+  return true;
+}
+
+static void endIncrementalCycle() {
+  vm.gcPhase = GC_PHASE_IDLE;
+  vm.gcSweepLink = NULL;
+
+  vm.nextGC = vm.bytesAllocated * GC_HEAP_GROW_FACTOR;
+  if (vm.nextGC < GC_HEAP_MIN_THRESHOLD) {
+    vm.nextGC = GC_HEAP_MIN_THRESHOLD;
+  }
+#ifdef DEBUG_LOG_GC
+  printf("-- incremental gc end, next at %zu\n", vm.nextGC);
+#endif
+}
+
+static void finishIncrementalCycle() {
+  if (vm.gcPhase == GC_PHASE_MARK) {
+    markSlice(0);
+    finishMarking();
+  }
+  sweepSlice(0);
+  endIncrementalCycle();
+}
+
+// Called when the heap crosses nextGC.
+static void startCollection() {
+  if (vm.gcPauseUs == 0) {
+    collectGarbage();
+  } else if (vm.gcPhase == GC_PHASE_IDLE) {
+    beginIncrementalCycle();
+  } else if (vm.bytesAllocated > vm.nextGC * GC_HEAP_GROW_FACTOR) {
+    // Allocation is outrunning the slices, so finish the cycle now.
+    finishIncrementalCycle();
+  }
+}
+
+void incrementalStep() {
+  vm.gcSafepointCountdown = GC_SAFEPOINT_INTERVAL;
+
+  // Leave the program at least one pause's worth of time between slices.
+  uint64_t now = currentMicros();
+  if (now - vm.gcLastSliceEnd < (uint64_t)vm.gcPauseUs) return;
+
+  uint64_t deadline = now + vm.gcPauseUs;
+  if (vm.gcPhase == GC_PHASE_MARK && markSlice(deadline)) {
+    finishMarking();
+  }
+  if (vm.gcPhase == GC_PHASE_SWEEP && sweepSlice(deadline)) {
+    endIncrementalCycle();
+  }
+  vm.gcLastSliceEnd = currentMicros();
+}
+//< Incremental GC incremental
+//< Garbage Collection collect-garbage
 //> Strings free-objects
 void freeObjects() {
   Obj* object = vm.objects;
@@ -114,5 +1046,52 @@ void freeObjects() {
     freeObject(object);
     object = next;
   }
+//> Generational GC free-young
+  object = vm.youngObjects;
+  while (object != NULL) {
+    Obj* next = object->next;
+    freeObject(object);
+    object = next;
+  }
+  vm.objects = NULL;
+  vm.youngObjects = NULL;
+
+  while (vm.nursery != NULL) {
+    NurseryBlock* next = vm.nursery->next;
+    freeNurseryBlock(vm.nursery);
+    vm.nursery = next;
+  }
+  vm.nurseryCurrent = NULL;
+  vm.nurseryBlockCount = 0;
+
+  free(vm.rememberedSet);
+  vm.rememberedSet = NULL;
+  vm.rememberedCount = 0;
+  vm.rememberedCapacity = 0;
+//< Generational GC free-young
+//> Incremental GC free-incremental-gray-stack
+  free(vm.incrementalGrayStack);
+  vm.incrementalGrayStack = NULL;
+  vm.incrementalGrayCount = 0;
+  vm.incrementalGrayCapacity = 0;
+  vm.gcScanHash = NULL;
+  vm.gcPhase = GC_PHASE_IDLE;
+//< Incremental GC free-incremental-gray-stack
+//> Pool Allocator free-pools
+  freePools();
+//< Pool Allocator free-pools
+//> Memory Safety free-scope-objects
+  free(vm.scopeObjects);
+  vm.scopeObjects = NULL;
+  vm.scopeObjectCount = 0;
+  vm.scopeObjectCapacity = 0;
+//< Memory Safety free-scope-objects
+//> Garbage Collection free-gray-stack
+
+  free(vm.grayStack);
+  vm.grayStack = NULL;
+  vm.grayCount = 0;
+  vm.grayCapacity = 0;
+//< Garbage Collection free-gray-stack
 }
 //< Strings free-objects
@@ -6,6 +6,9 @@
 //> Strings memory-include-object
 #include "object.h"
 //< Strings memory-include-object
+//> Incremental GC memory-include-vm
+#include "vm.h"
+//< Incremental GC memory-include-vm
 
 //> Strings allocate
 #define ALLOCATE(type, count) \
@@ -31,6 +34,79 @@
 
 void* reallocate(void* pointer, size_t oldSize, size_t newSize);
 //< grow-array
+//> Garbage Collection mark-object-h
+void markObject(Obj* object);
+//< Garbage Collection mark-object-h
+//> Garbage Collection mark-value-h
+void markValue(Value value);
+//< Garbage Collection mark-value-h
+//> Garbage Collection collect-garbage-h
+void collectGarbage();
+//< Garbage Collection collect-garbage-h
+//> Generational GC nursery-h
+// Small, short-lived objects are bump-allocated into a young generation
+// made of fixed-size blocks. Survivors of a minor collection are promoted
+// in place: their mark bit stays set ("sticky"), so outside of a
+// collection isMarked means "old".
+#define NURSERY_BLOCK_SIZE (64 * 1024)
+#define NURSERY_BLOCK_COUNT 16          // 1MB young generation
+#define NURSERY_MAX_OBJECT_SIZE 512     // Larger objects are malloc'd directly
+
+typedef struct NurseryBlock {
+  struct NurseryBlock* next;
+  uint8_t* top;         // Bump pointer
+  uint8_t* end;
+  int liveCount;        // Objects in this block that have not been freed
+  bool retired;         // Full of promoted objects; freed once they all die
+} NurseryBlock;
+
+void* nurseryAllocate(size_t size);
+void collectYoung();
+void rememberObject(Obj* object);
+//> Incremental GC incremental-h
+// With --gc-pause-us, a full collection is spread over slices of at most
+// that many microseconds, run at safepoints in the interpreter loop.
+#define GC_SAFEPOINT_INTERVAL 256   // Safepoints between clock checks
+#define GC_SCAN_CHUNK 64            // Hash entries scanned per unit of work
+
+void shadeObject(Obj* object);
+void incrementalStep();
+
+static inline void gcSafepoint() {
+  if (vm.gcPhase != GC_PHASE_IDLE && --vm.gcSafepointCountdown <= 0) {
+    incrementalStep();
+  }
+}
+//< Incremental GC incremental-h
+
+// Must be called after storing a reference to `value` inside `object`, so
+// minor collections can find young objects reachable only from old ones.
+static inline void writeBarrier(Obj* object, Value value) {
+  if (object->isMarked && IS_OBJ(value) && !AS_OBJ(value)->isMarked) {
+    rememberObject(object);
+  }
+//> Incremental GC write-barrier
+  // While a cycle is marking, shade every stored reference so a scanned
+  // object never ends up pointing at an unreached one.
+  if (vm.gcPhase == GC_PHASE_MARK && IS_OBJ(value)) {
+    shadeObject(AS_OBJ(value));
+  }
+//< Incremental GC write-barrier
+}
+//< Generational GC nursery-h
+//> Pool Allocator pool-h
+// Objects that bypass the nursery and fit in a size class are carved out
+// of fixed-size slabs instead of going to malloc one at a time.
+#define POOL_SLAB_SIZE 4096
+#define POOL_GRANULE 16
+#define POOL_MAX_SIZE 256
+#define POOL_CLASS_COUNT (POOL_MAX_SIZE / POOL_GRANULE)
+
+void* poolAllocate(size_t size);
+void poolFree(void* pointer, size_t size);
+void freePools();
+void printPoolStats();
+//< Pool Allocator pool-h
 //> Strings free-objects-h
 void freeObjects();
 //< Strings free-objects-h
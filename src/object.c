@@ -1,5 +1,8 @@
 //> Strings object-c
 #include <stdio.h>
+//> Memory Safety object-include-stdlib
+#include <stdlib.h>
+//< Memory Safety object-include-stdlib
 #include <string.h>
 
 #include "memory.h"
@@ -16,13 +19,51 @@
 //< allocate-obj
 //> allocate-object
 
+//> Generational GC pretenure
+// Functions, classes, modules and natives live for the whole program, so
+// they skip the nursery.
+static bool isPretenured(ObjType type) {
+  return type == OBJ_FUNCTION || type == OBJ_CLASS ||
+         type == OBJ_MODULE || type == OBJ_NATIVE || type == OBJ_SHAPE;
+}
+//< Generational GC pretenure
+
 static Obj* allocateObject(size_t size, ObjType type) {
+/* Strings allocate-object < Generational GC nursery-allocate
   Obj* object = (Obj*)reallocate(NULL, 0, size);
+*/
+//> Generational GC nursery-allocate
+  Obj* object;
+  bool inNursery = size <= NURSERY_MAX_OBJECT_SIZE && !isPretenured(type);
+  if (inNursery) {
+    object = (Obj*)nurseryAllocate(size);
+//> Pool Allocator allocate-from-pool
+  } else if (size <= POOL_MAX_SIZE) {
+    object = (Obj*)poolAllocate(size);
+//< Pool Allocator allocate-from-pool
+  } else {
+    object = (Obj*)reallocate(NULL, 0, size);
+  }
+  object->inNursery = inNursery;
+  object->isRemembered = false;
+//< Generational GC nursery-allocate
+//> Incremental GC init-mark-epoch
+  object->markEpoch = 0;
+//< Incremental GC init-mark-epoch
   object->type = type;
+//> Garbage Collection init-is-marked
+  object->isMarked = false;
+//< Garbage Collection init-is-marked
 //> add-to-list
   
+/* Strings add-to-list < Generational GC add-to-young-list
   object->next = vm.objects;
   vm.objects = object;
+*/
+//> Generational GC add-to-young-list
+  object->next = vm.youngObjects;
+  vm.youngObjects = object;
+//< Generational GC add-to-young-list
 //< add-to-list
 //> Memory Safety Initialization
   // Initialize memory safety fields
@@ -35,6 +76,16 @@ static Obj* allocateObject(size_t size, ObjType type) {
   return object;
 }
 //< allocate-object
+//> Arrays new-array
+ObjArray* newArray() {
+  ObjArray* array = ALLOCATE_OBJ(ObjArray, OBJ_ARRAY);
+  initValueArray(&array->elements);
+//> Memory Safety Init Array
+  initObjectMemorySafety((Obj*)array, vm.currentScopeDepth);
+//< Memory Safety Init Array
+  return array;
+}
+//< Arrays new-array
 //> Methods and Initializers new-bound-method
 ObjBoundMethod* newBoundMethod(Value receiver,
                                ObjClosure* method) {
@@ -48,6 +99,27 @@ ObjBoundMethod* newBoundMethod(Value receiver,
   return bound;
 }
 //< Methods and Initializers new-bound-method
+//> Shapes new-shape
+// Builds the shape reached from `parent` by adding `name`, or an empty
+// root shape when parent is NULL.
+static ObjShape* newShape(ObjShape* parent, ObjString* name) {
+  int fieldCount = parent == NULL ? 0 : parent->fieldCount + 1;
+  ObjString** names = ALLOCATE(ObjString*, fieldCount);
+  for (int i = 0; i < fieldCount - 1; i++) {
+    names[i] = parent->names[i];
+  }
+  if (fieldCount > 0) names[fieldCount - 1] = name;
+
+  ObjShape* shape = ALLOCATE_OBJ(ObjShape, OBJ_SHAPE);
+  shape->parent = parent;
+  shape->fieldCount = fieldCount;
+  shape->names = names;
+  initTable(&shape->transitions);
+  initTable(&shape->index);
+  initObjectMemorySafety((Obj*)shape, vm.currentScopeDepth);
+  return shape;
+}
+//< Shapes new-shape
 //> Classes and Instances new-class
 ObjClass* newClass(ObjString* name) {
   ObjClass* klass = ALLOCATE_OBJ(ObjClass, OBJ_CLASS);
@@ -55,6 +127,14 @@ ObjClass* newClass(ObjString* name) {
 //> Methods and Initializers init-methods
   initTable(&klass->methods);
 //< Methods and Initializers init-methods
+//> Shapes init-class-shape
+  klass->emptyShape = NULL;
+  klass->instanceSlots = INSTANCE_DEFAULT_SLOTS;
+  push(OBJ_VAL(klass));
+  klass->emptyShape = newShape(NULL, NULL);
+  writeBarrier((Obj*)klass, OBJ_VAL(klass->emptyShape));
+  (void)pop();
+//< Shapes init-class-shape
 //> Memory Safety Init Class
   initObjectMemorySafety((Obj*)klass, vm.currentScopeDepth);
 //< Memory Safety Init Class
@@ -94,6 +174,11 @@ ObjFunction* newFunction() {
 //> init-return-type
   function->returnType = TYPE_VOID; // Default to void
 //< init-return-type
+//> JIT Integration init-function-jit-fields
+  function->hotSpot = NULL;
+  function->jitFunction = NULL;
+  function->jitBlacklisted = false;
+//< JIT Integration init-function-jit-fields
   initChunk(&function->chunk);
 //> Memory Safety Init Function
   initObjectMemorySafety((Obj*)function, vm.currentScopeDepth);
@@ -103,15 +188,105 @@ ObjFunction* newFunction() {
 //< Calls and Functions new-function
 //> Classes and Instances new-instance
 ObjInstance* newInstance(ObjClass* klass) {
+/* Classes and Instances new-instance < Shapes new-instance-slots
   ObjInstance* instance = ALLOCATE_OBJ(ObjInstance, OBJ_INSTANCE);
   instance->klass = klass;
   initTable(&instance->fields);
+*/
+//> Shapes new-instance-slots
+  int slots = klass->instanceSlots;
+  ObjInstance* instance = (ObjInstance*)allocateObject(
+      sizeof(ObjInstance) + sizeof(Value) * slots, OBJ_INSTANCE);
+  instance->klass = klass;
+  instance->shape = klass->emptyShape;
+  instance->fields = instance->inlineFields;
+  instance->capacity = slots;
+  instance->inlineCapacity = slots;
+//< Shapes new-instance-slots
 //> Memory Safety Init Instance
   initObjectMemorySafety((Obj*)instance, vm.currentScopeDepth);
 //< Memory Safety Init Instance
   return instance;
 }
 //< Classes and Instances new-instance
+//> Shapes instance-fields
+int shapeFind(ObjShape* shape, ObjString* name) {
+  // Field names are interned, so a pointer compare identifies them.
+  if (shape->fieldCount <= SHAPE_LINEAR_FIELDS) {
+    for (int i = 0; i < shape->fieldCount; i++) {
+      if (shape->names[i] == name) return i;
+    }
+    return -1;
+  }
+
+  if (shape->index.count == 0) {
+    for (int i = 0; i < shape->fieldCount; i++) {
+      tableSet(&shape->index, shape->names[i], NUMBER_VAL(i));
+    }
+  }
+  Value slot;
+  if (!tableGet(&shape->index, name, &slot)) return -1;
+  return (int)AS_NUMBER(slot);
+}
+
+bool instanceGetField(ObjInstance* instance, ObjString* name, Value* value) {
+  int slot = shapeFind(instance->shape, name);
+  if (slot == -1) return false;
+  *value = instance->fields[slot];
+  return true;
+}
+
+// Follows the transition for `name`, creating it the first time any
+// instance of this shape gains that field.
+static ObjShape* shapeTransition(ObjShape* shape, ObjString* name) {
+  Value next;
+  if (tableGet(&shape->transitions, name, &next)) {
+    return AS_SHAPE(next);
+  }
+
+  ObjShape* child = newShape(shape, name);
+  push(OBJ_VAL(child));
+  tableSet(&shape->transitions, name, OBJ_VAL(child));
+  writeBarrier((Obj*)shape, OBJ_VAL(child));
+  (void)pop();
+  return child;
+}
+
+static void growFields(ObjInstance* instance) {
+  int capacity = GROW_CAPACITY(instance->capacity);
+  Value* fields = ALLOCATE(Value, capacity);
+  for (int i = 0; i < instance->shape->fieldCount; i++) {
+    fields[i] = instance->fields[i];
+  }
+  if (instance->fields != instance->inlineFields) {
+    FREE_ARRAY(Value, instance->fields, instance->capacity);
+  }
+  instance->fields = fields;
+  instance->capacity = capacity;
+}
+
+// The caller keeps `instance` and `value` reachable; adding a field can
+// allocate a shape and a larger slot array.
+void instanceSetField(ObjInstance* instance, ObjString* name, Value value) {
+  int slot = shapeFind(instance->shape, name);
+  if (slot == -1) {
+    ObjShape* shape = shapeTransition(instance->shape, name);
+    slot = instance->shape->fieldCount;
+    if (slot == instance->capacity) growFields(instance);
+    instance->shape = shape;
+    writeBarrier((Obj*)instance, OBJ_VAL(shape));
+
+    // Later instances of the class get room for every field seen so far.
+    ObjClass* klass = instance->klass;
+    if (shape->fieldCount > klass->instanceSlots &&
+        klass->instanceSlots < INSTANCE_MAX_INLINE_SLOTS) {
+      klass->instanceSlots = shape->fieldCount;
+    }
+  }
+  instance->fields[slot] = value;
+  writeBarrier((Obj*)instance, value);
+}
+//< Shapes instance-fields
 //> Hash Objects new-hash
 ObjHash* newHash() {
   ObjHash* hash = ALLOCATE_OBJ(ObjHash, OBJ_HASH);
@@ -127,12 +302,30 @@ ObjModule* newModule(ObjString* name) {
   ObjModule* module = ALLOCATE_OBJ(ObjModule, OBJ_MODULE);
   module->name = name;
   initTable(&module->functions);
+//> Module Slots init-module-slots
+  initValueArray(&module->slots);
+//< Module Slots init-module-slots
 //> Memory Safety Init Module
   initObjectMemorySafety((Obj*)module, vm.currentScopeDepth);
 //< Memory Safety Init Module
   return module;
 }
 //< Module System new-module
+//> Module Slots module-set-function
+// Redefining a name reuses its slot. Both the name and the function must
+// be reachable from the stack, since growing the slots can collect.
+void moduleSetFunction(ObjModule* module, ObjString* name, Value function) {
+  Value slot;
+  if (tableGet(&module->functions, name, &slot)) {
+    module->slots.values[(int)AS_NUMBER(slot)] = function;
+  } else {
+    writeValueArray(&module->slots, function);
+    tableSet(&module->functions, name,
+             NUMBER_VAL(module->slots.count - 1));
+  }
+  writeBarrier((Obj*)module, function);
+}
+//< Module Slots module-set-function
 //> Calls and Functions new-native
 ObjNative* newNative(NativeFn function) {
   ObjNative* native = ALLOCATE_OBJ(ObjNative, OBJ_NATIVE);
@@ -175,7 +368,13 @@ static ObjString* allocateString(char* chars, int length,
   initObjectMemorySafety((Obj*)string, vm.currentScopeDepth);
 //< Memory Safety Init String
 //> Hash Tables allocate-store-string
+//> Garbage Collection push-string
+  push(OBJ_VAL(string));
+//< Garbage Collection push-string
   tableSet(&vm.strings, string, NIL_VAL);
+//> Garbage Collection pop-string
+  (void)pop();
+//< Garbage Collection pop-string
 //< Hash Tables allocate-store-string
   return string;
 }
@@ -190,6 +389,19 @@ static uint32_t hashString(const char* key, int length) {
   return hash;
 }
 //< Hash Tables hash-string
+//> Incremental GC find-interned
+// The intern table is weak. Once an incremental cycle has finished
+// marking, a string it did not reach is about to be swept, so handing it
+// out again must mark it live.
+static ObjString* findInterned(const char* chars, int length,
+                               uint32_t hash) {
+  ObjString* interned = tableFindString(&vm.strings, chars, length, hash);
+  if (interned != NULL && vm.gcPhase == GC_PHASE_SWEEP) {
+    interned->obj.markEpoch = vm.gcEpoch;
+  }
+  return interned;
+}
+//< Incremental GC find-interned
 //> take-string
 ObjString* takeString(char* chars, int length) {
 /* Strings take-string < Hash Tables take-string-hash
@@ -198,23 +410,30 @@ ObjString* takeString(char* chars, int length) {
 //> Hash Tables take-string-hash
   uint32_t hash = hashString(chars, length);
 //> take-string-intern
-  ObjString* interned = tableFindString(&vm.strings, chars, length,
-                                        hash);
+  ObjString* interned = findInterned(chars, length, hash);
   if (interned != NULL) {
     FREE_ARRAY(char, chars, length + 1);
     return interned;
   }
 
 //< take-string-intern
+/* Hash Tables take-string-hash < Garbage Collection take-string-free
   return allocateString(chars, length, hash, true);
+*/
+//> Garbage Collection take-string-free
+  // allocateString() copies the characters into the object's embedded
+  // storage, so the caller's buffer is released here.
+  ObjString* string = allocateString(chars, length, hash, true);
+  FREE_ARRAY(char, chars, length + 1);
+  return string;
+//< Garbage Collection take-string-free
 //< Hash Tables take-string-hash
 }
 //< take-string
 //> constant-string
 ObjString* constantString(const char* chars, int length) {
   uint32_t hash = hashString(chars, length);
-  ObjString* interned = tableFindString(&vm.strings, chars, length,
-                                        hash);
+  ObjString* interned = findInterned(chars, length, hash);
   if (interned != NULL) return interned;
 
   return allocateString((char*)chars, length, hash, false);
@@ -224,21 +443,24 @@ ObjString* copyString(const char* chars, int length) {
 //> Hash Tables copy-string-hash
   uint32_t hash = hashString(chars, length);
 //> copy-string-intern
-  ObjString* interned = tableFindString(&vm.strings, chars, length,
-                                        hash);
+  ObjString* interned = findInterned(chars, length, hash);
   if (interned != NULL) return interned;
 
 //< copy-string-intern
 //< Hash Tables copy-string-hash
+/* Strings object-c < Garbage Collection copy-string-embedded
   char* heapChars = ALLOCATE(char, length + 1);
   memcpy(heapChars, chars, length);
   heapChars[length] = '\0';
+*/
 /* Strings object-c < Hash Tables copy-string-allocate
   return allocateString(heapChars, length);
 */
-//> Hash Tables copy-string-allocate
-  return allocateString(heapChars, length, hash, true);
-//< Hash Tables copy-string-allocate
+//> Garbage Collection copy-string-embedded
+  // Owned strings embed their characters, so there is no intermediate
+  // heap buffer to allocate (and leak) here.
+  return allocateString((char*)chars, length, hash, true);
+//< Garbage Collection copy-string-embedded
 }
 //> Closures new-upvalue
 ObjUpvalue* newUpvalue(Value* slot) {
@@ -270,6 +492,18 @@ static void printFunction(ObjFunction* function) {
 //> print-object
 void printObject(Value value) {
   switch (OBJ_TYPE(value)) {
+//> Arrays print-array
+    case OBJ_ARRAY: {
+      ObjArray* array = AS_ARRAY(value);
+      printf("[");
+      for (int i = 0; i < array->elements.count; i++) {
+        if (i > 0) printf(", ");
+        printValue(array->elements.values[i]);
+      }
+      printf("]");
+      break;
+    }
+//< Arrays print-array
 //> Methods and Initializers print-bound-method
     case OBJ_BOUND_METHOD:
       printFunction(AS_BOUND_METHOD(value)->method->function);
@@ -296,9 +530,15 @@ void printObject(Value value) {
       printf("{");
       bool first = true;
       for (int i = 0; i < hash->table.capacity; i++) {
-        if (hash->table.entries[i].key != NULL) {
+        Value key = hash->table.entries[i].key;
+        if (!IS_NIL(key)) {
           if (!first) printf(", ");
-          printf("\"%s\": ", AS_CSTRING(OBJ_VAL(hash->table.entries[i].key)));
+          if (IS_STRING(key)) {
+            printf("\"%s\"", AS_CSTRING(key));
+          } else {
+            printValue(key);
+          }
+          printf(": ");
           printValue(hash->table.entries[i].value);
           first = false;
         }
@@ -313,6 +553,11 @@ void printObject(Value value) {
              AS_CSTRING(OBJ_VAL(AS_INSTANCE(value)->klass->name)));
       break;
 //< Classes and Instances print-instance
+//> Shapes print-shape
+    case OBJ_SHAPE:
+      printf("<shape %d>", AS_SHAPE(value)->fieldCount);
+      break;
+//< Shapes print-shape
 //> Module System print-module
     case OBJ_MODULE:
       printf("module %s", AS_CSTRING(OBJ_VAL(AS_MODULE(value)->name)));
@@ -340,6 +585,20 @@ void printObject(Value value) {
 
 void initObjectMemorySafety(Obj* obj, int scopeDepth) {
   obj->borrowInfo.scopeDepth = scopeDepth;
+//> Memory Safety track-scope-object
+  if (scopeDepth == 0) return;
+
+  // Objects created inside a scope are remembered so closing the scope
+  // only visits its own objects. The list is grown with the system
+  // allocator because `obj` is not reachable yet.
+  if (vm.scopeObjectCapacity < vm.scopeObjectCount + 1) {
+    vm.scopeObjectCapacity = GROW_CAPACITY(vm.scopeObjectCapacity);
+    vm.scopeObjects = (Obj**)realloc(vm.scopeObjects,
+                                     sizeof(Obj*) * vm.scopeObjectCapacity);
+    if (vm.scopeObjects == NULL) exit(1);
+  }
+  vm.scopeObjects[vm.scopeObjectCount++] = obj;
+//< Memory Safety track-scope-object
 }
 
 bool tryBorrowShared(Obj* obj) {
@@ -405,9 +664,9 @@ void dropObject(Obj* obj) {
   // The object will be cleaned up when all references are gone
 }
 
-void cleanupScopeObjects(int scopeDepth) {
-  // Walk through all objects and drop those created in this scope or deeper
-  Obj* current = vm.objects;
+/* Generational GC cleanup-scope-objects < Memory Safety scope-object-list
+static void dropScopeObjects(Obj* list, int scopeDepth) {
+  Obj* current = list;
   while (current != NULL) {
     if (current->borrowInfo.scopeDepth >= scopeDepth && 
         !current->borrowInfo.isDropped) {
@@ -416,6 +675,38 @@ void cleanupScopeObjects(int scopeDepth) {
     current = current->next;
   }
 }
+
+void cleanupScopeObjects(int scopeDepth) {
+  // Walk through all objects, young and old, and drop those created in
+  // this scope or deeper
+  dropScopeObjects(vm.youngObjects, scopeDepth);
+  dropScopeObjects(vm.objects, scopeDepth);
+}
+*/
+//> Memory Safety scope-object-list
+// Inner scopes close before outer ones, so the objects created in this
+// scope or deeper are always the ones at the end of the list.
+static void popScopeObjects(int scopeDepth, bool drop) {
+  while (vm.scopeObjectCount > 0) {
+    Obj* object = vm.scopeObjects[vm.scopeObjectCount - 1];
+    if (object->borrowInfo.scopeDepth < scopeDepth) break;
+
+    if (drop) dropObject(object);
+    vm.scopeObjectCount--;
+  }
+}
+
+void cleanupScopeObjects(int scopeDepth) {
+  popScopeObjects(scopeDepth, true);
+}
+
+// Stops tracking objects from a scope that is discarded rather than
+// closed, such as a function body. They live on as the function's
+// constants.
+void releaseScopeObjects(int scopeDepth) {
+  popScopeObjects(scopeDepth, false);
+}
+//< Memory Safety scope-object-list
 //< Memory Safety Implementation
 
 //> String comparison function for type system
@@ -32,6 +32,9 @@ typedef struct BorrowInfo {
 //< obj-type-macro
 //> is-string
 
+//> Arrays is-array
+#define IS_ARRAY(value)        isObjType(value, OBJ_ARRAY)
+//< Arrays is-array
 //> Methods and Initializers is-bound-method
 #define IS_BOUND_METHOD(value) isObjType(value, OBJ_BOUND_METHOD)
 //< Methods and Initializers is-bound-method
@@ -56,10 +59,16 @@ typedef struct BorrowInfo {
 //> Calls and Functions is-native
 #define IS_NATIVE(value)       isObjType(value, OBJ_NATIVE)
 //< Calls and Functions is-native
+//> Shapes is-shape
+#define IS_SHAPE(value)        isObjType(value, OBJ_SHAPE)
+//< Shapes is-shape
 #define IS_STRING(value)       isObjType(value, OBJ_STRING)
 //< is-string
 //> as-string
 
+//> Arrays as-array
+#define AS_ARRAY(value)        ((ObjArray*)AS_OBJ(value))
+//< Arrays as-array
 //> Methods and Initializers as-bound-method
 #define AS_BOUND_METHOD(value) ((ObjBoundMethod*)AS_OBJ(value))
 //< Methods and Initializers as-bound-method
@@ -85,12 +94,18 @@ typedef struct BorrowInfo {
 #define AS_NATIVE(value) \
     (((ObjNative*)AS_OBJ(value))->function)
 //< Calls and Functions as-native
+//> Shapes as-shape
+#define AS_SHAPE(value)        ((ObjShape*)AS_OBJ(value))
+//< Shapes as-shape
 #define AS_STRING(value)       ((ObjString*)AS_OBJ(value))
 #define AS_CSTRING(value)      (AS_STRING(value)->chars)
 //< as-string
 //> obj-type
 
 typedef enum {
+//> Arrays obj-type-array
+  OBJ_ARRAY,
+//< Arrays obj-type-array
 //> Methods and Initializers obj-type-bound-method
   OBJ_BOUND_METHOD,
 //< Methods and Initializers obj-type-bound-method
@@ -115,6 +130,9 @@ typedef enum {
 //> Calls and Functions obj-type-native
   OBJ_NATIVE,
 //< Calls and Functions obj-type-native
+//> Shapes obj-type-shape
+  OBJ_SHAPE,
+//< Shapes obj-type-shape
   OBJ_STRING,
 //> Closures obj-type-upvalue
   OBJ_UPVALUE
@@ -130,7 +148,8 @@ typedef enum {
   RETURN_TYPE_VOID,
   RETURN_TYPE_FUNC,
   RETURN_TYPE_OBJ,
-  RETURN_TYPE_HASH
+  RETURN_TYPE_HASH,
+  RETURN_TYPE_ARRAY
 } BaseType;
 
 // New type system with mutability and nullability
@@ -230,6 +249,7 @@ static const GemType TYPE_VOID = {RETURN_TYPE_VOID, false, false, NULL};
 static const GemType TYPE_FUNC = {RETURN_TYPE_FUNC, false, false, NULL};
 static const GemType TYPE_OBJ = {RETURN_TYPE_OBJ, false, false, NULL};
 static const GemType TYPE_HASH = {RETURN_TYPE_HASH, false, false, NULL};
+static const GemType TYPE_ARRAY = {RETURN_TYPE_ARRAY, false, false, NULL};
 
 // Helper functions for backward compatibility
 static inline GemType makeType(BaseType baseType) {
@@ -254,6 +274,16 @@ struct Obj {
 //> next-field
   struct Obj* next;
 //< next-field
+//> Garbage Collection is-marked-field
+  bool isMarked;
+//< Garbage Collection is-marked-field
+//> Generational GC obj-fields
+  bool isRemembered;    // Old object queued for rescanning by the next minor GC
+  bool inNursery;       // Bump-allocated in a nursery block rather than malloc'd
+//< Generational GC obj-fields
+//> Incremental GC obj-fields
+  uint8_t markEpoch;    // Last incremental cycle that reached this object
+//< Incremental GC obj-fields
 //> Memory Safety Fields
   BorrowInfo borrowInfo;
   int refCount;         // Reference count for automatic cleanup
@@ -272,6 +302,13 @@ typedef struct {
 //> return-type-field
   ReturnType returnType;
 //< return-type-field
+//> JIT Integration function-jit-fields
+  // JIT bookkeeping lives on the function so the call path never has to
+  // search for it.
+  struct HotSpot* hotSpot;          // Call counter, created on first call
+  struct JitFunction* jitFunction;  // Native code, or NULL
+  bool jitBlacklisted;              // Compilation failed; don't retry
+//< JIT Integration function-jit-fields
 } ObjFunction;
 //< Calls and Functions obj-function
 //> Calls and Functions obj-native
@@ -309,7 +346,7 @@ typedef struct ObjUpvalue {
 } ObjUpvalue;
 //< Closures obj-upvalue
 //> Closures obj-closure
-typedef struct {
+typedef struct ObjClosure {
   Obj obj;
   ObjFunction* function;
 //> upvalue-fields
@@ -318,6 +355,22 @@ typedef struct {
 //< upvalue-fields
 } ObjClosure;
 //< Closures obj-closure
+//> Shapes obj-shape
+
+// Field layout shared by every instance that added the same fields in the
+// same order. Slot i of an instance with this shape holds names[i]. Adding
+// a field moves the instance along a transition to a child shape.
+#define SHAPE_LINEAR_FIELDS 8   // Larger shapes look fields up in `index`
+
+typedef struct ObjShape {
+  Obj obj;
+  struct ObjShape* parent; // NULL for a class's empty shape
+  int fieldCount;
+  ObjString** names;       // Field name for each slot
+  Table transitions;       // Field name -> child shape
+  Table index;             // Field name -> slot, built on first lookup
+} ObjShape;
+//< Shapes obj-shape
 //> Classes and Instances obj-class
 
 typedef struct {
@@ -326,15 +379,35 @@ typedef struct {
 //> Methods and Initializers class-methods
   Table methods;
 //< Methods and Initializers class-methods
+//> Shapes class-shape
+  ObjShape* emptyShape;    // Root of this class's shape tree
+  int instanceSlots;       // Inline slots given to each new instance
+//< Shapes class-shape
 } ObjClass;
 //< Classes and Instances obj-class
 //> Classes and Instances obj-instance
 
+/* Classes and Instances obj-instance < Shapes instance-slots
 typedef struct {
   Obj obj;
   ObjClass* klass;
   Table fields; // [fields]
 } ObjInstance;
+*/
+//> Shapes instance-slots
+#define INSTANCE_DEFAULT_SLOTS 4
+#define INSTANCE_MAX_INLINE_SLOTS 32
+
+typedef struct {
+  Obj obj;
+  ObjClass* klass;
+  ObjShape* shape;         // shape->fieldCount slots of fields are in use
+  Value* fields;           // inlineFields until the instance outgrows them
+  int capacity;
+  int inlineCapacity;
+  Value inlineFields[];
+} ObjInstance;
+//< Shapes instance-slots
 //< Classes and Instances obj-instance
 
 //> Hash Objects obj-hash
@@ -344,11 +417,24 @@ typedef struct {
 } ObjHash;
 //< Hash Objects obj-hash
 
+//> Arrays obj-array
+typedef struct {
+  Obj obj;
+  ValueArray elements; // Contiguous storage, indexed directly
+} ObjArray;
+//< Arrays obj-array
+
 //> Module System obj-module
 typedef struct {
   Obj obj;
   ObjString* name;
+/* Module System obj-module < Module Slots obj-module-slots
   Table functions; // Functions defined in this module
+*/
+//> Module Slots obj-module-slots
+  Table functions;  // Function name -> index into slots
+  ValueArray slots; // Closures, in definition order
+//< Module Slots obj-module-slots
 } ObjModule;
 //< Module System obj-module
 
@@ -360,6 +446,9 @@ typedef struct {
 } ObjBoundMethod;
 
 //< Methods and Initializers obj-bound-method
+//> Arrays new-array-h
+ObjArray* newArray();
+//< Arrays new-array-h
 //> Methods and Initializers new-bound-method-h
 ObjBoundMethod* newBoundMethod(Value receiver,
                                ObjClosure* method);
@@ -376,12 +465,20 @@ ObjFunction* newFunction();
 //> Classes and Instances new-instance-h
 ObjInstance* newInstance(ObjClass* klass);
 //< Classes and Instances new-instance-h
+//> Shapes instance-field-h
+int shapeFind(ObjShape* shape, ObjString* name);
+bool instanceGetField(ObjInstance* instance, ObjString* name, Value* value);
+void instanceSetField(ObjInstance* instance, ObjString* name, Value value);
+//< Shapes instance-field-h
 //> Hash Objects new-hash-h
 ObjHash* newHash();
 //< Hash Objects new-hash-h
 //> Module System new-module-h
 ObjModule* newModule(ObjString* name);
 //< Module System new-module-h
+//> Module Slots module-function-h
+void moduleSetFunction(ObjModule* module, ObjString* name, Value function);
+//< Module Slots module-function-h
 //> Calls and Functions new-native-h
 ObjNative* newNative(NativeFn function);
 //< Calls and Functions new-native-h
@@ -415,6 +512,7 @@ void decrementRef(Obj* obj);
 bool isObjectDropped(Obj* obj);
 void dropObject(Obj* obj);
 void cleanupScopeObjects(int scopeDepth);
+void releaseScopeObjects(int scopeDepth);
 //< Memory Safety Functions
 
 //< copy-string-h
@@ -0,0 +1,79 @@
+//> Superinstructions peephole-c
+#include "peephole.h"
+
+// A run of instructions that dispatches often enough to earn its own
+// handler. The set comes from an opcode-pair histogram of the benchmarks
+// and test suite: local loads feeding arithmetic, `x = ...;` statements,
+// and the pop that ends every loop body.
+typedef struct {
+  uint8_t fused;
+  int length;
+  uint8_t sequence[3];
+} Superinstruction;
+
+// Longer sequences come first so that matching is greedy.
+static const Superinstruction superinstructions[] = {
+  {OP_ADD_LOCAL_LOCAL, 3, {OP_GET_LOCAL, OP_GET_LOCAL, OP_ADD_NUMBER}},
+  {OP_ADD_LOCAL_CONSTANT, 3, {OP_GET_LOCAL, OP_CONSTANT, OP_ADD_NUMBER}},
+  {OP_SUBTRACT_LOCAL_CONSTANT, 3,
+   {OP_GET_LOCAL, OP_CONSTANT, OP_SUBTRACT_NUMBER}},
+  {OP_GET_LOCAL_GET_LOCAL, 2, {OP_GET_LOCAL, OP_GET_LOCAL}},
+  {OP_GET_LOCAL_CONSTANT, 2, {OP_GET_LOCAL, OP_CONSTANT}},
+  {OP_SET_LOCAL_POP, 2, {OP_SET_LOCAL, OP_POP}},
+  {OP_SET_GLOBAL_SLOT_POP, 2, {OP_SET_GLOBAL_SLOT, OP_POP}},
+  {OP_POP_LOOP, 2, {OP_POP, OP_LOOP}},
+};
+
+#define SUPERINSTRUCTION_COUNT \
+    (int)(sizeof(superinstructions) / sizeof(superinstructions[0]))
+
+static bool matches(Chunk* chunk, int offset, const Superinstruction* super) {
+  for (int i = 0; i < super->length; i++) {
+    if (offset >= chunk->count) return false;
+    if (chunk->code[offset] != super->sequence[i]) return false;
+    offset += instructionLength(chunk, offset);
+  }
+  return true;
+}
+
+// Rewrites only the first opcode of each matched sequence. The rest of
+// the bytes stay as they were, so the fused handler steps over them and
+// a jump that lands inside the sequence still finds valid instructions.
+// Jump offsets and line numbers are therefore untouched.
+void fuseSuperinstructions(Chunk* chunk) {
+  int offset = 0;
+  while (offset < chunk->count) {
+    int length = instructionLength(chunk, offset);
+    for (int i = 0; i < SUPERINSTRUCTION_COUNT; i++) {
+      if (matches(chunk, offset, &superinstructions[i])) {
+        chunk->code[offset] = superinstructions[i].fused;
+        length = instructionLength(chunk, offset);
+        break;
+      }
+    }
+    offset += length;
+  }
+}
+
+// The opcode a superinstruction replaced, for code that would rather walk
+// the original sequence one instruction at a time.
+uint8_t unfusedOpcode(uint8_t instruction) {
+  for (int i = 0; i < SUPERINSTRUCTION_COUNT; i++) {
+    if (superinstructions[i].fused == instruction) {
+      return superinstructions[i].sequence[0];
+    }
+  }
+  return instruction;
+}
+
+// The length of the instruction at `offset` on its own. A superinstruction
+// is read as the first instruction of its sequence, whose successors are
+// still in place after it.
+int unfusedLength(Chunk* chunk, int offset) {
+  uint8_t instruction = chunk->code[offset];
+  chunk->code[offset] = unfusedOpcode(instruction);
+  int length = instructionLength(chunk, offset);
+  chunk->code[offset] = instruction;
+  return length;
+}
+//< Superinstructions peephole-c
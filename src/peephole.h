@@ -0,0 +1,12 @@
+//> Superinstructions peephole-h
+#ifndef gem_peephole_h
+#define gem_peephole_h
+
+#include "chunk.h"
+
+void fuseSuperinstructions(Chunk* chunk);
+uint8_t unfusedOpcode(uint8_t instruction);
+int unfusedLength(Chunk* chunk, int offset);
+
+#endif
+//< Superinstructions peephole-h
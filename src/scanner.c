@@ -128,6 +128,7 @@ static TokenType identifierType() {
       if (scanner.current - scanner.start > 1) {
         switch (scanner.start[1]) {
           case 'n': return checkKeyword(2, 1, "d", TOKEN_AND);
+          case 'r': return checkKeyword(2, 3, "ray", TOKEN_RETURNTYPE_ARRAY);
           case 's': return checkKeyword(2, 0, "", TOKEN_AS);
         }
       }
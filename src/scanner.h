@@ -30,7 +30,7 @@ typedef enum {
   // Return type keywords.
   TOKEN_RETURNTYPE_INT, TOKEN_RETURNTYPE_STRING, TOKEN_RETURNTYPE_BOOL, 
   TOKEN_RETURNTYPE_VOID, TOKEN_RETURNTYPE_FUNC, TOKEN_RETURNTYPE_OBJ,
-  TOKEN_RETURNTYPE_HASH,
+  TOKEN_RETURNTYPE_HASH, TOKEN_RETURNTYPE_ARRAY,
 
   TOKEN_ERROR, TOKEN_EOF
 } TokenType;
@@ -0,0 +1,124 @@
+//> Stack Guards stack-c
+#include <stdlib.h>
+#include <string.h>
+
+#include "stack.h"
+
+#if STACK_GUARDS
+#include <signal.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#ifndef MAP_NORESERVE
+#define MAP_NORESERVE 0
+#endif
+
+#define MAX_GUARDS 8
+
+// The guard page of every live stack, for the fault handler to check.
+static char* guards[MAX_GUARDS];
+static int guardCount = 0;
+static size_t pageSize = 0;
+static sigjmp_buf* overflowTarget = NULL;
+// Whatever handled these signals before us, for faults that are not ours.
+static struct sigaction previousSegv;
+static struct sigaction previousBus;
+
+static size_t roundToPages(size_t bytes) {
+  return (bytes + pageSize - 1) & ~(pageSize - 1);
+}
+
+static bool isGuardPage(char* address) {
+  for (int i = 0; i < guardCount; i++) {
+    if (address >= guards[i] && address < guards[i] + pageSize) return true;
+  }
+  return false;
+}
+
+static void handleFault(int signum, siginfo_t* info, void* context) {
+  if (overflowTarget != NULL && isGuardPage((char*)info->si_addr)) {
+    siglongjmp(*overflowTarget, 1);
+  }
+
+  // Not a stack overflow, so hand it to the previous handler.
+  struct sigaction* previous = signum == SIGBUS ? &previousBus : &previousSegv;
+  if (previous->sa_flags & SA_SIGINFO) {
+    previous->sa_sigaction(signum, info, context);
+  } else if (previous->sa_handler != SIG_DFL &&
+             previous->sa_handler != SIG_IGN) {
+    previous->sa_handler(signum);
+  } else {
+    // With the old action back in place, the faulting instruction runs
+    // again and the process dies as it would have without us.
+    sigaction(signum, previous, NULL);
+  }
+}
+
+static void installFaultHandler() {
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  action.sa_sigaction = handleFault;
+  action.sa_flags = SA_SIGINFO;
+  sigemptyset(&action.sa_mask);
+  sigaction(SIGSEGV, &action, &previousSegv);
+  // Some systems report guard page faults as bus errors.
+  sigaction(SIGBUS, &action, &previousBus);
+}
+
+void* reserveStack(size_t bytes) {
+  if (pageSize == 0) {
+    pageSize = (size_t)sysconf(_SC_PAGESIZE);
+    installFaultHandler();
+  }
+  if (guardCount == MAX_GUARDS) return NULL;
+
+  // The kernel backs these pages only when they are first written, so an
+  // unused stack costs address space but no memory.
+  size_t usable = roundToPages(bytes);
+  char* base = mmap(NULL, usable + pageSize, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (base == MAP_FAILED) return NULL;
+
+  char* guard = base + usable;
+  if (mprotect(guard, pageSize, PROT_NONE) != 0) {
+    munmap(base, usable + pageSize);
+    return NULL;
+  }
+
+  guards[guardCount++] = guard;
+  // Line the end of the stack up with the guard page so the first slot
+  // past the end is the one that faults.
+  return guard - bytes;
+}
+
+void releaseStack(void* stack, size_t bytes) {
+  if (stack == NULL) return;
+
+  char* guard = (char*)stack + bytes;
+  for (int i = 0; i < guardCount; i++) {
+    if (guards[i] == guard) {
+      guards[i] = guards[--guardCount];
+      break;
+    }
+  }
+
+  size_t usable = roundToPages(bytes);
+  munmap(guard - usable, usable + pageSize);
+}
+
+sigjmp_buf* setStackOverflowTarget(sigjmp_buf* target) {
+  sigjmp_buf* previous = overflowTarget;
+  overflowTarget = target;
+  return previous;
+}
+#else
+void* reserveStack(size_t bytes) {
+  return malloc(bytes);
+}
+
+void releaseStack(void* stack, size_t bytes) {
+  (void)bytes;
+  free(stack);
+}
+#endif
+//< Stack Guards stack-c
@@ -0,0 +1,31 @@
+//> Stack Guards stack-h
+#ifndef gem_stack_h
+#define gem_stack_h
+
+#include <setjmp.h>
+
+#include "common.h"
+
+// The VM's value and frame stacks are address space reserved up front and
+// committed by the OS page by page as they are first touched. An
+// inaccessible guard page sits just past the end of each, so an overflow
+// faults instead of every push paying for a bounds check. Platforms
+// without mmap and signals get plain heap blocks and no overflow check.
+#if defined(_WIN32) || defined(__EMSCRIPTEN__)
+#define STACK_GUARDS 0
+#else
+#define STACK_GUARDS 1
+#endif
+
+// Returns `bytes` of stack whose end abuts a guard page, or NULL.
+void* reserveStack(size_t bytes);
+void releaseStack(void* stack, size_t bytes);
+
+#if STACK_GUARDS
+// While a target is set, a fault in any guard page jumps to it. Faults
+// anywhere else crash as usual. Returns the previous target.
+sigjmp_buf* setStackOverflowTarget(sigjmp_buf* target);
+#endif
+
+#endif
+//< Stack Guards stack-h
@@ -1,161 +1,367 @@
 //> Hash Tables table-c
 #include <stdlib.h>
 #include <string.h>
+//> Swiss Tables include-sse2
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+//< Swiss Tables include-sse2
 
 #include "memory.h"
 #include "object.h"
 #include "table.h"
 #include "value.h"
 
-//> max-load
+/* Hash Tables max-load < Swiss Tables control-bytes
 #define TABLE_MAX_LOAD 0.75
+*/
+//> Swiss Tables control-bytes
+// Control byte values. Full slots store a 7-bit hash tag, so they never
+// have the high bit set. Tables smaller than one group pad their control
+// array out to a whole group with CTRL_SENTINEL, which matches nothing.
+#define CTRL_EMPTY    ((uint8_t)0x80)
+#define CTRL_DELETED  ((uint8_t)0xFE)
+#define CTRL_SENTINEL ((uint8_t)0xFF)
+
+#define H1(hash) ((hash) >> 7)
+#define H2(hash) ((uint8_t)((hash) & 0x7F))
+
+//< Swiss Tables control-bytes
+//> Value Keys keys-equal
+// Strings are interned and -0 is folded into 0 before it is used as a key,
+// so two keys are the same exactly when their Values are identical.
+#ifdef NAN_BOXING
+#define KEYS_EQUAL(a, b) ((a) == (b))
+#else
+#define KEYS_EQUAL(a, b) valuesEqual(a, b)
+#endif
+
+//< Value Keys keys-equal
+//> Swiss Tables group-match
+// Each match returns a bitmask with bit i set when slot i of the group
+// qualifies.
+#if defined(__SSE2__)
+static inline uint32_t matchTag(const uint8_t* group, uint8_t tag) {
+  // Broadcasting through a 32-bit multiply is one shuffle cheaper than
+  // _mm_set1_epi8 without SSSE3.
+  __m128i tags = _mm_shuffle_epi32(_mm_cvtsi32_si128((int)(tag * 0x01010101u)), 0);
+  __m128i ctrl = _mm_loadu_si128((const __m128i*)group);
+  return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, tags));
+}
+
+static inline uint32_t matchEmpty(const uint8_t* group) {
+  return matchTag(group, CTRL_EMPTY);
+}
+
+// Empty or deleted: as signed bytes those are the only values below the
+// sentinel.
+static inline uint32_t matchFree(const uint8_t* group) {
+  __m128i ctrl = _mm_loadu_si128((const __m128i*)group);
+  return (uint32_t)_mm_movemask_epi8(
+      _mm_cmpgt_epi8(_mm_set1_epi8((char)CTRL_SENTINEL), ctrl));
+}
+#else
+static inline uint32_t matchTag(const uint8_t* group, uint8_t tag) {
+  uint32_t mask = 0;
+  for (int i = 0; i < TABLE_GROUP_SIZE; i++) {
+    if (group[i] == tag) mask |= 1u << i;
+  }
+  return mask;
+}
+
+static inline uint32_t matchEmpty(const uint8_t* group) {
+  return matchTag(group, CTRL_EMPTY);
+}
+
+static inline uint32_t matchFree(const uint8_t* group) {
+  uint32_t mask = 0;
+  for (int i = 0; i < TABLE_GROUP_SIZE; i++) {
+    if (group[i] == CTRL_EMPTY || group[i] == CTRL_DELETED) mask |= 1u << i;
+  }
+  return mask;
+}
+#endif
+
+#define NEXT_MATCH(mask) __builtin_ctz(mask)
+
+// Probing visits whole groups. Group g starts at slot g * 16; the group
+// sequence is triangular, which reaches every group of a power-of-two
+// table.
+static inline int lastGroup(int capacity) {
+  return (int)((uint32_t)(capacity - 1) / TABLE_GROUP_SIZE);
+}
+
+static inline int controlSize(int capacity) {
+  return capacity < TABLE_GROUP_SIZE ? TABLE_GROUP_SIZE : capacity;
+}
+
+// Single-group tables keep at least one empty slot so a probe always
+// terminates. Larger ones fill to 3/4.
+static inline int maxLoad(int capacity) {
+  return capacity < TABLE_GROUP_SIZE ? capacity - 1
+                                     : capacity - capacity / 4;
+}
 
-//< max-load
+// Entries and control bytes share one allocation; the entries come first
+// so they stay aligned.
+static inline size_t blockSize(int capacity) {
+  return sizeof(Entry) * (size_t)capacity + (size_t)controlSize(capacity);
+}
+//< Swiss Tables group-match
 void initTable(Table* table) {
   table->count = 0;
   table->capacity = 0;
+//> Swiss Tables init-table
+  table->growthLeft = 0;
+  table->control = NULL;
+//< Swiss Tables init-table
   table->entries = NULL;
 }
 //> free-table
 void freeTable(Table* table) {
+/* Hash Tables free-table < Swiss Tables free-table
   FREE_ARRAY(Entry, table->entries, table->capacity);
+*/
+//> Swiss Tables free-table
+  if (table->entries != NULL) {
+    FREE_ARRAY(char, (char*)table->entries, blockSize(table->capacity));
+  }
+//< Swiss Tables free-table
   initTable(table);
 }
 //< free-table
-//> find-entry
-//> omit
-// NOTE: The "Optimization" chapter has a manual copy of this function.
-// If you change it here, make sure to update that copy.
-//< omit
-static Entry* findEntry(Entry* entries, int capacity,
-                        ObjString* key) {
-/* Hash Tables find-entry < Optimization initial-index
-  uint32_t index = key->hash % capacity;
-*/
-//> Optimization initial-index
-  uint32_t index = key->hash & (capacity - 1);
-//< Optimization initial-index
-//> find-entry-tombstone
-  Entry* tombstone = NULL;
-  
-//< find-entry-tombstone
-  for (;;) {
-    Entry* entry = &entries[index];
-/* Hash Tables find-entry < Hash Tables find-tombstone
-    if (entry->key == key || entry->key == NULL) {
-      return entry;
+//> Value Keys hash-value
+// Strings hash by content so the intern table can probe for a string
+// before it exists. Every other key hashes its bits, so numbers hash by
+// value and objects by identity.
+uint32_t hashValue(Value key) {
+  if (IS_STRING(key)) return AS_STRING(key)->hash;
+
+#ifdef NAN_BOXING
+  uint64_t bits = key;
+#else
+  uint64_t bits = 0;
+  switch (key.type) {
+    case VAL_BOOL:   bits = AS_BOOL(key); break;
+    case VAL_NIL:    bits = 0; break;
+    case VAL_NUMBER: {
+      double number = AS_NUMBER(key);
+      memcpy(&bits, &number, sizeof(bits));
+      break;
     }
-*/
-//> find-tombstone
-    if (entry->key == NULL) {
-      if (IS_NIL(entry->value)) {
-        // Empty entry.
-        return tombstone != NULL ? tombstone : entry;
-      } else {
-        // We found a tombstone.
-        if (tombstone == NULL) tombstone = entry;
-      }
-    } else if (entry->key == key) {
-      // We found the key.
-      return entry;
+    case VAL_OBJ:    bits = (uint64_t)(uintptr_t)AS_OBJ(key); break;
+  }
+#endif
+
+  // MurmurHash3's 64-bit finalizer. Doubles and pointers keep their
+  // entropy in the high and middle bits, which a power-of-two mask alone
+  // would throw away.
+  bits ^= bits >> 33;
+  bits *= 0xff51afd7ed558ccdULL;
+  bits ^= bits >> 33;
+  bits *= 0xc4ceb93fe53a6ce5ULL;
+  bits ^= bits >> 33;
+  return (uint32_t)bits;
+}
+
+// 0 and -0 compare equal but have different bits.
+static inline Value normalizeKey(Value key) {
+  if (IS_NUMBER(key) && AS_NUMBER(key) == 0) return NUMBER_VAL(0);
+  return key;
+}
+//< Value Keys hash-value
+//> find-entry
+//> Swiss Tables find-entry
+// Continues a lookup whose first group was full and held no match. Kept
+// out of line so the common single-group case stays small enough to
+// inline into the interpreter loop.
+static int __attribute__((noinline)) findSlotFrom(Table* table, Value key,
+                                                  uint32_t hash, int group) {
+  int groupMask = lastGroup(table->capacity);
+  uint8_t tag = H2(hash);
+
+  for (int step = 1;; step++) {
+    group = (group + step) & groupMask;
+    const uint8_t* ctrl = table->control + group * TABLE_GROUP_SIZE;
+    for (uint32_t match = matchTag(ctrl, tag); match != 0;
+         match &= match - 1) {
+      int slot = group * TABLE_GROUP_SIZE + NEXT_MATCH(match);
+      if (KEYS_EQUAL(table->entries[slot].key, key)) return slot;
     }
-//< find-tombstone
 
-/* Hash Tables find-entry < Optimization next-index
-    index = (index + 1) % capacity;
-*/
-//> Optimization next-index
-    index = (index + 1) & (capacity - 1);
-//< Optimization next-index
+    // A key is never stored past a group that still has an empty slot.
+    if (matchEmpty(ctrl) != 0) return -1;
+  }
+}
+
+// Returns the slot holding `key`, or -1.
+static inline int findSlot(Table* table, Value key, uint32_t hash) {
+  int group = (int)H1(hash) & lastGroup(table->capacity);
+  const uint8_t* ctrl = table->control + group * TABLE_GROUP_SIZE;
+  for (uint32_t match = matchTag(ctrl, H2(hash)); match != 0;
+       match &= match - 1) {
+    int slot = group * TABLE_GROUP_SIZE + NEXT_MATCH(match);
+    if (KEYS_EQUAL(table->entries[slot].key, key)) return slot;
+  }
+
+  if (matchEmpty(ctrl) != 0) return -1;
+  return findSlotFrom(table, key, hash, group);
+}
+
+// Returns the first empty or deleted slot on `hash`'s probe sequence.
+static inline int findFreeSlot(uint8_t* control, int capacity,
+                               uint32_t hash) {
+  int groupMask = lastGroup(capacity);
+  int group = (int)H1(hash) & groupMask;
+
+  for (int step = 1;; step++) {
+    uint32_t available = matchFree(control + group * TABLE_GROUP_SIZE);
+    if (available != 0) return group * TABLE_GROUP_SIZE + NEXT_MATCH(available);
+    group = (group + step) & groupMask;
   }
 }
+//< Swiss Tables find-entry
 //< find-entry
 //> table-get
-bool tableGet(Table* table, ObjString* key, Value* value) {
+static inline bool getEntry(Table* table, Value key, uint32_t hash,
+                            Value* value) {
   if (table->count == 0) return false;
 
-  Entry* entry = findEntry(table->entries, table->capacity, key);
-  if (entry->key == NULL) return false;
+  int slot = findSlot(table, key, hash);
+  if (slot < 0) return false;
 
-  *value = entry->value;
+  *value = table->entries[slot].value;
   return true;
 }
+
+bool tableGet(Table* table, ObjString* key, Value* value) {
+  return getEntry(table, OBJ_VAL(key), key->hash, value);
+}
+
+bool tableGetValue(Table* table, Value key, Value* value) {
+  key = normalizeKey(key);
+  return getEntry(table, key, hashValue(key), value);
+}
 //< table-get
 //> table-adjust-capacity
 static void adjustCapacity(Table* table, int capacity) {
-  Entry* entries = ALLOCATE(Entry, capacity);
+//> Swiss Tables adjust-capacity
+  char* block = ALLOCATE(char, blockSize(capacity));
+  Entry* entries = (Entry*)block;
+  uint8_t* control = (uint8_t*)(block + sizeof(Entry) * (size_t)capacity);
   for (int i = 0; i < capacity; i++) {
-    entries[i].key = NULL;
+    entries[i].key = NIL_VAL;
     entries[i].value = NIL_VAL;
   }
-//> re-hash
+  memset(control, CTRL_EMPTY, (size_t)capacity);
+  memset(control + capacity, CTRL_SENTINEL,
+         (size_t)(controlSize(capacity) - capacity));
 
-//> resize-init-count
-  table->count = 0;
-//< resize-init-count
+  // Rehashing drops every tombstone.
   for (int i = 0; i < table->capacity; i++) {
     Entry* entry = &table->entries[i];
-    if (entry->key == NULL) continue;
+    if (IS_NIL(entry->key)) continue;
 
-    Entry* dest = findEntry(entries, capacity, entry->key);
-    dest->key = entry->key;
-    dest->value = entry->value;
-//> resize-increment-count
-    table->count++;
-//< resize-increment-count
+    uint32_t hash = hashValue(entry->key);
+    int slot = findFreeSlot(control, capacity, hash);
+    control[slot] = H2(hash);
+    entries[slot] = *entry;
   }
-//< re-hash
 
-//> Hash Tables free-old-array
-  FREE_ARRAY(Entry, table->entries, table->capacity);
-//< Hash Tables free-old-array
+  if (table->entries != NULL) {
+    FREE_ARRAY(char, (char*)table->entries, blockSize(table->capacity));
+  }
   table->entries = entries;
+  table->control = control;
   table->capacity = capacity;
+  table->growthLeft = maxLoad(capacity) - table->count;
+//< Swiss Tables adjust-capacity
 }
 //< table-adjust-capacity
 //> table-set
-bool tableSet(Table* table, ObjString* key, Value value) {
-//> table-set-grow
-  if (table->count + 1 > table->capacity * TABLE_MAX_LOAD) {
-    int capacity = GROW_CAPACITY(table->capacity);
+static bool setEntry(Table* table, Value key, uint32_t hash, Value value) {
+//> Swiss Tables table-set
+  if (table->count > 0) {
+    int slot = findSlot(table, key, hash);
+    if (slot >= 0) {
+      table->entries[slot].value = value;
+      return false;
+    }
+  }
+
+  if (table->capacity == 0) adjustCapacity(table, GROW_CAPACITY(0));
+  int slot = findFreeSlot(table->control, table->capacity, hash);
+
+  // Reusing a deleted slot doesn't use up growth; claiming an empty one
+  // does, and when none is left the table is rehashed. Mostly tombstones
+  // rehash at the same size.
+  if (table->control[slot] == CTRL_EMPTY && table->growthLeft == 0) {
+    int capacity = table->capacity;
+    if ((table->count + 1) * 2 > maxLoad(capacity)) {
+      capacity = GROW_CAPACITY(capacity);
+    }
     adjustCapacity(table, capacity);
+    slot = findFreeSlot(table->control, table->capacity, hash);
   }
 
-//< table-set-grow
-  Entry* entry = findEntry(table->entries, table->capacity, key);
-  bool isNewKey = entry->key == NULL;
-/* Hash Tables table-set < Hash Tables set-increment-count
-  if (isNewKey) table->count++;
-*/
-//> set-increment-count
-  if (isNewKey && IS_NIL(entry->value)) table->count++;
-//< set-increment-count
+  if (table->control[slot] == CTRL_EMPTY) table->growthLeft--;
+  table->control[slot] = H2(hash);
+  table->entries[slot].key = key;
+  table->entries[slot].value = value;
+  table->count++;
+  return true;
+//< Swiss Tables table-set
+}
+
+bool tableSet(Table* table, ObjString* key, Value value) {
+  return setEntry(table, OBJ_VAL(key), key->hash, value);
+}
 
-  entry->key = key;
-  entry->value = value;
-  return isNewKey;
+bool tableSetValue(Table* table, Value key, Value value) {
+  key = normalizeKey(key);
+  return setEntry(table, key, hashValue(key), value);
 }
 //< table-set
 //> table-delete
-bool tableDelete(Table* table, ObjString* key) {
+static bool deleteEntry(Table* table, Value key, uint32_t hash) {
   if (table->count == 0) return false;
 
-  // Find the entry.
-  Entry* entry = findEntry(table->entries, table->capacity, key);
-  if (entry->key == NULL) return false;
+  int slot = findSlot(table, key, hash);
+  if (slot < 0) return false;
 
-  // Place a tombstone in the entry.
-  entry->key = NULL;
-  entry->value = BOOL_VAL(true);
+//> Swiss Tables table-delete
+  // A probe only continues past a group with no empty slot. If this
+  // group already has one, no probe can depend on this slot being full,
+  // so it can go straight back to empty instead of becoming a tombstone.
+  int groupStart = slot & ~(TABLE_GROUP_SIZE - 1);
+  if (matchEmpty(table->control + groupStart) != 0) {
+    table->control[slot] = CTRL_EMPTY;
+    table->growthLeft++;
+  } else {
+    table->control[slot] = CTRL_DELETED;
+  }
+  table->entries[slot].key = NIL_VAL;
+  table->entries[slot].value = NIL_VAL;
+  table->count--;
+//< Swiss Tables table-delete
   return true;
 }
+
+bool tableDelete(Table* table, ObjString* key) {
+  return deleteEntry(table, OBJ_VAL(key), key->hash);
+}
+
+bool tableDeleteValue(Table* table, Value key) {
+  key = normalizeKey(key);
+  return deleteEntry(table, key, hashValue(key));
+}
 //< table-delete
 //> table-add-all
 void tableAddAll(Table* from, Table* to) {
   for (int i = 0; i < from->capacity; i++) {
     Entry* entry = &from->entries[i];
-    if (entry->key != NULL) {
-      tableSet(to, entry->key, entry->value);
+    if (!IS_NIL(entry->key)) {
+      tableSetValue(to, entry->key, entry->value);
     }
   }
 }
@@ -165,30 +371,47 @@ ObjString* tableFindString(Table* table, const char* chars,
                            int length, uint32_t hash) {
   if (table->count == 0) return NULL;
 
-/* Hash Tables table-find-string < Optimization find-string-index
-  uint32_t index = hash % table->capacity;
-*/
-//> Optimization find-string-index
-  uint32_t index = hash & (table->capacity - 1);
-//< Optimization find-string-index
-  for (;;) {
-    Entry* entry = &table->entries[index];
-    if (entry->key == NULL) {
-      // Stop if we find an empty non-tombstone entry.
-      if (IS_NIL(entry->value)) return NULL;
-    } else if (entry->key->length == length &&
-        entry->key->hash == hash &&
-        memcmp(AS_CSTRING(OBJ_VAL(entry->key)), chars, length) == 0) {
-      // We found it.
-      return entry->key;
+//> Swiss Tables find-string
+  int groupMask = lastGroup(table->capacity);
+  int group = (int)H1(hash) & groupMask;
+  uint8_t tag = H2(hash);
+
+  for (int step = 1;; step++) {
+    const uint8_t* ctrl = table->control + group * TABLE_GROUP_SIZE;
+    for (uint32_t match = matchTag(ctrl, tag); match != 0;
+         match &= match - 1) {
+      ObjString* key = AS_STRING(
+          table->entries[group * TABLE_GROUP_SIZE + NEXT_MATCH(match)].key);
+      if (key->length == length && key->hash == hash &&
+          memcmp(key->chars, chars, length) == 0) {
+        // We found it.
+        return key;
+      }
     }
 
-/* Hash Tables table-find-string < Optimization find-string-next
-    index = (index + 1) % table->capacity;
-*/
-//> Optimization find-string-next
-    index = (index + 1) & (table->capacity - 1);
-//< Optimization find-string-next
+    // Stop once a group has an empty slot.
+    if (matchEmpty(ctrl) != 0) return NULL;
+    group = (group + step) & groupMask;
   }
+//< Swiss Tables find-string
 }
 //< table-find-string
+//> Garbage Collection table-remove-white
+void tableRemoveWhite(Table* table) {
+  for (int i = 0; i < table->capacity; i++) {
+    Entry* entry = &table->entries[i];
+    if (IS_OBJ(entry->key) && !AS_OBJ(entry->key)->isMarked) {
+      tableDeleteValue(table, entry->key);
+    }
+  }
+}
+//< Garbage Collection table-remove-white
+//> Garbage Collection mark-table
+void markTable(Table* table) {
+  for (int i = 0; i < table->capacity; i++) {
+    Entry* entry = &table->entries[i];
+    markValue(entry->key);
+    markValue(entry->value);
+  }
+}
+//< Garbage Collection mark-table
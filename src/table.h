@@ -6,17 +6,45 @@
 #include "value.h"
 //> entry
 
+/* Hash Tables entry < Value Keys entry
 typedef struct {
   ObjString* key;
   Value value;
 } Entry;
+*/
+//> Value Keys entry
+// Any non-nil Value can be a key. Free slots always hold a nil key, so
+// code that walks `entries` directly can skip them without reading the
+// control bytes.
+typedef struct {
+  Value key;
+  Value value;
+} Entry;
+//< Value Keys entry
 //< entry
 
+/* Hash Tables table-struct < Swiss Tables table-struct
 typedef struct {
   int count;
   int capacity;
   Entry* entries;
 } Table;
+*/
+//> Swiss Tables table-struct
+// Slots are grouped TABLE_GROUP_SIZE at a time. Each slot has a control
+// byte that is either CTRL_EMPTY, CTRL_DELETED or, for a full slot, the
+// low seven bits of its key's hash, so a whole group can be filtered for
+// a key with one SIMD compare before any entry is touched.
+#define TABLE_GROUP_SIZE 16
+
+typedef struct {
+  int count;       // Live entries
+  int capacity;    // Slot count, a power of two
+  int growthLeft;  // Empty slots that may still be filled before a rehash
+  uint8_t* control;
+  Entry* entries;
+} Table;
+//< Swiss Tables table-struct
 
 //> init-table-h
 void initTable(Table* table);
@@ -32,6 +60,12 @@ bool tableSet(Table* table, ObjString* key, Value value);
 //> table-delete-h
 bool tableDelete(Table* table, ObjString* key);
 //< table-delete-h
+//> Value Keys table-value-h
+uint32_t hashValue(Value key);
+bool tableGetValue(Table* table, Value key, Value* value);
+bool tableSetValue(Table* table, Value key, Value value);
+bool tableDeleteValue(Table* table, Value key);
+//< Value Keys table-value-h
 //> table-add-all-h
 void tableAddAll(Table* from, Table* to);
 //< table-add-all-h
@@ -39,6 +73,13 @@ void tableAddAll(Table* from, Table* to);
 ObjString* tableFindString(Table* table, const char* chars,
                            int length, uint32_t hash);
 //< table-find-string-h
+//> Garbage Collection table-remove-white-h
+
+void tableRemoveWhite(Table* table);
+//< Garbage Collection table-remove-white-h
+//> Garbage Collection mark-table-h
+void markTable(Table* table);
+//< Garbage Collection mark-table-h
 
 //< init-table-h
 #endif
@@ -69,6 +69,12 @@ typedef uint64_t Value;
 //> nil-val
 #define NIL_VAL         ((Value)(uint64_t)(QNAN | TAG_NIL))
 //< nil-val
+//> Global Slots undefined-val
+// Marks a global slot whose variable has not been defined yet. Programs
+// can never produce it.
+#define UNDEFINED_VAL   ((Value)(uint64_t)(QNAN | 4))
+#define IS_UNDEFINED(value) ((value) == UNDEFINED_VAL)
+//< Global Slots undefined-val
 #define NUMBER_VAL(num) numToValue(num)
 //< number-val
 //> obj-val
@@ -142,6 +148,11 @@ typedef struct {
 
 #define BOOL_VAL(value)   ((Value){VAL_BOOL, {.boolean = value}})
 #define NIL_VAL           ((Value){VAL_NIL, {.number = 0}})
+//> Global Slots undefined-val-struct
+#define UNDEFINED_VAL     ((Value){VAL_NIL, {.number = 1}})
+#define IS_UNDEFINED(value) \
+    ((value).type == VAL_NIL && (value).as.number == 1)
+//< Global Slots undefined-val-struct
 #define NUMBER_VAL(value) ((Value){VAL_NUMBER, {.number = value}})
 //> Strings obj-val
 #define OBJ_VAL(object)   ((Value){VAL_OBJ, {.obj = (Obj*)object}})
@@ -32,6 +32,9 @@
 #include "memory.h"
 //< Strings vm-include-object-memory
 #include "vm.h"
+//> Stack Guards vm-include-stack
+#include "stack.h"
+//< Stack Guards vm-include-stack
 //> JIT Integration include
 #include "jit.h"
 //< JIT Integration include
@@ -84,6 +87,44 @@ static void resetStack() {
 //< Closures init-open-upvalues
 }
 //< reset-stack
+//> Stack Guards max-frames
+static int maxFramesSetting = FRAMES_MAX;
+
+// Takes effect at the next initVM().
+void setMaxFrames(int frames) {
+  maxFramesSetting = frames;
+}
+//< Stack Guards max-frames
+//> Stack Guards trace-edge-frames
+// How many frames at each end of a long stack trace are printed.
+#define TRACE_EDGE_FRAMES 10
+//< Stack Guards trace-edge-frames
+//> Inlining trace-inlined
+// Prints a trace line for each inlined call the instruction is in,
+// innermost first, and returns the line of the outermost call.
+static int traceInlined(Chunk* chunk, int instruction) {
+  int line = getLine(chunk, instruction);
+  int innerSize = 0;
+  for (;;) {
+    // Inlined ranges nest, so the next one out is the smallest larger one.
+    InlinedRange* next = NULL;
+    for (int i = 0; i < chunk->inlinedRangeCount; i++) {
+      InlinedRange* range = &chunk->inlinedRanges[i];
+      int size = range->end - range->start;
+      if (instruction >= range->start && instruction < range->end &&
+          size > innerSize &&
+          (next == NULL || size < next->end - next->start)) {
+        next = range;
+      }
+    }
+    if (next == NULL) return line;
+
+    fprintf(stderr, "[line %d] in %s()\n", line, next->name->chars);
+    line = getLine(chunk, next->start - 1);
+    innerSize = next->end - next->start;
+  }
+}
+//< Inlining trace-inlined
 //> Types of Values runtime-error
 static void runtimeError(const char* format, ...) {
   va_list args;
@@ -106,6 +147,17 @@ static void runtimeError(const char* format, ...) {
 */
 //> Calls and Functions runtime-error-stack
   for (int i = vm.frameCount - 1; i >= 0; i--) {
+//> Stack Guards trace-omit
+    // Deep recursion would print thousands of identical lines, so only
+    // the innermost and outermost frames are shown.
+    if (i == vm.frameCount - 1 - TRACE_EDGE_FRAMES &&
+        vm.frameCount > 2 * TRACE_EDGE_FRAMES + 1) {
+      int omitted = vm.frameCount - 2 * TRACE_EDGE_FRAMES;
+      fprintf(stderr, "... %d frames omitted\n", omitted);
+      i -= omitted - 1;
+      continue;
+    }
+//< Stack Guards trace-omit
     CallFrame* frame = &vm.frames[i];
 /* Calls and Functions runtime-error-stack < Closures runtime-error-function
     ObjFunction* function = frame->function;
@@ -114,8 +166,14 @@ static void runtimeError(const char* format, ...) {
     ObjFunction* function = frame->closure->function;
 //< Closures runtime-error-function
     size_t instruction = frame->ip - function->chunk.code - 1;
+/* Calls and Functions runtime-error-stack < Inlining runtime-error-inlined
     fprintf(stderr, "[line %d] in ", // [minus]
             getLine(&function->chunk, instruction));
+*/
+//> Inlining runtime-error-inlined
+    fprintf(stderr, "[line %d] in ", // [minus]
+            traceInlined(&function->chunk, (int)instruction));
+//< Inlining runtime-error-inlined
     if (function->name == NULL) {
       fprintf(stderr, "script\n");
     } else {
@@ -127,15 +185,57 @@ static void runtimeError(const char* format, ...) {
   resetStack();
 }
 //< Types of Values runtime-error
+//> Stack Guards stack-overflow
+// Reached from a fault in a guard page. A call faults after bumping
+// frameCount, so trim that back to the frames that really exist.
+static void stackOverflow() {
+  if (vm.frameCount > vm.maxFrames) vm.frameCount = vm.maxFrames;
+  runtimeError("Stack overflow.");
+}
+//< Stack Guards stack-overflow
 //> Calls and Functions define-native
 static void defineNative(const char* name, NativeFn function) {
   push(OBJ_VAL(copyString(name, (int)strlen(name))));
   push(OBJ_VAL(newNative(function)));
+/* Calls and Functions define-native < Global Slots define-native-slot
   tableSet(&vm.globals, AS_STRING(peek(1)), peek(0));
+*/
+//> Global Slots define-native-slot
+  int slot = globalSlot(AS_STRING(peek(1)));
+  vm.globalValues.values[slot] = peek(0);
+//< Global Slots define-native-slot
   pop();
   pop();
 }
 //< Calls and Functions define-native
+//> Global Slots global-slot
+// Returns the index of [name]'s slot in vm.globalValues, adding an
+// undefined slot the first time the name is seen. The compiler calls this
+// so global accesses can index the array directly.
+int globalSlot(ObjString* name) {
+  Value index;
+  if (tableGet(&vm.globalNames, name, &index)) return (int)AS_NUMBER(index);
+
+  push(OBJ_VAL(name));
+  writeValueArray(&vm.globalValues, UNDEFINED_VAL);
+  int slot = vm.globalValues.count - 1;
+  tableSet(&vm.globalNames, name, NUMBER_VAL(slot));
+  pop();
+  return slot;
+}
+
+// Maps a slot back to its name. Only runtime errors need this, so a scan
+// of the name table is fine.
+static const char* globalSlotName(int slot) {
+  for (int i = 0; i < vm.globalNames.capacity; i++) {
+    Entry* entry = &vm.globalNames.entries[i];
+    if (IS_STRING(entry->key) && AS_NUMBER(entry->value) == slot) {
+      return AS_CSTRING(entry->key);
+    }
+  }
+  return "?";
+}
+//< Global Slots global-slot
 
 //> HTTP Native Functions
 
@@ -197,8 +297,8 @@ static char* buildCurlHeaders(ObjHash* headers) {
   size_t totalSize = 0;
   for (int i = 0; i < headers->table.capacity; i++) {
     Entry* entry = &headers->table.entries[i];
-    if (entry->key != NULL) {
-      const char* key = AS_CSTRING(OBJ_VAL(entry->key));
+    if (IS_STRING(entry->key)) {
+      const char* key = AS_CSTRING(entry->key);
       const char* value = AS_CSTRING(entry->value);
       totalSize += strlen(key) + strlen(value) + 20; // " -H \"key: value\""
     }
@@ -210,8 +310,8 @@ static char* buildCurlHeaders(ObjHash* headers) {
   headerString[0] = '\0';
   for (int i = 0; i < headers->table.capacity; i++) {
     Entry* entry = &headers->table.entries[i];
-    if (entry->key != NULL) {
-      const char* key = AS_CSTRING(OBJ_VAL(entry->key));
+    if (IS_STRING(entry->key)) {
+      const char* key = AS_CSTRING(entry->key);
       const char* value = AS_CSTRING(entry->value);
       
       char* escapedKey = escapeShellArg(key);
@@ -240,8 +340,8 @@ static char* buildQueryParams(ObjHash* params) {
   size_t totalSize = 1; // For '?'
   for (int i = 0; i < params->table.capacity; i++) {
     Entry* entry = &params->table.entries[i];
-    if (entry->key != NULL) {
-      const char* key = AS_CSTRING(OBJ_VAL(entry->key));
+    if (IS_STRING(entry->key)) {
+      const char* key = AS_CSTRING(entry->key);
       const char* value = AS_CSTRING(entry->value);
       totalSize += strlen(key) + strlen(value) + 2; // key=value&
     }
@@ -255,8 +355,8 @@ static char* buildQueryParams(ObjHash* params) {
   
   for (int i = 0; i < params->table.capacity; i++) {
     Entry* entry = &params->table.entries[i];
-    if (entry->key != NULL) {
-      const char* key = AS_CSTRING(OBJ_VAL(entry->key));
+    if (IS_STRING(entry->key)) {
+      const char* key = AS_CSTRING(entry->key);
       const char* value = AS_CSTRING(entry->value);
       
       if (!first) {
@@ -452,6 +552,18 @@ static HttpResponse* executeHttpRequest(HttpRequest* req) {
 }
 
 // Free HTTP response
+// Stores a field on a response hash. The value is kept on the stack while
+// the key string is allocated.
+static void setResponseField(ObjHash* hash, const char* key, Value value) {
+  push(value);
+  push(OBJ_VAL(copyString(key, (int)strlen(key))));
+  tableSet(&hash->table, AS_STRING(peek(0)), peek(1));
+  writeBarrier((Obj*)hash, peek(0));
+  writeBarrier((Obj*)hash, peek(1));
+  pop();
+  pop();
+}
+
 static void freeHttpResponse(HttpResponse* response) {
   if (response) {
     free(response->body);
@@ -901,28 +1013,27 @@ static Value httpRequestNative(int argCount, Value* args) {
     return NIL_VAL;
   }
   
-  // Return detailed response as hash
+  // Return detailed response as hash. The hash stays on the stack while
+  // its fields are allocated so a collection cannot reclaim it.
   ObjHash* responseHash = newHash();
+  push(OBJ_VAL(responseHash));
   
   // Add response body
-  ObjString* bodyKey = copyString("body", 4);
-  ObjString* bodyValue = copyString(response->body ? response->body : "", 
-                                   response->body ? strlen(response->body) : 0);
-  tableSet(&responseHash->table, bodyKey, OBJ_VAL(bodyValue));
+  setResponseField(responseHash, "body",
+                   OBJ_VAL(copyString(response->body ? response->body : "", 
+                                      response->body ? strlen(response->body) : 0)));
   
   // Add status code
-  ObjString* statusKey = copyString("status", 6);
-  tableSet(&responseHash->table, statusKey, NUMBER_VAL(response->statusCode));
+  setResponseField(responseHash, "status", NUMBER_VAL(response->statusCode));
   
   // Add success flag
-  ObjString* successKey = copyString("success", 7);
-  tableSet(&responseHash->table, successKey, BOOL_VAL(response->success));
+  setResponseField(responseHash, "success", BOOL_VAL(response->success));
   
   // Add response time
-  ObjString* timeKey = copyString("response_time", 13);
-  tableSet(&responseHash->table, timeKey, NUMBER_VAL(response->responseTime));
+  setResponseField(responseHash, "response_time", NUMBER_VAL(response->responseTime));
   
   freeHttpResponse(response);
+  pop();
   
   return OBJ_VAL(responseHash);
 }
@@ -970,28 +1081,27 @@ static Value httpGetWithOptionsNative(int argCount, Value* args) {
     return NIL_VAL;
   }
   
-  // Return structured response as hash
+  // Return structured response as hash, kept on the stack while its
+  // fields are allocated
   ObjHash* responseHash = newHash();
+  push(OBJ_VAL(responseHash));
   
   // Add response body
-  ObjString* bodyKey = copyString("body", 4);
-  ObjString* bodyValue = copyString(response->body ? response->body : "", 
-                                   response->body ? strlen(response->body) : 0);
-  tableSet(&responseHash->table, bodyKey, OBJ_VAL(bodyValue));
+  setResponseField(responseHash, "body",
+                   OBJ_VAL(copyString(response->body ? response->body : "", 
+                                      response->body ? strlen(response->body) : 0)));
   
   // Add status code
-  ObjString* statusKey = copyString("status", 6);
-  tableSet(&responseHash->table, statusKey, NUMBER_VAL(response->statusCode));
+  setResponseField(responseHash, "status", NUMBER_VAL(response->statusCode));
   
   // Add success flag
-  ObjString* successKey = copyString("success", 7);
-  tableSet(&responseHash->table, successKey, BOOL_VAL(response->success));
+  setResponseField(responseHash, "success", BOOL_VAL(response->success));
   
   // Add response time
-  ObjString* timeKey = copyString("response_time", 13);
-  tableSet(&responseHash->table, timeKey, NUMBER_VAL(response->responseTime));
+  setResponseField(responseHash, "response_time", NUMBER_VAL(response->responseTime));
   
   freeHttpResponse(response);
+  pop();
   
   return OBJ_VAL(responseHash);
 }
@@ -1043,28 +1153,27 @@ static Value httpPostWithOptionsNative(int argCount, Value* args) {
     return NIL_VAL;
   }
   
-  // Return structured response as hash
+  // Return structured response as hash, kept on the stack while its
+  // fields are allocated
   ObjHash* responseHash = newHash();
+  push(OBJ_VAL(responseHash));
   
   // Add response body
-  ObjString* bodyKey = copyString("body", 4);
-  ObjString* bodyValue = copyString(response->body ? response->body : "", 
-                                   response->body ? strlen(response->body) : 0);
-  tableSet(&responseHash->table, bodyKey, OBJ_VAL(bodyValue));
+  setResponseField(responseHash, "body",
+                   OBJ_VAL(copyString(response->body ? response->body : "", 
+                                      response->body ? strlen(response->body) : 0)));
   
   // Add status code
-  ObjString* statusKey = copyString("status", 6);
-  tableSet(&responseHash->table, statusKey, NUMBER_VAL(response->statusCode));
+  setResponseField(responseHash, "status", NUMBER_VAL(response->statusCode));
   
   // Add success flag
-  ObjString* successKey = copyString("success", 7);
-  tableSet(&responseHash->table, successKey, BOOL_VAL(response->success));
+  setResponseField(responseHash, "success", BOOL_VAL(response->success));
   
   // Add response time
-  ObjString* timeKey = copyString("response_time", 13);
-  tableSet(&responseHash->table, timeKey, NUMBER_VAL(response->responseTime));
+  setResponseField(responseHash, "response_time", NUMBER_VAL(response->responseTime));
   
   freeHttpResponse(response);
+  pop();
   
   return OBJ_VAL(responseHash);
 }
@@ -1116,28 +1225,27 @@ static Value httpPutWithOptionsNative(int argCount, Value* args) {
     return NIL_VAL;
   }
   
-  // Return structured response as hash
+  // Return structured response as hash, kept on the stack while its
+  // fields are allocated
   ObjHash* responseHash = newHash();
+  push(OBJ_VAL(responseHash));
   
   // Add response body
-  ObjString* bodyKey = copyString("body", 4);
-  ObjString* bodyValue = copyString(response->body ? response->body : "", 
-                                   response->body ? strlen(response->body) : 0);
-  tableSet(&responseHash->table, bodyKey, OBJ_VAL(bodyValue));
+  setResponseField(responseHash, "body",
+                   OBJ_VAL(copyString(response->body ? response->body : "", 
+                                      response->body ? strlen(response->body) : 0)));
   
   // Add status code
-  ObjString* statusKey = copyString("status", 6);
-  tableSet(&responseHash->table, statusKey, NUMBER_VAL(response->statusCode));
+  setResponseField(responseHash, "status", NUMBER_VAL(response->statusCode));
   
   // Add success flag
-  ObjString* successKey = copyString("success", 7);
-  tableSet(&responseHash->table, successKey, BOOL_VAL(response->success));
+  setResponseField(responseHash, "success", BOOL_VAL(response->success));
   
   // Add response time
-  ObjString* timeKey = copyString("response_time", 13);
-  tableSet(&responseHash->table, timeKey, NUMBER_VAL(response->responseTime));
+  setResponseField(responseHash, "response_time", NUMBER_VAL(response->responseTime));
   
   freeHttpResponse(response);
+  pop();
   
   return OBJ_VAL(responseHash);
 }
@@ -1183,28 +1291,27 @@ static Value httpDeleteWithOptionsNative(int argCount, Value* args) {
     return NIL_VAL;
   }
   
-  // Return structured response as hash
+  // Return structured response as hash, kept on the stack while its
+  // fields are allocated
   ObjHash* responseHash = newHash();
+  push(OBJ_VAL(responseHash));
   
   // Add response body
-  ObjString* bodyKey = copyString("body", 4);
-  ObjString* bodyValue = copyString(response->body ? response->body : "", 
-                                   response->body ? strlen(response->body) : 0);
-  tableSet(&responseHash->table, bodyKey, OBJ_VAL(bodyValue));
+  setResponseField(responseHash, "body",
+                   OBJ_VAL(copyString(response->body ? response->body : "", 
+                                      response->body ? strlen(response->body) : 0)));
   
   // Add status code
-  ObjString* statusKey = copyString("status", 6);
-  tableSet(&responseHash->table, statusKey, NUMBER_VAL(response->statusCode));
+  setResponseField(responseHash, "status", NUMBER_VAL(response->statusCode));
   
   // Add success flag
-  ObjString* successKey = copyString("success", 7);
-  tableSet(&responseHash->table, successKey, BOOL_VAL(response->success));
+  setResponseField(responseHash, "success", BOOL_VAL(response->success));
   
   // Add response time
-  ObjString* timeKey = copyString("response_time", 13);
-  tableSet(&responseHash->table, timeKey, NUMBER_VAL(response->responseTime));
+  setResponseField(responseHash, "response_time", NUMBER_VAL(response->responseTime));
   
   freeHttpResponse(response);
+  pop();
   
   return OBJ_VAL(responseHash);
 }
@@ -1263,8 +1370,22 @@ static Value sleepNative(int argCount, Value* args) {
 //< TIME Native Functions
 
 void initVM() {
+//> Stack Guards reserve-stacks
+  vm.maxFrames = maxFramesSetting;
+  vm.frames = reserveStack(sizeof(CallFrame) * vm.maxFrames);
+#if FAST_STACK_ENABLED
+  vm.stackSlots = vm.maxFrames * STACK_SLOTS_PER_FRAME;
+  vm.fastStack = reserveStack(sizeof(Value) * vm.stackSlots);
+  if (vm.frames == NULL || vm.fastStack == NULL) {
+#else
+  if (vm.frames == NULL) {
+#endif
+    fprintf(stderr, "Could not reserve the VM stacks.\n");
+    exit(74);
+  }
+//< Stack Guards reserve-stacks
 #if FAST_STACK_ENABLED
-  // Fast stack is pre-allocated, just reset the pointer
+  // Fast stack is reserved above, just reset the pointer
   resetStack();
 #else
 //> Initialize dynamic stack
@@ -1278,13 +1399,64 @@ void initVM() {
 //> Strings init-objects-root
   vm.objects = NULL;
 //< Strings init-objects-root
+//> Garbage Collection init-gc-fields
+  vm.bytesAllocated = 0;
+  vm.nextGC = 1024 * 1024;
+//< Garbage Collection init-gc-fields
+//> Generational GC init-vm-fields
+  vm.youngObjects = NULL;
+  vm.nursery = NULL;
+  vm.nurseryCurrent = NULL;
+  vm.nurseryBlockCount = 0;
+  vm.rememberedCount = 0;
+  vm.rememberedCapacity = 0;
+  vm.rememberedSet = NULL;
+//< Generational GC init-vm-fields
+//> Garbage Collection init-gray-stack
+
+  vm.grayCount = 0;
+  vm.grayCapacity = 0;
+  vm.grayStack = NULL;
+//< Garbage Collection init-gray-stack
+//> Incremental GC init-vm-fields
+  vm.gcPhase = GC_PHASE_IDLE;
+  vm.gcPauseUs = 0;
+  vm.gcEpoch = 0;
+  vm.gcMarkingIncremental = false;
+  vm.gcSafepointCountdown = GC_SAFEPOINT_INTERVAL;
+  vm.gcLastSliceEnd = 0;
+  vm.gcSweepLink = NULL;
+  vm.gcScanHash = NULL;
+  vm.gcScanEntries = NULL;
+  vm.gcScanCapacity = 0;
+  vm.gcScanIndex = 0;
+  vm.incrementalGrayCount = 0;
+  vm.incrementalGrayCapacity = 0;
+  vm.incrementalGrayStack = NULL;
+//< Incremental GC init-vm-fields
+//> Inline Caches init-ic-stats
+  vm.icHits = 0;
+  vm.icMisses = 0;
+  vm.icMegamorphic = 0;
+  vm.callCacheHits = 0;
+  vm.callCacheMisses = 0;
+//< Inline Caches init-ic-stats
 //> Global Variables init-globals
 
+/* Global Variables init-globals < Global Slots init-global-slots
   initTable(&vm.globals);
+*/
+//> Global Slots init-global-slots
+  initTable(&vm.globalNames);
+  initValueArray(&vm.globalValues);
+//< Global Slots init-global-slots
 //< Global Variables init-globals
 //> Hash Tables init-strings
   initTable(&vm.strings);
 //< Hash Tables init-strings
+//> Module System init-modules
+  initTable(&vm.modules);
+//< Module System init-modules
 //> Methods and Initializers init-init-string
 
 //> null-init-string
@@ -1292,6 +1464,14 @@ void initVM() {
 //< null-init-string
   vm.initString = copyString("init", 4);
 //< Methods and Initializers init-init-string
+//> Arrays init-array-method-names
+  vm.pushString = NULL;
+  vm.popString = NULL;
+  vm.lenString = NULL;
+  vm.pushString = copyString("push", 4);
+  vm.popString = copyString("pop", 3);
+  vm.lenString = copyString("len", 3);
+//< Arrays init-array-method-names
 //> Calls and Functions define-native-clock
 
   defineNative("clock", clockNative);
@@ -1318,6 +1498,11 @@ void initVM() {
 //> Memory Safety VM Init
   vm.currentScopeDepth = 0;
 //< Memory Safety VM Init
+//> Memory Safety init-scope-objects
+  vm.scopeObjects = NULL;
+  vm.scopeObjectCount = 0;
+  vm.scopeObjectCapacity = 0;
+//< Memory Safety init-scope-objects
 //> Initialize Closure Cache
   // Initialize closure cache for recursive function optimization
   cachedRecursiveClosure = NULL;
@@ -1337,27 +1522,58 @@ void freeVM() {
   FREE_ARRAY(Value, vm.stack, vm.stackCapacity);
 //< Free dynamic stack
 #endif
+//> Stack Guards release-stacks
+#if FAST_STACK_ENABLED
+  releaseStack(vm.fastStack, sizeof(Value) * vm.stackSlots);
+  vm.fastStack = NULL;
+  vm.stackTop = NULL;
+#endif
+  releaseStack(vm.frames, sizeof(CallFrame) * vm.maxFrames);
+  vm.frames = NULL;
+//< Stack Guards release-stacks
 //> Global Variables free-globals
+/* Global Variables free-globals < Global Slots free-global-slots
   freeTable(&vm.globals);
+*/
+//> Global Slots free-global-slots
+  freeTable(&vm.globalNames);
+  freeValueArray(&vm.globalValues);
+//< Global Slots free-global-slots
 //< Global Variables free-globals
 //> Hash Tables free-strings
   freeTable(&vm.strings);
 //< Hash Tables free-strings
+//> Module System free-modules
+  freeTable(&vm.modules);
+//< Module System free-modules
 //> Methods and Initializers clear-init-string
   vm.initString = NULL;
 //< Methods and Initializers clear-init-string
+//> Arrays clear-array-method-names
+  vm.pushString = NULL;
+  vm.popString = NULL;
+  vm.lenString = NULL;
+//< Arrays clear-array-method-names
 //> Strings call-free-objects
   freeObjects();
 //< Strings call-free-objects
 }
+//> Garbage Collection mark-vm-caches
+// Roots that live outside the VM struct proper: the recursive closure
+// cache and the per-call-site inline caches.
+void markVMCaches() {
+  markObject((Obj*)cachedRecursiveClosure);
+  markObject((Obj*)cachedRecursiveFunction);
+}
+//< Garbage Collection mark-vm-caches
 //> push
 void push(Value value) {
 #if FAST_STACK_ENABLED
   // Fast stack - no bounds checking in release builds
   #ifdef DEBUG
   // Only check bounds in debug builds
-  if (vm.stackTop - vm.fastStack >= FAST_STACK_SIZE) {
-    fprintf(stderr, "Stack overflow - increase FAST_STACK_SIZE\n");
+  if (vm.stackTop - vm.fastStack >= vm.stackSlots) {
+    fprintf(stderr, "Stack overflow - increase --max-frames\n");
     exit(74);
   }
   #endif
@@ -1375,7 +1591,7 @@ void push(Value value) {
     int stackTopOffset = currentSize;
     
     // Save frame slot offsets before reallocation
-    int slotOffsets[FRAMES_MAX];
+    int slotOffsets[vm.frameCount + 1];
     for (int i = 0; i < vm.frameCount; i++) {
       slotOffsets[i] = (int)(vm.frames[i].slots - oldStack);
     }
@@ -1423,41 +1639,21 @@ static bool call(ObjClosure* closure, int argCount) {
   // In a statically typed language, arity and stack overflow should be checked at compile time
   // These runtime checks are removed for maximum performance
   
-  // Track function calls for JIT compilation
-  trackHotSpot(closure->function->chunk.code, true);
-  
-  // Check if we should compile this function
-  if (shouldCompile(closure->function->chunk.code)) {
-    JitFunction* jitFunc = compileFunction(closure);
-    // Removed debug output for performance
-  }
-  
-  // Check if we have a compiled version and should execute it
-  JitFunction* jitFunc = findCompiledFunction(closure->function->chunk.code);
-  if (jitFunc != NULL) {
-    // Set up frame for JIT execution
-    CallFrame* frame = &vm.frames[vm.frameCount++];
-    frame->closure = closure;
-    frame->ip = closure->function->chunk.code;
-    frame->slots = vm.stackTop - argCount - 1;
-    
-    // Execute JIT compiled function
-    InterpretResult result = executeJitFunction(jitFunc, &vm, frame);
-    if (result == INTERPRET_OK) {
-      // JIT execution successful, adjust frame count
-      vm.frameCount--;
-      return true;
-    } else {
-      // JIT execution failed, fall back to interpreter
-      vm.frameCount--;
-      // Removed debug output for performance
-    }
-  }
+  // Track function calls for JIT compilation, compiling the function once
+  // it is hot
+  JitFunction* jitFunc = trackFunctionCall(closure);
   
   CallFrame* frame = &vm.frames[vm.frameCount++];
   frame->closure = closure;
   frame->ip = closure->function->chunk.code;
   frame->slots = vm.stackTop - argCount - 1;
+  
+  if (jitFunc != NULL) {
+    // Compiled code runs the frame until it returns or stops at an
+    // instruction the interpreter has to finish. Either way run() carries
+    // on with whatever frame is on top.
+    return executeJitFunction(jitFunc, &vm, frame) == INTERPRET_OK;
+  }
   return true;
 }
 //< Calls and Functions call
@@ -1537,9 +1733,64 @@ static bool invokeFromClass(ObjClass* klass, ObjString* name,
   return call(AS_CLOSURE(method), argCount);
 }
 //< Methods and Initializers invoke-from-class
+//> Arrays array-index
+// Arrays are indexed by position straight into their element storage.
+// Only whole numbers inside the current bounds are valid indices.
+static bool arrayIndex(ObjArray* array, Value index, int* slot) {
+  if (!IS_NUMBER(index)) {
+    runtimeError("Array indices must be numbers.");
+    return false;
+  }
+
+  double number = AS_NUMBER(index);
+  if (number != floor(number)) {
+    runtimeError("Array index must be an integer.");
+    return false;
+  }
+  if (number < 0 || number >= array->elements.count) {
+    runtimeError("Array index %g out of bounds for length %d.",
+                 number, array->elements.count);
+    return false;
+  }
+
+  *slot = (int)number;
+  return true;
+}
+//< Arrays array-index
+//> Arrays invoke-array
+static bool invokeArray(ObjArray* array, ObjString* name, int argCount) {
+  Value result;
+  if (name == vm.pushString && argCount == 1) {
+    writeValueArray(&array->elements, peek(0));
+    writeBarrier((Obj*)array, peek(0));
+    result = NUMBER_VAL(array->elements.count);
+  } else if (name == vm.popString && argCount == 0) {
+    if (array->elements.count == 0) {
+      result = NIL_VAL;
+    } else {
+      result = array->elements.values[--array->elements.count];
+    }
+  } else if (name == vm.lenString && argCount == 0) {
+    result = NUMBER_VAL(array->elements.count);
+  } else {
+    runtimeError("Undefined array method '%s' with %d arguments.",
+                 name->chars, argCount);
+    return false;
+  }
+
+  vm.stackTop -= argCount + 1;
+  push(result);
+  return true;
+}
+//< Arrays invoke-array
 //> Methods and Initializers invoke
 static bool invoke(ObjString* name, int argCount) {
   Value receiver = peek(argCount);
+//> Arrays invoke-array-receiver
+  if (IS_ARRAY(receiver)) {
+    return invokeArray(AS_ARRAY(receiver), name, argCount);
+  }
+//< Arrays invoke-array-receiver
 //> invoke-check-type
 
   if (!IS_INSTANCE(receiver)) {
@@ -1552,7 +1803,12 @@ static bool invoke(ObjString* name, int argCount) {
 //> invoke-field
 
   Value value;
+/* Methods and Initializers invoke-field < Shapes invoke-field-slot
   if (tableGet(&instance->fields, name, &value)) {
+*/
+//> Shapes invoke-field-slot
+  if (instanceGetField(instance, name, &value)) {
+//< Shapes invoke-field-slot
     vm.stackTop[-argCount - 1] = value;
     return callValue(value, argCount);
   }
@@ -1612,6 +1868,7 @@ static void closeUpvalues(Value* last) {
     ObjUpvalue* upvalue = vm.openUpvalues;
     upvalue->closed = *upvalue->location;
     upvalue->location = &upvalue->closed;
+    writeBarrier((Obj*)upvalue, upvalue->closed);
     vm.openUpvalues = upvalue->next;
   }
 }
@@ -1621,6 +1878,7 @@ static void defineMethod(ObjString* name) {
   Value method = peek(0);
   ObjClass* klass = AS_CLASS(peek(1));
   tableSet(&klass->methods, name, method);
+  writeBarrier((Obj*)klass, method);
   pop();
 }
 //< Methods and Initializers define-method
@@ -1680,8 +1938,302 @@ static bool checkObjectMutation(Value value, const char* operation) {
 }
 //< Memory Safety VM Functions
 
+//> Inline Caches property-cache-helpers
+// Hands out the next entry of a property cache for `shape`, or NULL once
+// the site has seen too many shapes to be worth caching.
+static PropertyCacheEntry* claimCacheEntry(ObjFunction* function,
+                                           PropertyCache* cache,
+                                           ObjShape* shape) {
+  if (cache->megamorphic) return NULL;
+  if (cache->count == PROPERTY_CACHE_WAYS) {
+    cache->megamorphic = true;
+    vm.icMegamorphic++;
+    return NULL;
+  }
+
+  PropertyCacheEntry* entry = &cache->entries[cache->count++];
+  entry->shape = shape;
+  entry->transition = NULL;
+  entry->method = NIL_VAL;
+  entry->slot = -1;
+  writeBarrier((Obj*)function, OBJ_VAL(shape));
+  return entry;
+}
+
+// Replaces the instance on top of the stack with its property when the
+// cache knows the instance's shape.
+static inline bool getCachedProperty(PropertyCache* cache,
+                                     ObjInstance* instance) {
+  for (int i = 0; i < cache->count; i++) {
+    PropertyCacheEntry* entry = &cache->entries[i];
+    if (entry->shape != instance->shape) continue;
+
+    vm.icHits++;
+    if (entry->slot >= 0) {
+      vm.stackTop[-1] = instance->fields[entry->slot];
+    } else {
+      ObjBoundMethod* bound = newBoundMethod(vm.stackTop[-1],
+                                             AS_CLOSURE(entry->method));
+      vm.stackTop[-1] = OBJ_VAL(bound);
+    }
+    return true;
+  }
+  return false;
+}
+
+static bool getUncachedProperty(ObjFunction* function, PropertyCache* cache,
+                                ObjInstance* instance, ObjString* name) {
+  vm.icMisses++;
+  int slot = shapeFind(instance->shape, name);
+  if (slot != -1) {
+    PropertyCacheEntry* entry =
+        claimCacheEntry(function, cache, instance->shape);
+    if (entry != NULL) entry->slot = slot;
+    vm.stackTop[-1] = instance->fields[slot];
+    return true;
+  }
+
+  Value method;
+  if (!tableGet(&instance->klass->methods, name, &method)) {
+    runtimeError("Undefined property '%s'.", AS_CSTRING(OBJ_VAL(name)));
+    return false;
+  }
+
+  PropertyCacheEntry* entry = claimCacheEntry(function, cache, instance->shape);
+  if (entry != NULL) {
+    entry->method = method;
+    writeBarrier((Obj*)function, method);
+  }
+  ObjBoundMethod* bound = newBoundMethod(peek(0), AS_CLOSURE(method));
+  vm.stackTop[-1] = OBJ_VAL(bound);
+  return true;
+}
+
+// Stores into an existing slot, or takes a cached transition when the
+// instance still has room for the new field.
+static inline bool setCachedProperty(PropertyCache* cache,
+                                     ObjInstance* instance, Value value) {
+  for (int i = 0; i < cache->count; i++) {
+    PropertyCacheEntry* entry = &cache->entries[i];
+    if (entry->shape != instance->shape) continue;
+
+    if (entry->transition != NULL) {
+      if (entry->slot >= instance->capacity) return false;
+      instance->shape = entry->transition;
+      writeBarrier((Obj*)instance, OBJ_VAL(entry->transition));
+    }
+    vm.icHits++;
+    instance->fields[entry->slot] = value;
+    writeBarrier((Obj*)instance, value);
+    return true;
+  }
+  return false;
+}
+
+static void setUncachedProperty(ObjFunction* function, PropertyCache* cache,
+                                ObjInstance* instance, ObjString* name,
+                                Value value) {
+  vm.icMisses++;
+  ObjShape* shape = instance->shape;
+  int slot = shapeFind(shape, name);
+  instanceSetField(instance, name, value);
+
+  PropertyCacheEntry* entry = claimCacheEntry(function, cache, shape);
+  if (entry == NULL) return;
+  if (slot == -1) {
+    entry->slot = shape->fieldCount;
+    entry->transition = instance->shape;
+    writeBarrier((Obj*)function, OBJ_VAL(instance->shape));
+  } else {
+    entry->slot = slot;
+  }
+}
+
+static void updateCallCache(ObjFunction* function, InlineCache* cache,
+                            Obj* key, ObjClosure* closure) {
+  cache->key = key;
+  cache->closure = closure;
+  cache->hitCount = 0;
+  writeBarrier((Obj*)function, OBJ_VAL(key));
+  writeBarrier((Obj*)function, OBJ_VAL(closure));
+}
+
+// OP_CALL: a hit on a closure or class skips callValue()'s type dispatch
+// and, for classes, the initializer lookup.
+static bool callWithCache(ObjFunction* function, InlineCache* cache,
+                          int argCount) {
+  Value callee = peek(argCount);
+  if (IS_OBJ(callee) && AS_OBJ(callee) == cache->key) {
+    vm.callCacheHits++;
+    cache->hitCount++;
+    if (cache->key->type == OBJ_CLASS) {
+      ObjInstance* instance = newInstance((ObjClass*)cache->key);
+      vm.stackTop[-argCount - 1] = OBJ_VAL(instance);
+    }
+    return call(cache->closure, argCount);
+  }
+
+  vm.callCacheMisses++;
+  if (IS_CLOSURE(callee)) {
+    updateCallCache(function, cache, AS_OBJ(callee), AS_CLOSURE(callee));
+  } else if (IS_CLASS(callee)) {
+    Value initializer;
+    if (tableGet(&AS_CLASS(callee)->methods, vm.initString, &initializer)) {
+      updateCallCache(function, cache, AS_OBJ(callee),
+                      AS_CLOSURE(initializer));
+    }
+  }
+  return callValue(callee, argCount);
+}
+
+//> Tail Calls tail-call
+// OP_TAIL_CALL: the callee's result is the caller's result, so a closure
+// callee takes over the caller's frame instead of pushing a new one. The
+// callee and its arguments slide down over the caller's slots and the
+// frame restarts at the callee's first instruction. Anything else is an
+// ordinary call whose result the following OP_RETURN hands back.
+static bool tailCall(ObjFunction* function, InlineCache* cache,
+                     int argCount) {
+  Value callee = peek(argCount);
+  if (!IS_CLOSURE(callee)) return callWithCache(function, cache, argCount);
+
+  CallFrame* frame = &vm.frames[vm.frameCount - 1];
+  closeUpvalues(frame->slots);
+  Value* args = vm.stackTop - argCount - 1;
+  memmove(frame->slots, args, sizeof(Value) * (argCount + 1));
+  vm.stackTop = frame->slots + argCount + 1;
+
+  ObjClosure* closure = AS_CLOSURE(callee);
+  frame->closure = closure;
+  frame->ip = closure->function->chunk.code;
+  return true;
+}
+//< Tail Calls tail-call
+//> Inlining inline-guards
+// OP_INLINE_INVOKE: whether the receiver's method is the one compiled in
+// place. The answer is cached by shape as for OP_INVOKE, which shares the
+// cache when the guard fails.
+static bool inlinedMethodMatches(ObjFunction* function, InlineCache* cache,
+                                 ObjString* name, ObjFunction* inlined,
+                                 int argCount) {
+  Value receiver = peek(argCount);
+  if (!IS_INSTANCE(receiver)) return false;
+
+  ObjInstance* instance = AS_INSTANCE(receiver);
+  if ((Obj*)instance->shape == cache->key) {
+    vm.callCacheHits++;
+    cache->hitCount++;
+    return cache->closure->function == inlined;
+  }
+
+  Value method;
+  if (shapeFind(instance->shape, name) != -1 ||
+      !tableGet(&instance->klass->methods, name, &method)) {
+    return false;
+  }
+  vm.callCacheMisses++;
+  updateCallCache(function, cache, (Obj*)instance->shape,
+                  AS_CLOSURE(method));
+  return AS_CLOSURE(method)->function == inlined;
+}
+//< Inlining inline-guards
+
+// OP_INVOKE: a receiver whose shape matches the cache has no field by this
+// name and belongs to the class the method came from, so the field and
+// method lookups are both skipped.
+static bool invokeWithCache(ObjFunction* function, InlineCache* cache,
+                            ObjString* name, int argCount) {
+  Value receiver = peek(argCount);
+  if (!IS_INSTANCE(receiver)) return invoke(name, argCount);
+
+  ObjInstance* instance = AS_INSTANCE(receiver);
+  if ((Obj*)instance->shape == cache->key) {
+    vm.callCacheHits++;
+    cache->hitCount++;
+    return call(cache->closure, argCount);
+  }
+
+  vm.callCacheMisses++;
+  Value method;
+  if (shapeFind(instance->shape, name) == -1 &&
+      tableGet(&instance->klass->methods, name, &method)) {
+    updateCallCache(function, cache, (Obj*)instance->shape,
+                    AS_CLOSURE(method));
+    return call(AS_CLOSURE(method), argCount);
+  }
+  return invoke(name, argCount);
+}
+
+//> Module Slots module-call-cache
+// OP_MODULE_CALL: a module's functions are fixed once its body has run, so
+// a site that has already seen this module calls the cached closure
+// without looking the name up.
+static bool moduleCallWithCache(ObjFunction* function, InlineCache* cache,
+                                ObjString* name, int argCount) {
+  Value receiver = peek(argCount);
+  if (IS_OBJ(receiver) && AS_OBJ(receiver) == cache->key) {
+    vm.callCacheHits++;
+    cache->hitCount++;
+    vm.stackTop[-argCount - 1] = OBJ_VAL(cache->closure);
+    return call(cache->closure, argCount);
+  }
+
+  vm.callCacheMisses++;
+  if (!IS_MODULE(receiver)) {
+    runtimeError("Can only call methods on modules.");
+    return false;
+  }
+
+  ObjModule* module = AS_MODULE(receiver);
+  Value slot;
+  if (!tableGet(&module->functions, name, &slot)) {
+    runtimeError("Undefined method '%s' in module '%s'.",
+                 AS_CSTRING(OBJ_VAL(name)),
+                 AS_CSTRING(OBJ_VAL(module->name)));
+    return false;
+  }
+
+  Value method = module->slots.values[(int)AS_NUMBER(slot)];
+  if (!IS_CLOSURE(method)) {
+    runtimeError("Module method is not a function.");
+    return false;
+  }
+
+  updateCallCache(function, cache, (Obj*)module, AS_CLOSURE(method));
+  // Replace the module on the stack with the method
+  vm.stackTop[-argCount - 1] = method;
+  return call(AS_CLOSURE(method), argCount);
+}
+//< Module Slots module-call-cache
+
+void printInlineCacheStats() {
+  uint64_t lookups = vm.icHits + vm.icMisses;
+  uint64_t calls = vm.callCacheHits + vm.callCacheMisses;
+  printf("=== Inline Cache Statistics ===\n");
+  printf("Property hits:       %llu\n", (unsigned long long)vm.icHits);
+  printf("Property misses:     %llu\n", (unsigned long long)vm.icMisses);
+  printf("Megamorphic sites:   %llu\n", (unsigned long long)vm.icMegamorphic);
+  printf("Hit rate:            %.1f%%\n",
+         lookups == 0 ? 0.0 : 100.0 * vm.icHits / lookups);
+  printf("Call hits:           %llu\n", (unsigned long long)vm.callCacheHits);
+  printf("Call misses:         %llu\n",
+         (unsigned long long)vm.callCacheMisses);
+  printf("Call hit rate:       %.1f%%\n",
+         calls == 0 ? 0.0 : 100.0 * vm.callCacheHits / calls);
+  printf("===============================\n");
+}
+//< Inline Caches property-cache-helpers
 //> run
+/* A Virtual Machine run < JIT Integration run-step
 InterpretResult run() {
+*/
+//> JIT Integration run-step
+// With singleStep set, executes the instruction at the top frame's ip and
+// returns with ip at the next one, leaving behind whatever frames the
+// instruction pushed or popped. Compiled code runs the instructions it
+// doesn't translate itself this way.
+static InterpretResult execute(bool singleStep) {
+//< JIT Integration run-step
 //> Calls and Functions run
   CallFrame* frame = &vm.frames[vm.frameCount - 1];
 
@@ -1714,6 +2266,48 @@ InterpretResult run() {
 //> Global Variables read-string
 #define READ_STRING() AS_STRING(READ_CONSTANT())
 //< Global Variables read-string
+//> Inline Caches read-property-cache
+#define READ_PROPERTY_CACHE() \
+    (&frame->closure->function->chunk.propertyCaches[READ_SHORT()])
+#define READ_CALL_CACHE() \
+    (&frame->closure->function->chunk.callCaches[READ_SHORT()])
+//< Inline Caches read-property-cache
+//> Quickening quicken-macros
+// Rewrites the instruction being executed. DEQUICKEN also backs up so the
+// next dispatch reruns it as [op].
+#define QUICKEN(op) (frame->ip[-1] = (uint8_t)(op))
+#define DEQUICKEN(op) \
+    do { \
+      frame->ip[-1] = (uint8_t)(op); \
+      frame->ip--; \
+    } while (false)
+//< Quickening quicken-macros
+//> JIT Integration enter-hot-loop
+// Counts a back-edge, with ip at the loop header. Once the function has
+// been compiled, the frame carries on in compiled code from the header.
+#define ENTER_HOT_LOOP() \
+    do { \
+      JitFunction* loopCode = trackLoopBackEdge(frame->closure); \
+      if (loopCode != NULL) { \
+        if (executeJitFunction(loopCode, &vm, frame) != INTERPRET_OK) { \
+          return INTERPRET_RUNTIME_ERROR; \
+        } \
+        if (vm.frameCount == 0) return INTERPRET_OK; \
+        frame = &vm.frames[vm.frameCount - 1]; \
+      } \
+    } while (false)
+//< JIT Integration enter-hot-loop
+//> Fused Branches compare-jump-macro
+// Pops two numbers and takes the forward jump unless `a op b` holds.
+#define COMPARE_JUMP(op) \
+    do { \
+      uint16_t offset = READ_SHORT(); \
+      vm.stackTop -= 2; \
+      if (!(AS_NUMBER(vm.stackTop[0]) op AS_NUMBER(vm.stackTop[1]))) { \
+        frame->ip += offset; \
+      } \
+    } while (false)
+//< Fused Branches compare-jump-macro
 /* A Virtual Machine binary-op < Types of Values binary-op
 #define BINARY_OP(op) \
     do { \
@@ -1848,6 +2442,9 @@ InterpretResult run() {
     [OP_GET_GLOBAL] = &&op_get_global,
     [OP_DEFINE_GLOBAL] = &&op_define_global,
     [OP_SET_GLOBAL] = &&op_set_global,
+    [OP_GET_GLOBAL_SLOT] = &&op_get_global_slot,
+    [OP_DEFINE_GLOBAL_SLOT] = &&op_define_global_slot,
+    [OP_SET_GLOBAL_SLOT] = &&op_set_global_slot,
     [OP_GET_UPVALUE] = &&op_get_upvalue,
     [OP_SET_UPVALUE] = &&op_set_upvalue,
     [OP_GET_PROPERTY] = &&op_get_property,
@@ -1855,6 +2452,9 @@ InterpretResult run() {
     [OP_GET_INDEX] = &&op_get_index,
     [OP_SET_INDEX] = &&op_set_index,
     [OP_HASH_LITERAL] = &&op_hash_literal,
+    [OP_ARRAY_LITERAL] = &&op_array_literal,
+    [OP_GET_ARRAY_INDEX] = &&op_get_array_index,
+    [OP_SET_ARRAY_INDEX] = &&op_set_array_index,
     [OP_GET_SUPER] = &&op_get_super,
     [OP_EQUAL] = &&op_equal,
     [OP_GREATER] = &&op_greater,
@@ -1892,11 +2492,44 @@ InterpretResult run() {
     [OP_INHERIT] = &&op_inherit,
     [OP_METHOD] = &&op_method,
     [OP_TYPE_CAST] = &&op_type_cast,
+    [OP_GET_LOCAL_GET_LOCAL] = &&op_get_local_get_local,
+    [OP_GET_LOCAL_CONSTANT] = &&op_get_local_constant,
+    [OP_ADD_LOCAL_LOCAL] = &&op_add_local_local,
+    [OP_ADD_LOCAL_CONSTANT] = &&op_add_local_constant,
+    [OP_SUBTRACT_LOCAL_CONSTANT] = &&op_subtract_local_constant,
+    [OP_SET_LOCAL_POP] = &&op_set_local_pop,
+    [OP_SET_GLOBAL_SLOT_POP] = &&op_set_global_slot_pop,
+    [OP_POP_LOOP] = &&op_pop_loop,
+    [OP_QUICK_ADD_NUMBER] = &&op_quick_add_number,
+    [OP_QUICK_ADD_STRING] = &&op_quick_add_string,
+    [OP_QUICK_LESS_NUMBER] = &&op_quick_less_number,
+    [OP_QUICK_GREATER_NUMBER] = &&op_quick_greater_number,
+    [OP_QUICK_EQUAL_NUMBER] = &&op_quick_equal_number,
+    [OP_JUMP_IF_NOT_LESS_NUMBER] = &&op_jump_if_not_less_number,
+    [OP_JUMP_IF_NOT_LESS_EQUAL_NUMBER] = &&op_jump_if_not_less_equal_number,
+    [OP_JUMP_IF_NOT_GREATER_NUMBER] = &&op_jump_if_not_greater_number,
+    [OP_JUMP_IF_NOT_GREATER_EQUAL_NUMBER] = &&op_jump_if_not_greater_equal_number,
+    [OP_JUMP_IF_NOT_EQUAL_NUMBER] = &&op_jump_if_not_equal_number,
+    [OP_TAIL_CALL] = &&op_tail_call,
+    [OP_INLINE_CALL] = &&op_inline_call,
+    [OP_INLINE_INVOKE] = &&op_inline_invoke,
+    [OP_GET_STACK] = &&op_get_stack,
+    [OP_SET_STACK] = &&op_set_stack,
+    [OP_INLINE_RETURN] = &&op_inline_return,
+  };
+//> JIT Integration step-table
+  // Every instruction after the first dispatches through this table while
+  // single-stepping, and every entry ends the run.
+  static void* stepTable[] = {
+    [0 ... sizeof(dispatchTable) / sizeof(dispatchTable[0]) - 1] =
+        &&op_step_done,
   };
+  void** table = singleStep ? stepTable : dispatchTable;
+//< JIT Integration step-table
 
 #define DISPATCH() \
   do { \
-    goto *dispatchTable[READ_BYTE()]; \
+    goto *table[READ_BYTE()]; \
   } while (false)
 
 #ifdef DEBUG_TRACE_EXECUTION
@@ -1922,9 +2555,9 @@ InterpretResult run() {
   do { \
     uint8_t instruction = READ_BYTE(); \
     if (LIKELY(instruction <= OP_DIVIDE_NUMBER)) { \
-      goto *dispatchTable[instruction]; \
+      goto *table[instruction]; \
     } else { \
-      goto *dispatchTable[instruction]; \
+      goto *table[instruction]; \
     } \
   } while (false)
 #else
@@ -1932,6 +2565,9 @@ InterpretResult run() {
 #endif
 //< Branch Prediction Optimization
 
+//> JIT Integration step-first
+  if (singleStep) goto *dispatchTable[READ_BYTE()];
+//< JIT Integration step-first
   LIKELY_DISPATCH();
 
 op_constant: {
@@ -1999,8 +2635,8 @@ op_set_local: {
 op_get_global: {
   TRACE();
   ObjString* name = READ_STRING();
-  Value value;
-  if (!tableGet(&vm.globals, name, &value)) {
+  Value value = vm.globalValues.values[globalSlot(name)];
+  if (IS_UNDEFINED(value)) {
     runtimeError("Undefined variable '%s'.", AS_CSTRING(OBJ_VAL(name)));
     return INTERPRET_RUNTIME_ERROR;
   }
@@ -2011,7 +2647,8 @@ op_get_global: {
 op_define_global: {
   TRACE();
   ObjString* name = READ_STRING();
-  tableSet(&vm.globals, name, peek(0));
+  int slot = globalSlot(name);
+  vm.globalValues.values[slot] = peek(0);
   pop();
   DISPATCH();
 }
@@ -2019,11 +2656,43 @@ op_define_global: {
 op_set_global: {
   TRACE();
   ObjString* name = READ_STRING();
-  if (tableSet(&vm.globals, name, peek(0))) {
-    tableDelete(&vm.globals, name);
+  int slot = globalSlot(name);
+  if (IS_UNDEFINED(vm.globalValues.values[slot])) {
     runtimeError("Undefined variable '%s'.", AS_CSTRING(OBJ_VAL(name)));
     return INTERPRET_RUNTIME_ERROR;
   }
+  vm.globalValues.values[slot] = peek(0);
+  DISPATCH();
+}
+
+op_get_global_slot: {
+  TRACE();
+  uint16_t slot = READ_SHORT();
+  Value value = vm.globalValues.values[slot];
+  if (UNLIKELY(IS_UNDEFINED(value))) {
+    runtimeError("Undefined variable '%s'.", globalSlotName(slot));
+    return INTERPRET_RUNTIME_ERROR;
+  }
+  push(value);
+  DISPATCH();
+}
+
+op_define_global_slot: {
+  TRACE();
+  vm.globalValues.values[READ_SHORT()] = pop();
+  DISPATCH();
+}
+
+op_set_global_slot: {
+  TRACE();
+  uint16_t slot = READ_SHORT();
+  // vm.globalValues is scanned as a root by every collection, minor or
+  // full, so stores into it need no write barrier.
+  if (UNLIKELY(IS_UNDEFINED(vm.globalValues.values[slot]))) {
+    runtimeError("Undefined variable '%s'.", globalSlotName(slot));
+    return INTERPRET_RUNTIME_ERROR;
+  }
+  vm.globalValues.values[slot] = peek(0);
   DISPATCH();
 }
 
@@ -2037,7 +2706,9 @@ op_get_upvalue: {
 op_set_upvalue: {
   TRACE();
   uint8_t slot = READ_BYTE();
-  *frame->closure->upvalues[slot]->location = peek(0);
+  ObjUpvalue* upvalue = frame->closure->upvalues[slot];
+  *upvalue->location = peek(0);
+  writeBarrier((Obj*)upvalue, peek(0));
   DISPATCH();
 }
 
@@ -2062,17 +2733,26 @@ op_get_property: {
   ObjInstance* instance = AS_INSTANCE(peek(0));
   ObjString* name = READ_STRING();
   
+/* Shapes get-field-slot < Inline Caches get-property-ic
   Value value;
-  if (tableGet(&instance->fields, name, &value)) {
+  if (instanceGetField(instance, name, &value)) {
     pop(); // Instance.
     push(value);
     DISPATCH();
   }
 
-//< get-undefined
   if (!bindMethod(instance->klass, name)) {
     return INTERPRET_RUNTIME_ERROR;
   }
+*/
+//< get-undefined
+//> Inline Caches get-property-ic
+  PropertyCache* cache = READ_PROPERTY_CACHE();
+  if (!getCachedProperty(cache, instance) &&
+      !getUncachedProperty(frame->closure->function, cache, instance, name)) {
+    return INTERPRET_RUNTIME_ERROR;
+  }
+//< Inline Caches get-property-ic
   DISPATCH();
 }
 
@@ -2096,7 +2776,16 @@ op_set_property: {
   
   ObjInstance* instance = AS_INSTANCE(peek(1));
   ObjString* name = READ_STRING();
-  tableSet(&instance->fields, name, peek(0));
+/* Shapes set-field-slot < Inline Caches set-property-ic
+  instanceSetField(instance, name, peek(0));
+*/
+//> Inline Caches set-property-ic
+  PropertyCache* cache = READ_PROPERTY_CACHE();
+  if (!setCachedProperty(cache, instance, peek(0))) {
+    setUncachedProperty(frame->closure->function, cache, instance, name,
+                        peek(0));
+  }
+//< Inline Caches set-property-ic
   Value value = pop();
   pop();
   push(value);
@@ -2118,27 +2807,46 @@ op_equal: {
   TRACE();
   Value b = pop();
   Value a = pop();
+  if (IS_NUMBER(a) && IS_NUMBER(b)) QUICKEN(OP_QUICK_EQUAL_NUMBER);
   push(BOOL_VAL(valuesEqual(a, b)));
   DISPATCH();
 }
 
 op_greater: {
   TRACE();
+  if (IS_NUMBER(peek(0)) && IS_NUMBER(peek(1))) {
+    QUICKEN(OP_QUICK_GREATER_NUMBER);
+  }
   BINARY_OP(BOOL_VAL, >);
   DISPATCH();
 }
 
 op_less: {
   TRACE();
+  if (IS_NUMBER(peek(0)) && IS_NUMBER(peek(1))) {
+    QUICKEN(OP_QUICK_LESS_NUMBER);
+  }
   BINARY_OP(BOOL_VAL, <);
   DISPATCH();
 }
 
 op_add: {
   TRACE();
-  // Generic OP_ADD should never be emitted by the optimized compiler
-  runtimeError("Generic OP_ADD used - compiler error. Use OP_ADD_NUMBER or OP_ADD_STRING.");
-  return INTERPRET_RUNTIME_ERROR;
+  // Emitted when the compiler can't tell the operand types. The first
+  // execution picks a typed variant and rewrites the instruction to it.
+  if (IS_NUMBER(peek(0)) && IS_NUMBER(peek(1))) {
+    QUICKEN(OP_QUICK_ADD_NUMBER);
+    double b = AS_NUMBER(pop());
+    double a = AS_NUMBER(pop());
+    push(NUMBER_VAL(a + b));
+  } else if (IS_STRING(peek(0)) && IS_STRING(peek(1))) {
+    QUICKEN(OP_QUICK_ADD_STRING);
+    concatenate();
+  } else {
+    runtimeError("Operands must be two numbers or two strings.");
+    return INTERPRET_RUNTIME_ERROR;
+  }
+  DISPATCH();
 }
 
 op_add_number: {
@@ -2373,8 +3081,11 @@ op_require: {
     return INTERPRET_RUNTIME_ERROR;
   }
   
-  // Create closure for the module
+  // Create closure for the module, keeping the function reachable
+  // while the closure is allocated
+  push(OBJ_VAL(function));
   ObjClosure* closure = newClosure(function);
+  pop();
   push(OBJ_VAL(closure));
   
   // Execute the module in the current context
@@ -2404,72 +3115,158 @@ op_jump_if_false: {
 op_loop: {
   TRACE();
   uint16_t offset = READ_SHORT();
-  
-  // Track loop back edge for JIT compilation
-  trackLoopBackEdge(frame->ip - offset);
-  
   frame->ip -= offset;
+  gcSafepoint();
+  ENTER_HOT_LOOP();
   DISPATCH();
 }
 
 op_call: {
   int argCount = READ_BYTE();
+/* Calls and Functions interpret-call < Inline Caches call-site-cache
   if (!callValue(peek(argCount), argCount)) {
     return INTERPRET_RUNTIME_ERROR;
   }
+*/
+//> Inline Caches call-site-cache
+  InlineCache* cache = READ_CALL_CACHE();
+  if (!callWithCache(frame->closure->function, cache, argCount)) {
+    return INTERPRET_RUNTIME_ERROR;
+  }
+//< Inline Caches call-site-cache
   frame = &vm.frames[vm.frameCount - 1];
   DISPATCH();
 }
 
-op_invoke: {
-  ObjString* method = READ_STRING();
+//> Tail Calls interpret-tail-call
+op_tail_call: {
   int argCount = READ_BYTE();
-  if (!invoke(method, argCount)) {
+  InlineCache* cache = READ_CALL_CACHE();
+  if (!tailCall(frame->closure->function, cache, argCount)) {
     return INTERPRET_RUNTIME_ERROR;
   }
   frame = &vm.frames[vm.frameCount - 1];
   DISPATCH();
 }
-
-op_super_invoke: {
-  ObjString* method = READ_STRING();
+//< Tail Calls interpret-tail-call
+//> Inlining interpret-inline
+op_inline_call: {
   int argCount = READ_BYTE();
-  ObjClass* superclass = AS_CLASS(pop());
-  if (!invokeFromClass(superclass, method, argCount)) {
+  ObjFunction* inlined = AS_FUNCTION(READ_CONSTANT());
+  uint16_t skip = READ_SHORT();
+  Value callee = peek(argCount);
+  if (LIKELY(IS_CLOSURE(callee) && AS_CLOSURE(callee)->function == inlined)) {
+    DISPATCH();
+  }
+
+  // The callee's result arrives where the inlined body would leave it.
+  frame->ip += skip;
+  if (!callValue(callee, argCount)) {
     return INTERPRET_RUNTIME_ERROR;
   }
   frame = &vm.frames[vm.frameCount - 1];
   DISPATCH();
 }
 
-op_closure: {
-  ObjFunction* function = AS_FUNCTION(READ_CONSTANT());
-  
-  // Optimization: Reuse closure for recursive functions without upvalues
-  if (function->upvalueCount == 0 && cachedRecursiveFunction == function && cachedRecursiveClosure != NULL) {
-    // Reuse the existing closure for this function
-    push(OBJ_VAL(cachedRecursiveClosure));
+op_inline_invoke: {
+  ObjString* method = READ_STRING();
+  int argCount = READ_BYTE();
+  ObjFunction* inlined = AS_FUNCTION(READ_CONSTANT());
+  InlineCache* cache = READ_CALL_CACHE();
+  uint16_t skip = READ_SHORT();
+  if (LIKELY(inlinedMethodMatches(frame->closure->function, cache, method,
+                                  inlined, argCount))) {
     DISPATCH();
   }
-  
-  ObjClosure* closure = newClosure(function);
-  push(OBJ_VAL(closure));
-  
-  // Cache this closure if it has no upvalues (good candidate for reuse)
-  if (function->upvalueCount == 0) {
-    cachedRecursiveFunction = function;
-    cachedRecursiveClosure = closure;
+
+  frame->ip += skip;
+  if (!invokeWithCache(frame->closure->function, cache, method, argCount)) {
+    return INTERPRET_RUNTIME_ERROR;
   }
-  
-  for (int i = 0; i < closure->upvalueCount; i++) {
-    uint8_t isLocal = READ_BYTE();
-    uint8_t index = READ_BYTE();
-    if (isLocal) {
-      closure->upvalues[i] =
-          captureUpvalue(frame->slots + index);
-    } else {
+  frame = &vm.frames[vm.frameCount - 1];
+  DISPATCH();
+}
+
+op_get_stack: {
+  uint8_t distance = READ_BYTE();
+  Value value = vm.stackTop[-1 - distance];
+  push(value);
+  DISPATCH();
+}
+
+op_set_stack: {
+  uint8_t distance = READ_BYTE();
+  vm.stackTop[-1 - distance] = vm.stackTop[-1];
+  DISPATCH();
+}
+
+op_inline_return: {
+  uint8_t count = READ_BYTE();
+  Value result = vm.stackTop[-1];
+  vm.stackTop -= count;
+  vm.stackTop[-1] = result;
+  DISPATCH();
+}
+//< Inlining interpret-inline
+
+op_invoke: {
+  ObjString* method = READ_STRING();
+  int argCount = READ_BYTE();
+/* Methods and Initializers interpret-invoke < Inline Caches invoke-site-cache
+  if (!invoke(method, argCount)) {
+    return INTERPRET_RUNTIME_ERROR;
+  }
+*/
+//> Inline Caches invoke-site-cache
+  InlineCache* cache = READ_CALL_CACHE();
+  if (!invokeWithCache(frame->closure->function, cache, method, argCount)) {
+    return INTERPRET_RUNTIME_ERROR;
+  }
+//< Inline Caches invoke-site-cache
+  frame = &vm.frames[vm.frameCount - 1];
+  DISPATCH();
+}
+
+op_super_invoke: {
+  ObjString* method = READ_STRING();
+  int argCount = READ_BYTE();
+  ObjClass* superclass = AS_CLASS(pop());
+  if (!invokeFromClass(superclass, method, argCount)) {
+    return INTERPRET_RUNTIME_ERROR;
+  }
+  frame = &vm.frames[vm.frameCount - 1];
+  DISPATCH();
+}
+
+op_closure: {
+  ObjFunction* function = AS_FUNCTION(READ_CONSTANT());
+  
+  // Optimization: Reuse closure for recursive functions without upvalues
+  if (function->upvalueCount == 0 && cachedRecursiveFunction == function && cachedRecursiveClosure != NULL) {
+    // Reuse the existing closure for this function
+    push(OBJ_VAL(cachedRecursiveClosure));
+    DISPATCH();
+  }
+  
+  ObjClosure* closure = newClosure(function);
+  push(OBJ_VAL(closure));
+  
+  // Cache this closure if it has no upvalues (good candidate for reuse)
+  if (function->upvalueCount == 0) {
+    cachedRecursiveFunction = function;
+    cachedRecursiveClosure = closure;
+  }
+  
+  for (int i = 0; i < closure->upvalueCount; i++) {
+    uint8_t isLocal = READ_BYTE();
+    uint8_t index = READ_BYTE();
+    if (isLocal) {
+      closure->upvalues[i] =
+          captureUpvalue(frame->slots + index);
+    } else {
       closure->upvalues[i] = frame->closure->upvalues[index];
     }
+    writeBarrier((Obj*)closure, OBJ_VAL(closure->upvalues[i]));
   }
   DISPATCH();
 }
@@ -2493,6 +3290,7 @@ op_return: {
   vm.stackTop = frame->slots;
   push(result);
   frame = &vm.frames[vm.frameCount - 1];
+  gcSafepoint();
   DISPATCH();
 }
 
@@ -2514,7 +3312,7 @@ op_module_method: {
   ObjClosure* method = AS_CLOSURE(peek(0));
   ObjModule* module = AS_MODULE(peek(1));
   
-  tableSet(&module->functions, methodName, OBJ_VAL(method));
+  moduleSetFunction(module, methodName, OBJ_VAL(method));
   pop(); // Method closure
   DISPATCH();
 }
@@ -2523,31 +3321,9 @@ op_module_call: {
   TRACE();
   ObjString* methodName = READ_STRING();
   int argCount = READ_BYTE();
-  
-  Value moduleValue = peek(argCount);
-  if (!IS_MODULE(moduleValue)) {
-    runtimeError("Can only call methods on modules.");
-    return INTERPRET_RUNTIME_ERROR;
-  }
-  
-  ObjModule* module = AS_MODULE(moduleValue);
-  Value method;
-  if (!tableGet(&module->functions, methodName, &method)) {
-    runtimeError("Undefined method '%s' in module '%s'.", 
-                 AS_CSTRING(OBJ_VAL(methodName)), 
-                 AS_CSTRING(OBJ_VAL(module->name)));
-    return INTERPRET_RUNTIME_ERROR;
-  }
-  
-  if (!IS_CLOSURE(method)) {
-    runtimeError("Module method is not a function.");
-    return INTERPRET_RUNTIME_ERROR;
-  }
-  
-  // Replace the module on the stack with the method
-  vm.stackTop[-argCount - 1] = method;
-  
-  if (!call(AS_CLOSURE(method), argCount)) {
+  InlineCache* cache = READ_CALL_CACHE();
+  if (!moduleCallWithCache(frame->closure->function, cache, methodName,
+                           argCount)) {
     return INTERPRET_RUNTIME_ERROR;
   }
   frame = &vm.frames[vm.frameCount - 1];
@@ -2565,6 +3341,7 @@ op_inherit: {
   ObjClass* subclass = AS_CLASS(peek(0));
   tableAddAll(&AS_CLASS(superclass)->methods,
               &subclass->methods);
+  if (subclass->obj.isMarked) rememberObject((Obj*)subclass);
   pop(); // Subclass.
   DISPATCH();
 }
@@ -2647,96 +3424,168 @@ op_hash_literal: {
   TRACE();
   int pairCount = READ_BYTE();
   ObjHash* hash = newHash();
-  
-  // Pop key-value pairs from stack and add to hash
+  push(OBJ_VAL(hash));
+
+  // Add key-value pairs to the hash, last pair first. The pairs are left
+  // on the stack (beneath the hash) until every entry has been stored.
   for (int i = 0; i < pairCount; i++) {
-    Value value = pop();
-    Value key = pop();
+    Value* pair = vm.stackTop - 1 - 2 * (i + 1);
+    Value key = pair[0];
+    Value value = pair[1];
     
-    // Convert key to string if it's not already
-    ObjString* keyString;
-    if (IS_STRING(key)) {
-      keyString = AS_STRING(key);
-    } else if (IS_NUMBER(key)) {
-      // Convert number to string
-      char buffer[32];
-      int len = formatNumber(buffer, sizeof(buffer), AS_NUMBER(key));
-      keyString = copyString(buffer, len);
-    } else {
-      runtimeError("Hash keys must be strings or numbers.");
+    if (IS_NIL(key)) {
+      runtimeError("Hash keys cannot be nil.");
       return INTERPRET_RUNTIME_ERROR;
     }
-    
-    tableSet(&hash->table, keyString, value);
+
+    tableSetValue(&hash->table, key, value);
+    writeBarrier((Obj*)hash, key);
+    writeBarrier((Obj*)hash, value);
   }
-  
+
+  vm.stackTop -= pairCount * 2 + 1;
   push(OBJ_VAL(hash));
   DISPATCH();
 }
 
+//> Arrays array-ops
+op_array_literal: {
+  TRACE();
+  int count = READ_BYTE();
+  ObjArray* array = newArray();
+  push(OBJ_VAL(array));
+
+  // The elements stay on the stack beneath the array until they have been
+  // copied, so the single allocation below cannot collect them.
+  if (count > 0) {
+    array->elements.values = GROW_ARRAY(Value, NULL, 0, count);
+    array->elements.capacity = count;
+  }
+  Value* elements = vm.stackTop - 1 - count;
+  for (int i = 0; i < count; i++) {
+    array->elements.values[i] = elements[i];
+    writeBarrier((Obj*)array, elements[i]);
+  }
+  array->elements.count = count;
+
+  vm.stackTop -= count + 1;
+  push(OBJ_VAL(array));
+  DISPATCH();
+}
+
+op_get_array_index: {
+  TRACE();
+  // Emitted when the receiver is statically an array: load straight from
+  // the element storage without touching the hash path.
+  Value index = peek(0);
+  Value arrayValue = peek(1);
+  if (!IS_ARRAY(arrayValue)) {
+    runtimeError("Only arrays support typed indexing.");
+    return INTERPRET_RUNTIME_ERROR;
+  }
+
+  ObjArray* array = AS_ARRAY(arrayValue);
+  int slot;
+  if (!arrayIndex(array, index, &slot)) {
+    return INTERPRET_RUNTIME_ERROR;
+  }
+  vm.stackTop -= 2;
+  push(array->elements.values[slot]);
+  DISPATCH();
+}
+
+op_set_array_index: {
+  TRACE();
+  Value value = peek(0);
+  Value index = peek(1);
+  Value arrayValue = peek(2);
+  if (!IS_ARRAY(arrayValue)) {
+    runtimeError("Only arrays support typed indexing.");
+    return INTERPRET_RUNTIME_ERROR;
+  }
+
+  ObjArray* array = AS_ARRAY(arrayValue);
+  int slot;
+  if (!arrayIndex(array, index, &slot)) {
+    return INTERPRET_RUNTIME_ERROR;
+  }
+  array->elements.values[slot] = value;
+  writeBarrier((Obj*)array, value);
+  vm.stackTop -= 3;
+  push(value); // Assignment returns the assigned value
+  DISPATCH();
+}
+//< Arrays array-ops
+
 op_get_index: {
   TRACE();
-  Value index = pop();
-  Value hashValue = pop();
-  
+  // Keys of any type are looked up as-is, so a lookup never allocates.
+  Value index = peek(0);
+  Value hashValue = peek(1);
+
+  if (IS_ARRAY(hashValue)) {
+    ObjArray* array = AS_ARRAY(hashValue);
+    int slot;
+    if (!arrayIndex(array, index, &slot)) {
+      return INTERPRET_RUNTIME_ERROR;
+    }
+    vm.stackTop -= 2;
+    push(array->elements.values[slot]);
+    DISPATCH();
+  }
+
   if (!IS_HASH(hashValue)) {
-    runtimeError("Only hashes support indexing.");
+    runtimeError("Only hashes and arrays support indexing.");
     return INTERPRET_RUNTIME_ERROR;
   }
   
   ObjHash* hash = AS_HASH(hashValue);
-  
-  // Convert index to string if it's not already
-  ObjString* keyString;
-  if (IS_STRING(index)) {
-    keyString = AS_STRING(index);
-  } else if (IS_NUMBER(index)) {
-    // Convert number to string
-    char buffer[32];
-    int len = formatNumber(buffer, sizeof(buffer), AS_NUMBER(index));
-    keyString = copyString(buffer, len);
-  } else {
-    runtimeError("Hash keys must be strings or numbers.");
-    return INTERPRET_RUNTIME_ERROR;
-  }
-  
   Value value;
-  if (tableGet(&hash->table, keyString, &value)) {
-    push(value);
-  } else {
-    push(NIL_VAL);
+  if (!tableGetValue(&hash->table, index, &value)) {
+    value = NIL_VAL;
   }
+  pop();
+  pop();
+  push(value);
   DISPATCH();
 }
 
 op_set_index: {
   TRACE();
-  Value value = pop();
-  Value index = pop();
-  Value hashValue = pop();
-  
+  // Operands stay on the stack until the store is done so that a
+  // collection triggered by growing the table cannot free them.
+  Value value = peek(0);
+  Value index = peek(1);
+  Value hashValue = peek(2);
+
+  if (IS_ARRAY(hashValue)) {
+    ObjArray* array = AS_ARRAY(hashValue);
+    int slot;
+    if (!arrayIndex(array, index, &slot)) {
+      return INTERPRET_RUNTIME_ERROR;
+    }
+    array->elements.values[slot] = value;
+    writeBarrier((Obj*)array, value);
+    vm.stackTop -= 3;
+    push(value);
+    DISPATCH();
+  }
+
   if (!IS_HASH(hashValue)) {
-    runtimeError("Only hashes support indexing.");
+    runtimeError("Only hashes and arrays support indexing.");
     return INTERPRET_RUNTIME_ERROR;
   }
   
   ObjHash* hash = AS_HASH(hashValue);
-  
-  // Convert index to string if it's not already
-  ObjString* keyString;
-  if (IS_STRING(index)) {
-    keyString = AS_STRING(index);
-  } else if (IS_NUMBER(index)) {
-    // Convert number to string
-    char buffer[32];
-    int len = formatNumber(buffer, sizeof(buffer), AS_NUMBER(index));
-    keyString = copyString(buffer, len);
-  } else {
-    runtimeError("Hash keys must be strings or numbers.");
+  if (IS_NIL(index)) {
+    runtimeError("Hash keys cannot be nil.");
     return INTERPRET_RUNTIME_ERROR;
   }
-  
-  tableSet(&hash->table, keyString, value);
+
+  tableSetValue(&hash->table, index, value);
+  writeBarrier((Obj*)hash, index);
+  writeBarrier((Obj*)hash, value);
+  vm.stackTop -= 3;
   push(value); // Assignment returns the assigned value
   DISPATCH();
 }
@@ -2811,6 +3660,16 @@ op_type_cast: {
       }
       break;
     }
+    case TOKEN_RETURNTYPE_ARRAY: {
+      if (IS_ARRAY(value)) {
+        // Already an array, just push it back
+        push(value);
+      } else {
+        runtimeError("Cannot cast value to array.");
+        return INTERPRET_RUNTIME_ERROR;
+      }
+      break;
+    }
     default:
       runtimeError("Unknown target type for cast.");
       return INTERPRET_RUNTIME_ERROR;
@@ -2818,9 +3677,204 @@ op_type_cast: {
   DISPATCH();
 }
 
+//> Superinstructions superinstruction-handlers
+// Each fused handler does the work of its whole sequence, skipping the
+// opcode bytes that the peephole pass left between the operands.
+op_get_local_get_local: {
+  TRACE();
+  uint8_t first = READ_BYTE();
+  frame->ip++;
+  uint8_t second = READ_BYTE();
+  push(frame->slots[first]);
+  push(frame->slots[second]);
+  LIKELY_DISPATCH();
+}
+
+op_get_local_constant: {
+  TRACE();
+  uint8_t slot = READ_BYTE();
+  frame->ip++;
+  push(frame->slots[slot]);
+  push(frame->closure->function->chunk.constants.values[READ_BYTE()]);
+  LIKELY_DISPATCH();
+}
+
+op_add_local_local: {
+  TRACE();
+  uint8_t first = READ_BYTE();
+  frame->ip++;
+  uint8_t second = READ_BYTE();
+  frame->ip++;
+  push(NUMBER_VAL(AS_NUMBER(frame->slots[first]) +
+                  AS_NUMBER(frame->slots[second])));
+  LIKELY_DISPATCH();
+}
+
+op_add_local_constant: {
+  TRACE();
+  uint8_t slot = READ_BYTE();
+  frame->ip++;
+  Value constant =
+      frame->closure->function->chunk.constants.values[READ_BYTE()];
+  frame->ip++;
+  push(NUMBER_VAL(AS_NUMBER(frame->slots[slot]) + AS_NUMBER(constant)));
+  LIKELY_DISPATCH();
+}
+
+op_subtract_local_constant: {
+  TRACE();
+  uint8_t slot = READ_BYTE();
+  frame->ip++;
+  Value constant =
+      frame->closure->function->chunk.constants.values[READ_BYTE()];
+  frame->ip++;
+  push(NUMBER_VAL(AS_NUMBER(frame->slots[slot]) - AS_NUMBER(constant)));
+  LIKELY_DISPATCH();
+}
+
+op_set_local_pop: {
+  TRACE();
+  uint8_t slot = READ_BYTE();
+  frame->ip++;
+  frame->slots[slot] = pop();
+  LIKELY_DISPATCH();
+}
+
+op_set_global_slot_pop: {
+  TRACE();
+  uint16_t slot = READ_SHORT();
+  frame->ip++;
+  if (UNLIKELY(IS_UNDEFINED(vm.globalValues.values[slot]))) {
+    runtimeError("Undefined variable '%s'.", globalSlotName(slot));
+    return INTERPRET_RUNTIME_ERROR;
+  }
+  vm.globalValues.values[slot] = pop();
+  DISPATCH();
+}
+
+op_pop_loop: {
+  TRACE();
+  pop();
+  frame->ip++;
+  uint16_t offset = READ_SHORT();
+  frame->ip -= offset;
+  gcSafepoint();
+  ENTER_HOT_LOOP();
+  DISPATCH();
+}
+//< Superinstructions superinstruction-handlers
+
+//> Quickening quickened-handlers
+op_quick_add_number: {
+  TRACE();
+  if (UNLIKELY(!IS_NUMBER(peek(0)) || !IS_NUMBER(peek(1)))) {
+    DEQUICKEN(OP_ADD);
+    DISPATCH();
+  }
+  vm.stackTop--;
+  vm.stackTop[-1] = NUMBER_VAL(AS_NUMBER(vm.stackTop[-1]) +
+                               AS_NUMBER(vm.stackTop[0]));
+  LIKELY_DISPATCH();
+}
+
+op_quick_add_string: {
+  TRACE();
+  if (UNLIKELY(!IS_STRING(peek(0)) || !IS_STRING(peek(1)))) {
+    DEQUICKEN(OP_ADD);
+    DISPATCH();
+  }
+  concatenate();
+  DISPATCH();
+}
+
+op_quick_less_number: {
+  TRACE();
+  if (UNLIKELY(!IS_NUMBER(peek(0)) || !IS_NUMBER(peek(1)))) {
+    DEQUICKEN(OP_LESS);
+    DISPATCH();
+  }
+  vm.stackTop--;
+  vm.stackTop[-1] = BOOL_VAL(AS_NUMBER(vm.stackTop[-1]) <
+                             AS_NUMBER(vm.stackTop[0]));
+  LIKELY_DISPATCH();
+}
+
+op_quick_greater_number: {
+  TRACE();
+  if (UNLIKELY(!IS_NUMBER(peek(0)) || !IS_NUMBER(peek(1)))) {
+    DEQUICKEN(OP_GREATER);
+    DISPATCH();
+  }
+  vm.stackTop--;
+  vm.stackTop[-1] = BOOL_VAL(AS_NUMBER(vm.stackTop[-1]) >
+                             AS_NUMBER(vm.stackTop[0]));
+  LIKELY_DISPATCH();
+}
+
+op_quick_equal_number: {
+  TRACE();
+  if (UNLIKELY(!IS_NUMBER(peek(0)) || !IS_NUMBER(peek(1)))) {
+    DEQUICKEN(OP_EQUAL);
+    DISPATCH();
+  }
+  vm.stackTop--;
+  vm.stackTop[-1] = BOOL_VAL(AS_NUMBER(vm.stackTop[-1]) ==
+                             AS_NUMBER(vm.stackTop[0]));
+  LIKELY_DISPATCH();
+}
+//< Quickening quickened-handlers
+//> Fused Branches compare-jump-handlers
+
+op_jump_if_not_less_number: {
+  TRACE();
+  COMPARE_JUMP(<);
+  LIKELY_DISPATCH();
+}
+
+op_jump_if_not_less_equal_number: {
+  TRACE();
+  COMPARE_JUMP(<=);
+  LIKELY_DISPATCH();
+}
+
+op_jump_if_not_greater_number: {
+  TRACE();
+  COMPARE_JUMP(>);
+  LIKELY_DISPATCH();
+}
+
+op_jump_if_not_greater_equal_number: {
+  TRACE();
+  COMPARE_JUMP(>=);
+  LIKELY_DISPATCH();
+}
+
+op_jump_if_not_equal_number: {
+  TRACE();
+  COMPARE_JUMP(==);
+  LIKELY_DISPATCH();
+}
+//< Fused Branches compare-jump-handlers
+//> JIT Integration step-done
+
+op_step_done:
+  // Back up over the opcode the dispatch just read.
+  frame->ip--;
+  return INTERPRET_OK;
+//< JIT Integration step-done
+
 #else
   // Fallback to switch statement if computed goto is not available
+//> JIT Integration step-switch
+  bool stepped = false;
+//< JIT Integration step-switch
   for (;;) {
+//> JIT Integration step-switch-check
+    if (singleStep) {
+      if (stepped) return INTERPRET_OK;
+      stepped = true;
+    }
+//< JIT Integration step-switch-check
 //> trace-execution
 #ifdef DEBUG_TRACE_EXECUTION
 //> trace-stack
@@ -2886,8 +3940,14 @@ op_type_cast: {
 //> Global Variables interpret-get-global
       case OP_GET_GLOBAL: {
         ObjString* name = READ_STRING();
+/* Global Variables interpret-get-global < Global Slots get-global-by-name
         Value value;
         if (!tableGet(&vm.globals, name, &value)) {
+*/
+//> Global Slots get-global-by-name
+        Value value = vm.globalValues.values[globalSlot(name)];
+        if (IS_UNDEFINED(value)) {
+//< Global Slots get-global-by-name
           runtimeError("Undefined variable '%s'.", AS_CSTRING(OBJ_VAL(name)));
           return INTERPRET_RUNTIME_ERROR;
         }
@@ -2898,7 +3958,13 @@ op_type_cast: {
 //> Global Variables interpret-define-global
       case OP_DEFINE_GLOBAL: {
         ObjString* name = READ_STRING();
+/* Global Variables interpret-define-global < Global Slots define-global-by-name
         tableSet(&vm.globals, name, peek(0));
+*/
+//> Global Slots define-global-by-name
+        int slot = globalSlot(name);
+        vm.globalValues.values[slot] = peek(0);
+//< Global Slots define-global-by-name
         pop();
         break;
       }
@@ -2906,14 +3972,51 @@ op_type_cast: {
 //> Global Variables interpret-set-global
       case OP_SET_GLOBAL: {
         ObjString* name = READ_STRING();
+/* Global Variables interpret-set-global < Global Slots set-global-by-name
         if (tableSet(&vm.globals, name, peek(0))) {
           tableDelete(&vm.globals, name); // [delete]
           runtimeError("Undefined variable '%s'.", AS_CSTRING(OBJ_VAL(name)));
           return INTERPRET_RUNTIME_ERROR;
         }
+*/
+//> Global Slots set-global-by-name
+        int slot = globalSlot(name);
+        if (IS_UNDEFINED(vm.globalValues.values[slot])) {
+          runtimeError("Undefined variable '%s'.", AS_CSTRING(OBJ_VAL(name)));
+          return INTERPRET_RUNTIME_ERROR;
+        }
+        vm.globalValues.values[slot] = peek(0);
+//< Global Slots set-global-by-name
         break;
       }
 //< Global Variables interpret-set-global
+//> Global Slots interpret-global-slots
+      case OP_GET_GLOBAL_SLOT: {
+        uint16_t slot = READ_SHORT();
+        Value value = vm.globalValues.values[slot];
+        if (IS_UNDEFINED(value)) {
+          runtimeError("Undefined variable '%s'.", globalSlotName(slot));
+          return INTERPRET_RUNTIME_ERROR;
+        }
+        push(value);
+        break;
+      }
+      case OP_DEFINE_GLOBAL_SLOT: {
+        vm.globalValues.values[READ_SHORT()] = pop();
+        break;
+      }
+      case OP_SET_GLOBAL_SLOT: {
+        uint16_t slot = READ_SHORT();
+        // vm.globalValues is scanned as a root by every collection, minor
+        // or full, so stores into it need no write barrier.
+        if (IS_UNDEFINED(vm.globalValues.values[slot])) {
+          runtimeError("Undefined variable '%s'.", globalSlotName(slot));
+          return INTERPRET_RUNTIME_ERROR;
+        }
+        vm.globalValues.values[slot] = peek(0);
+        break;
+      }
+//< Global Slots interpret-global-slots
 //> Closures interpret-get-upvalue
       case OP_GET_UPVALUE: {
         uint8_t slot = READ_BYTE();
@@ -2924,7 +4027,9 @@ op_type_cast: {
 //> Closures interpret-set-upvalue
       case OP_SET_UPVALUE: {
         uint8_t slot = READ_BYTE();
-        *frame->closure->upvalues[slot]->location = peek(0);
+        ObjUpvalue* upvalue = frame->closure->upvalues[slot];
+        *upvalue->location = peek(0);
+        writeBarrier((Obj*)upvalue, peek(0));
         break;
       }
 //< Closures interpret-set-upvalue
@@ -2949,18 +4054,26 @@ op_type_cast: {
         ObjInstance* instance = AS_INSTANCE(peek(0));
         ObjString* name = READ_STRING();
         
+/* Shapes get-field-slot < Inline Caches get-property-ic
         Value value;
-        if (tableGet(&instance->fields, name, &value)) {
+        if (instanceGetField(instance, name, &value)) {
           pop(); // Instance.
           push(value);
           break;
         }
-//> get-undefined
 
-//< get-undefined
         if (!bindMethod(instance->klass, name)) {
           return INTERPRET_RUNTIME_ERROR;
         }
+*/
+//> Inline Caches get-property-ic
+        PropertyCache* cache = READ_PROPERTY_CACHE();
+        if (!getCachedProperty(cache, instance) &&
+            !getUncachedProperty(frame->closure->function, cache, instance,
+                                 name)) {
+          return INTERPRET_RUNTIME_ERROR;
+        }
+//< Inline Caches get-property-ic
         break;
       }
 //< Classes and Instances interpret-get-property
@@ -2984,7 +4097,16 @@ op_type_cast: {
         
         ObjInstance* instance = AS_INSTANCE(peek(1));
         ObjString* name = READ_STRING();
-        tableSet(&instance->fields, name, peek(0));
+/* Shapes set-field-slot < Inline Caches set-property-ic
+        instanceSetField(instance, name, peek(0));
+*/
+//> Inline Caches set-property-ic
+        PropertyCache* cache = READ_PROPERTY_CACHE();
+        if (!setCachedProperty(cache, instance, peek(0))) {
+          setUncachedProperty(frame->closure->function, cache, instance, name,
+                              peek(0));
+        }
+//< Inline Caches set-property-ic
         Value value = pop();
         pop();
         push(value);
@@ -3006,13 +4128,32 @@ op_type_cast: {
       case OP_EQUAL: {
         Value b = pop();
         Value a = pop();
+//> Quickening quicken-equal
+        if (IS_NUMBER(a) && IS_NUMBER(b)) QUICKEN(OP_QUICK_EQUAL_NUMBER);
+//< Quickening quicken-equal
         push(BOOL_VAL(valuesEqual(a, b)));
         break;
       }
 //< Types of Values interpret-equal
 //> Types of Values interpret-comparison
+/* Types of Values interpret-comparison < Quickening quicken-comparison
       case OP_GREATER:  BINARY_OP(BOOL_VAL, >); break;
       case OP_LESS:     BINARY_OP(BOOL_VAL, <); break;
+*/
+//> Quickening quicken-comparison
+      case OP_GREATER:
+        if (IS_NUMBER(peek(0)) && IS_NUMBER(peek(1))) {
+          QUICKEN(OP_QUICK_GREATER_NUMBER);
+        }
+        BINARY_OP(BOOL_VAL, >);
+        break;
+      case OP_LESS:
+        if (IS_NUMBER(peek(0)) && IS_NUMBER(peek(1))) {
+          QUICKEN(OP_QUICK_LESS_NUMBER);
+        }
+        BINARY_OP(BOOL_VAL, <);
+        break;
+//< Quickening quicken-comparison
 //< Types of Values interpret-comparison
 /* A Virtual Machine op-binary < Types of Values op-arithmetic
       case OP_ADD:      BINARY_OP(+); break;
@@ -3028,9 +4169,26 @@ op_type_cast: {
 */
 //> Strings add-strings
       case OP_ADD: {
+/* Strings add-strings < Quickening quicken-add
         // Generic OP_ADD should never be emitted by the optimized compiler
         runtimeError("Generic OP_ADD used - compiler error. Use OP_ADD_NUMBER or OP_ADD_STRING.");
         return INTERPRET_RUNTIME_ERROR;
+*/
+//> Quickening quicken-add
+        if (IS_NUMBER(peek(0)) && IS_NUMBER(peek(1))) {
+          QUICKEN(OP_QUICK_ADD_NUMBER);
+          double b = AS_NUMBER(pop());
+          double a = AS_NUMBER(pop());
+          push(NUMBER_VAL(a + b));
+        } else if (IS_STRING(peek(0)) && IS_STRING(peek(1))) {
+          QUICKEN(OP_QUICK_ADD_STRING);
+          concatenate();
+        } else {
+          runtimeError("Operands must be two numbers or two strings.");
+          return INTERPRET_RUNTIME_ERROR;
+        }
+        break;
+//< Quickening quicken-add
       }
       case OP_ADD_NUMBER: {
         // Optimized numeric addition - no type check needed
@@ -3214,8 +4372,11 @@ op_type_cast: {
           return INTERPRET_RUNTIME_ERROR;
         }
         
-        // Create closure for the module
+        // Create closure for the module, keeping the function reachable
+        // while the closure is allocated
+        push(OBJ_VAL(function));
         ObjClosure* closure = newClosure(function);
+        pop();
         push(OBJ_VAL(closure));
         
         // Execute the module in the current context
@@ -3239,27 +4400,108 @@ op_type_cast: {
       }
       case OP_LOOP: {
         uint16_t offset = READ_SHORT();
-        
-        // Track loop back edge for JIT compilation
-        trackLoopBackEdge(frame->ip - offset);
-        
         frame->ip -= offset;
+        gcSafepoint();
+        ENTER_HOT_LOOP();
         break;
       }
       case OP_CALL: {
         int argCount = READ_BYTE();
+/* Calls and Functions interpret-call < Inline Caches call-site-cache
         if (!callValue(peek(argCount), argCount)) {
           return INTERPRET_RUNTIME_ERROR;
         }
+*/
+//> Inline Caches call-site-cache
+        InlineCache* cache = READ_CALL_CACHE();
+        if (!callWithCache(frame->closure->function, cache, argCount)) {
+          return INTERPRET_RUNTIME_ERROR;
+        }
+//< Inline Caches call-site-cache
+        frame = &vm.frames[vm.frameCount - 1];
+        break;
+      }
+//> Tail Calls interpret-tail-call
+      case OP_TAIL_CALL: {
+        int argCount = READ_BYTE();
+        InlineCache* cache = READ_CALL_CACHE();
+        if (!tailCall(frame->closure->function, cache, argCount)) {
+          return INTERPRET_RUNTIME_ERROR;
+        }
+        frame = &vm.frames[vm.frameCount - 1];
+        break;
+      }
+//< Tail Calls interpret-tail-call
+//> Inlining interpret-inline
+      case OP_INLINE_CALL: {
+        int argCount = READ_BYTE();
+        ObjFunction* inlined = AS_FUNCTION(READ_CONSTANT());
+        uint16_t skip = READ_SHORT();
+        Value callee = peek(argCount);
+        if (IS_CLOSURE(callee) && AS_CLOSURE(callee)->function == inlined) {
+          break;
+        }
+
+        frame->ip += skip;
+        if (!callValue(callee, argCount)) {
+          return INTERPRET_RUNTIME_ERROR;
+        }
+        frame = &vm.frames[vm.frameCount - 1];
+        break;
+      }
+      case OP_INLINE_INVOKE: {
+        ObjString* method = READ_STRING();
+        int argCount = READ_BYTE();
+        ObjFunction* inlined = AS_FUNCTION(READ_CONSTANT());
+        InlineCache* cache = READ_CALL_CACHE();
+        uint16_t skip = READ_SHORT();
+        if (inlinedMethodMatches(frame->closure->function, cache, method,
+                                 inlined, argCount)) {
+          break;
+        }
+
+        frame->ip += skip;
+        if (!invokeWithCache(frame->closure->function, cache, method,
+                             argCount)) {
+          return INTERPRET_RUNTIME_ERROR;
+        }
         frame = &vm.frames[vm.frameCount - 1];
         break;
       }
+      case OP_GET_STACK: {
+        uint8_t distance = READ_BYTE();
+        Value value = vm.stackTop[-1 - distance];
+        push(value);
+        break;
+      }
+      case OP_SET_STACK: {
+        uint8_t distance = READ_BYTE();
+        vm.stackTop[-1 - distance] = vm.stackTop[-1];
+        break;
+      }
+      case OP_INLINE_RETURN: {
+        uint8_t count = READ_BYTE();
+        Value result = vm.stackTop[-1];
+        vm.stackTop -= count;
+        vm.stackTop[-1] = result;
+        break;
+      }
+//< Inlining interpret-inline
       case OP_INVOKE: {
         ObjString* method = READ_STRING();
         int argCount = READ_BYTE();
+/* Methods and Initializers interpret-invoke < Inline Caches invoke-site-cache
         if (!invoke(method, argCount)) {
           return INTERPRET_RUNTIME_ERROR;
         }
+*/
+//> Inline Caches invoke-site-cache
+        InlineCache* cache = READ_CALL_CACHE();
+        if (!invokeWithCache(frame->closure->function, cache, method,
+                             argCount)) {
+          return INTERPRET_RUNTIME_ERROR;
+        }
+//< Inline Caches invoke-site-cache
         frame = &vm.frames[vm.frameCount - 1];
         break;
       }
@@ -3301,6 +4543,7 @@ op_type_cast: {
           } else {
             closure->upvalues[i] = frame->closure->upvalues[index];
           }
+          writeBarrier((Obj*)closure, OBJ_VAL(closure->upvalues[i]));
         }
         DISPATCH();
       }
@@ -3321,6 +4564,7 @@ op_type_cast: {
         vm.stackTop = frame->slots;
         push(result);
         frame = &vm.frames[vm.frameCount - 1];
+        gcSafepoint();
         break;
       }
       case OP_CLASS:
@@ -3334,38 +4578,16 @@ op_type_cast: {
         ObjClosure* method = AS_CLOSURE(peek(0));
         ObjModule* module = AS_MODULE(peek(1));
         
-        tableSet(&module->functions, methodName, OBJ_VAL(method));
+        moduleSetFunction(module, methodName, OBJ_VAL(method));
         pop(); // Method closure
         break;
       }
       case OP_MODULE_CALL: {
         ObjString* methodName = READ_STRING();
         int argCount = READ_BYTE();
-        
-        Value moduleValue = peek(argCount);
-        if (!IS_MODULE(moduleValue)) {
-          runtimeError("Can only call methods on modules.");
-          return INTERPRET_RUNTIME_ERROR;
-        }
-        
-        ObjModule* module = AS_MODULE(moduleValue);
-        Value method;
-        if (!tableGet(&module->functions, methodName, &method)) {
-          runtimeError("Undefined method '%s' in module '%s'.", 
-                       AS_CSTRING(OBJ_VAL(methodName)), 
-                       AS_CSTRING(OBJ_VAL(module->name)));
-          return INTERPRET_RUNTIME_ERROR;
-        }
-        
-        if (!IS_CLOSURE(method)) {
-          runtimeError("Module method is not a function.");
-          return INTERPRET_RUNTIME_ERROR;
-        }
-        
-        // Replace the module on the stack with the method
-        vm.stackTop[-argCount - 1] = method;
-        
-        if (!call(AS_CLOSURE(method), argCount)) {
+        InlineCache* cache = READ_CALL_CACHE();
+        if (!moduleCallWithCache(frame->closure->function, cache,
+                                 methodName, argCount)) {
           return INTERPRET_RUNTIME_ERROR;
         }
         frame = &vm.frames[vm.frameCount - 1];
@@ -3472,8 +4694,11 @@ op_type_cast: {
           return INTERPRET_RUNTIME_ERROR;
         }
         
-        // Create closure for the module
+        // Create closure for the module, keeping the function reachable
+        // while the closure is allocated
+        push(OBJ_VAL(function));
         ObjClosure* closure = newClosure(function);
+        pop();
         push(OBJ_VAL(closure));
         
         // Execute the module in the current context
@@ -3495,98 +4720,165 @@ op_type_cast: {
         ObjClass* subclass = AS_CLASS(peek(0));
         tableAddAll(&AS_CLASS(superclass)->methods,
                     &subclass->methods);
+        if (subclass->obj.isMarked) rememberObject((Obj*)subclass);
         pop(); // Subclass.
         break;
       }
+//> Arrays array-ops
+      case OP_ARRAY_LITERAL: {
+        int count = READ_BYTE();
+        ObjArray* array = newArray();
+        push(OBJ_VAL(array));
+
+        // The elements stay on the stack beneath the array until they have been
+        // copied, so the single allocation below cannot collect them.
+        if (count > 0) {
+          array->elements.values = GROW_ARRAY(Value, NULL, 0, count);
+          array->elements.capacity = count;
+        }
+        Value* elements = vm.stackTop - 1 - count;
+        for (int i = 0; i < count; i++) {
+          array->elements.values[i] = elements[i];
+          writeBarrier((Obj*)array, elements[i]);
+        }
+        array->elements.count = count;
+
+        vm.stackTop -= count + 1;
+        push(OBJ_VAL(array));
+        break;
+      }
+      case OP_GET_ARRAY_INDEX: {
+        // Emitted when the receiver is statically an array: load straight from
+        // the element storage without touching the hash path.
+        Value index = peek(0);
+        Value arrayValue = peek(1);
+        if (!IS_ARRAY(arrayValue)) {
+          runtimeError("Only arrays support typed indexing.");
+          return INTERPRET_RUNTIME_ERROR;
+        }
+
+        ObjArray* array = AS_ARRAY(arrayValue);
+        int slot;
+        if (!arrayIndex(array, index, &slot)) {
+          return INTERPRET_RUNTIME_ERROR;
+        }
+        vm.stackTop -= 2;
+        push(array->elements.values[slot]);
+        break;
+      }
+      case OP_SET_ARRAY_INDEX: {
+        Value value = peek(0);
+        Value index = peek(1);
+        Value arrayValue = peek(2);
+        if (!IS_ARRAY(arrayValue)) {
+          runtimeError("Only arrays support typed indexing.");
+          return INTERPRET_RUNTIME_ERROR;
+        }
+
+        ObjArray* array = AS_ARRAY(arrayValue);
+        int slot;
+        if (!arrayIndex(array, index, &slot)) {
+          return INTERPRET_RUNTIME_ERROR;
+        }
+        array->elements.values[slot] = value;
+        writeBarrier((Obj*)array, value);
+        vm.stackTop -= 3;
+        push(value); // Assignment returns the assigned value
+        break;
+      }
+//< Arrays array-ops
       case OP_GET_INDEX: {
-        Value index = pop();
-        Value hashValue = pop();
-        
+        // Keys of any type are looked up as-is, so a lookup never allocates.
+        Value index = peek(0);
+        Value hashValue = peek(1);
+
+        if (IS_ARRAY(hashValue)) {
+          ObjArray* array = AS_ARRAY(hashValue);
+          int slot;
+          if (!arrayIndex(array, index, &slot)) {
+            return INTERPRET_RUNTIME_ERROR;
+          }
+          vm.stackTop -= 2;
+          push(array->elements.values[slot]);
+          break;
+        }
+
         if (!IS_HASH(hashValue)) {
-          runtimeError("Only hashes support indexing.");
+          runtimeError("Only hashes and arrays support indexing.");
           return INTERPRET_RUNTIME_ERROR;
         }
         
         ObjHash* hash = AS_HASH(hashValue);
-        
-        // Convert index to string if it's not already
-        ObjString* keyString;
-        if (IS_STRING(index)) {
-          keyString = AS_STRING(index);
-        } else if (IS_NUMBER(index)) {
-          // Convert number to string
-          char buffer[32];
-          int len = formatNumber(buffer, sizeof(buffer), AS_NUMBER(index));
-          keyString = copyString(buffer, len);
-        } else {
-          runtimeError("Hash keys must be strings or numbers.");
-          return INTERPRET_RUNTIME_ERROR;
-        }
-        
         Value value;
-        if (tableGet(&hash->table, keyString, &value)) {
-          push(value);
-        } else {
-          push(NIL_VAL);
+        if (!tableGetValue(&hash->table, index, &value)) {
+          value = NIL_VAL;
         }
+        pop();
+        pop();
+        push(value);
         break;
       }
       case OP_SET_INDEX: {
-        Value value = pop();
-        Value index = pop();
-        Value hashValue = pop();
-        
+        // Operands stay on the stack until the store is done so that a
+        // collection triggered by growing the table cannot free them.
+        Value value = peek(0);
+        Value index = peek(1);
+        Value hashValue = peek(2);
+
+        if (IS_ARRAY(hashValue)) {
+          ObjArray* array = AS_ARRAY(hashValue);
+          int slot;
+          if (!arrayIndex(array, index, &slot)) {
+            return INTERPRET_RUNTIME_ERROR;
+          }
+          array->elements.values[slot] = value;
+          writeBarrier((Obj*)array, value);
+          vm.stackTop -= 3;
+          push(value);
+          break;
+        }
+
         if (!IS_HASH(hashValue)) {
-          runtimeError("Only hashes support indexing.");
+          runtimeError("Only hashes and arrays support indexing.");
           return INTERPRET_RUNTIME_ERROR;
         }
         
         ObjHash* hash = AS_HASH(hashValue);
-        
-        // Convert index to string if it's not already
-        ObjString* keyString;
-        if (IS_STRING(index)) {
-          keyString = AS_STRING(index);
-        } else if (IS_NUMBER(index)) {
-          // Convert number to string
-          char buffer[32];
-          int len = formatNumber(buffer, sizeof(buffer), AS_NUMBER(index));
-          keyString = copyString(buffer, len);
-        } else {
-          runtimeError("Hash keys must be strings or numbers.");
+        if (IS_NIL(index)) {
+          runtimeError("Hash keys cannot be nil.");
           return INTERPRET_RUNTIME_ERROR;
         }
-        
-        tableSet(&hash->table, keyString, value);
+
+        tableSetValue(&hash->table, index, value);
+        writeBarrier((Obj*)hash, index);
+        writeBarrier((Obj*)hash, value);
+        vm.stackTop -= 3;
         push(value); // Assignment returns the assigned value
         break;
       }
       case OP_HASH_LITERAL: {
         int pairCount = READ_BYTE();
         ObjHash* hash = newHash();
-        
-        // Pop key-value pairs from stack and add to hash
+        push(OBJ_VAL(hash));
+
+        // Add key-value pairs to the hash, last pair first. The pairs are left
+        // on the stack (beneath the hash) until every entry has been stored.
         for (int i = 0; i < pairCount; i++) {
-          Value value = pop();
-          Value key = pop();
+          Value* pair = vm.stackTop - 1 - 2 * (i + 1);
+          Value key = pair[0];
+          Value value = pair[1];
           
-          // Convert key to string if it's not already
-          ObjString* keyString;
-          if (IS_STRING(key)) {
-            keyString = AS_STRING(key);
-          } else if (IS_NUMBER(key)) {
-            // Convert number to string
-            char buffer[32];
-            int len = formatNumber(buffer, sizeof(buffer), AS_NUMBER(key));
-            keyString = copyString(buffer, len);
-          } else {
-            runtimeError("Hash keys must be strings or numbers.");
+          if (IS_NIL(key)) {
+            runtimeError("Hash keys cannot be nil.");
             return INTERPRET_RUNTIME_ERROR;
           }
-          
-          tableSet(&hash->table, keyString, value);
+
+          tableSetValue(&hash->table, key, value);
+          writeBarrier((Obj*)hash, key);
+          writeBarrier((Obj*)hash, value);
         }
-        
+
+        vm.stackTop -= pairCount * 2 + 1;
         push(OBJ_VAL(hash));
         break;
       }
@@ -3659,12 +4951,141 @@ op_type_cast: {
             }
             break;
           }
+          case TOKEN_RETURNTYPE_ARRAY: {
+            if (IS_ARRAY(value)) {
+              // Already an array, just push it back
+              push(value);
+            } else {
+              runtimeError("Cannot cast value to array.");
+              return INTERPRET_RUNTIME_ERROR;
+            }
+            break;
+          }
           default:
             runtimeError("Unknown target type for cast.");
             return INTERPRET_RUNTIME_ERROR;
         }
         break;
       }
+//> Superinstructions interpret-superinstructions
+      case OP_GET_LOCAL_GET_LOCAL: {
+        uint8_t first = READ_BYTE();
+        frame->ip++;
+        uint8_t second = READ_BYTE();
+        push(frame->slots[first]);
+        push(frame->slots[second]);
+        break;
+      }
+      case OP_GET_LOCAL_CONSTANT: {
+        uint8_t slot = READ_BYTE();
+        frame->ip++;
+        push(frame->slots[slot]);
+        push(frame->closure->function->chunk.constants.values[READ_BYTE()]);
+        break;
+      }
+      case OP_ADD_LOCAL_LOCAL: {
+        uint8_t first = READ_BYTE();
+        frame->ip++;
+        uint8_t second = READ_BYTE();
+        frame->ip++;
+        push(NUMBER_VAL(AS_NUMBER(frame->slots[first]) +
+                        AS_NUMBER(frame->slots[second])));
+        break;
+      }
+      case OP_ADD_LOCAL_CONSTANT: {
+        uint8_t slot = READ_BYTE();
+        frame->ip++;
+        Value constant =
+            frame->closure->function->chunk.constants.values[READ_BYTE()];
+        frame->ip++;
+        push(NUMBER_VAL(AS_NUMBER(frame->slots[slot]) + AS_NUMBER(constant)));
+        break;
+      }
+      case OP_SUBTRACT_LOCAL_CONSTANT: {
+        uint8_t slot = READ_BYTE();
+        frame->ip++;
+        Value constant =
+            frame->closure->function->chunk.constants.values[READ_BYTE()];
+        frame->ip++;
+        push(NUMBER_VAL(AS_NUMBER(frame->slots[slot]) - AS_NUMBER(constant)));
+        break;
+      }
+      case OP_SET_LOCAL_POP: {
+        uint8_t slot = READ_BYTE();
+        frame->ip++;
+        frame->slots[slot] = pop();
+        break;
+      }
+      case OP_SET_GLOBAL_SLOT_POP: {
+        uint16_t slot = READ_SHORT();
+        frame->ip++;
+        if (IS_UNDEFINED(vm.globalValues.values[slot])) {
+          runtimeError("Undefined variable '%s'.", globalSlotName(slot));
+          return INTERPRET_RUNTIME_ERROR;
+        }
+        vm.globalValues.values[slot] = pop();
+        break;
+      }
+      case OP_POP_LOOP: {
+        pop();
+        frame->ip++;
+        uint16_t offset = READ_SHORT();
+        frame->ip -= offset;
+        gcSafepoint();
+        ENTER_HOT_LOOP();
+        break;
+      }
+//< Superinstructions interpret-superinstructions
+//> Quickening interpret-quickened
+      case OP_QUICK_ADD_NUMBER: {
+        if (!IS_NUMBER(peek(0)) || !IS_NUMBER(peek(1))) {
+          DEQUICKEN(OP_ADD);
+          break;
+        }
+        double b = AS_NUMBER(pop());
+        double a = AS_NUMBER(pop());
+        push(NUMBER_VAL(a + b));
+        break;
+      }
+      case OP_QUICK_ADD_STRING:
+        if (!IS_STRING(peek(0)) || !IS_STRING(peek(1))) {
+          DEQUICKEN(OP_ADD);
+          break;
+        }
+        concatenate();
+        break;
+      case OP_QUICK_LESS_NUMBER:
+        if (!IS_NUMBER(peek(0)) || !IS_NUMBER(peek(1))) {
+          DEQUICKEN(OP_LESS);
+          break;
+        }
+        BINARY_OP(BOOL_VAL, <);
+        break;
+      case OP_QUICK_GREATER_NUMBER:
+        if (!IS_NUMBER(peek(0)) || !IS_NUMBER(peek(1))) {
+          DEQUICKEN(OP_GREATER);
+          break;
+        }
+        BINARY_OP(BOOL_VAL, >);
+        break;
+      case OP_QUICK_EQUAL_NUMBER: {
+        if (!IS_NUMBER(peek(0)) || !IS_NUMBER(peek(1))) {
+          DEQUICKEN(OP_EQUAL);
+          break;
+        }
+        double b = AS_NUMBER(pop());
+        double a = AS_NUMBER(pop());
+        push(BOOL_VAL(a == b));
+        break;
+      }
+//< Quickening interpret-quickened
+//> Fused Branches interpret-compare-jumps
+      case OP_JUMP_IF_NOT_LESS_NUMBER: COMPARE_JUMP(<); break;
+      case OP_JUMP_IF_NOT_LESS_EQUAL_NUMBER: COMPARE_JUMP(<=); break;
+      case OP_JUMP_IF_NOT_GREATER_NUMBER: COMPARE_JUMP(>); break;
+      case OP_JUMP_IF_NOT_GREATER_EQUAL_NUMBER: COMPARE_JUMP(>=); break;
+      case OP_JUMP_IF_NOT_EQUAL_NUMBER: COMPARE_JUMP(==); break;
+//< Fused Branches interpret-compare-jumps
     }
   }
 #endif
@@ -3679,10 +5100,34 @@ op_type_cast: {
 //> Global Variables undef-read-string
 #undef READ_STRING
 //< Global Variables undef-read-string
+//> Inline Caches undef-read-property-cache
+#undef READ_PROPERTY_CACHE
+#undef READ_CALL_CACHE
+//> Quickening undef-quicken-macros
+#undef QUICKEN
+#undef DEQUICKEN
+//< Quickening undef-quicken-macros
+//> Fused Branches undef-compare-jump
+#undef COMPARE_JUMP
+//< Fused Branches undef-compare-jump
+//> JIT Integration undef-enter-hot-loop
+#undef ENTER_HOT_LOOP
+//< JIT Integration undef-enter-hot-loop
+//< Inline Caches undef-read-property-cache
 //> undef-binary-op
 #undef BINARY_OP
 //< undef-binary-op
 }
+//> JIT Integration run-wrappers
+
+InterpretResult run() {
+  return execute(false);
+}
+
+InterpretResult runInstruction() {
+  return execute(true);
+}
+//< JIT Integration run-wrappers
 //< run
 //> omit
 void hack(bool b) {
@@ -3721,6 +5166,19 @@ InterpretResult interpret(const char* source) {
   ObjFunction* function = compile(source);
   if (function == NULL) return INTERPRET_COMPILE_ERROR;
 
+//> Stack Guards catch-overflow
+#if STACK_GUARDS
+  // Overflowing either stack faults in its guard page and lands here.
+  sigjmp_buf overflow;
+  sigjmp_buf* outer = setStackOverflowTarget(&overflow);
+  if (sigsetjmp(overflow, 1)) {
+    setStackOverflowTarget(outer);
+    stackOverflow();
+    return INTERPRET_RUNTIME_ERROR;
+  }
+#endif
+
+//< Stack Guards catch-overflow
   push(OBJ_VAL(function));
 //< Calls and Functions interpret-stub
 /* Calls and Functions interpret-stub < Calls and Functions interpret
@@ -3748,60 +5206,21 @@ InterpretResult interpret(const char* source) {
   return result;
 */
 //> Calls and Functions end-interpret
+/* Calls and Functions end-interpret < Stack Guards end-interpret
   return run();
+*/
+//> Stack Guards end-interpret
+  InterpretResult result = run();
+#if STACK_GUARDS
+  setStackOverflowTarget(outer);
+#endif
+  return result;
+//< Stack Guards end-interpret
 //< Calls and Functions end-interpret
 //< Compiling Expressions interpret-chunk
 }
 //< interpret
 
-//> Inline Cache Helper Functions
-#if INLINE_CACHE_ENABLED
-static InlineCache* getCallCache(uint32_t callSiteId) {
-  uint32_t index = callSiteId % INLINE_CACHE_SIZE;
-  return &vm.globalCallCache[index];
-}
-
-static bool tryInlineCache(uint32_t callSiteId, ObjClosure* closure, int argCount) {
-  InlineCache* cache = getCallCache(callSiteId);
-  
-  if (cache->callSiteId == callSiteId && cache->closure == closure) {
-    // Cache hit! Direct call without lookup overhead
-    cache->hitCount++;
-    
-    // Optimized call with cached closure
-    #if !OPTIMIZE_SKIP_TYPE_CHECKS
-    if (argCount != closure->function->arity) {
-      runtimeError("Expected %d arguments but got %d.",
-          closure->function->arity, argCount);
-      return false;
-    }
-    #endif
-
-    #if !OPTIMIZE_SKIP_TYPE_CHECKS
-    if (vm.frameCount == FRAMES_MAX) {
-      runtimeError("Stack overflow.");
-      return false;
-    }
-    #endif
-
-    CallFrame* frame = &vm.frames[vm.frameCount++];
-    frame->closure = closure;
-    frame->ip = closure->function->chunk.code;
-    frame->slots = vm.stackTop - argCount - 1;
-    return true;
-  }
-  
-  return false; // Cache miss
-}
-
-static void updateCallCache(uint32_t callSiteId, ObjClosure* closure) {
-  InlineCache* cache = getCallCache(callSiteId);
-  cache->callSiteId = callSiteId;
-  cache->closure = closure;
-  cache->hitCount = 1;
-}
-#endif
-//< Inline Cache Helper Functions
 
 //> Memoization Helper Functions
 #if MEMO_CACHE_ENABLED
@@ -20,8 +20,15 @@
 typedef struct JitFunction JitFunction;
 
 //> Fast Stack Configuration
+/* Fast Stack Configuration < Stack Guards stack-slots-per-frame
 // Use a large fixed stack to eliminate bounds checking
 #define FAST_STACK_SIZE (1024 * 1024)  // 1M stack slots - eliminates reallocation
+*/
+//> Stack Guards stack-slots-per-frame
+// The value stack is reserved at this many slots per allowed frame, so the
+// default depth keeps the old 1M slots. Pages are committed on first use.
+#define STACK_SLOTS_PER_FRAME 64
+//< Stack Guards stack-slots-per-frame
 #define FAST_STACK_ENABLED 1            // Enable fast stack optimizations
 //< Fast Stack Configuration
 
@@ -30,20 +37,16 @@ typedef struct JitFunction JitFunction;
 #define STACK_MAX 256
 */
 //> Calls and Functions frame-max
+/* Calls and Functions frame-max < Stack Guards frame-max
 #define FRAMES_MAX 64
+*/
+//> Stack Guards frame-max
+// Default call depth; --max-frames overrides it.
+#define FRAMES_MAX 16384
+//< Stack Guards frame-max
 //< Calls and Functions frame-max
 //> Calls and Functions call-frame
 
-//> Inline Cache for Function Calls
-#define INLINE_CACHE_SIZE 256
-#define INLINE_CACHE_ENABLED 1
-
-typedef struct InlineCache {
-    ObjClosure* closure;    // Cached function pointer
-    uint32_t callSiteId;    // Call site identifier
-    uint32_t hitCount;      // Number of cache hits
-} InlineCache;
-
 //> Memoization Cache for Recursive Functions
 #define MEMO_CACHE_SIZE 1024
 #define MEMO_CACHE_ENABLED 0  // Disabled for now due to overhead
@@ -65,12 +68,17 @@ typedef struct {
 //< Closures call-frame-closure
   uint8_t* ip;
   Value* slots;
-//> Inline Cache per frame
-  InlineCache* callCache;  // Inline cache for this frame
-//< Inline Cache per frame
 } CallFrame;
 //< Calls and Functions call-frame
 
+//> Incremental GC gc-phase
+typedef enum {
+  GC_PHASE_IDLE,
+  GC_PHASE_MARK,
+  GC_PHASE_SWEEP,
+} GCPhase;
+//< Incremental GC gc-phase
+
 typedef struct {
 /* A Virtual Machine vm-h < Calls and Functions frame-array
   Chunk* chunk;
@@ -79,13 +87,25 @@ typedef struct {
   uint8_t* ip;
 */
 //> Calls and Functions frame-array
+/* Calls and Functions frame-array < Stack Guards frame-array
   CallFrame frames[FRAMES_MAX];
+*/
+//> Stack Guards frame-array
+  CallFrame* frames;                 // maxFrames entries, then a guard page
+  int maxFrames;
+//< Stack Guards frame-array
   int frameCount;
   
 //< Calls and Functions frame-array
 //> vm-stack
 #if FAST_STACK_ENABLED
+/* A Virtual Machine vm-stack < Stack Guards vm-stack
   Value fastStack[FAST_STACK_SIZE];  // Fixed-size stack for maximum performance
+*/
+//> Stack Guards vm-stack
+  Value* fastStack;                  // stackSlots values, then a guard page
+  int stackSlots;
+//< Stack Guards vm-stack
   Value* stackTop;                   // Only need stackTop pointer
 #else
   Value* stack;                      // Dynamic stack (legacy)
@@ -94,7 +114,13 @@ typedef struct {
 #endif
 //< vm-stack
 //> Global Variables vm-globals
+/* Global Variables vm-globals < Global Slots vm-global-slots
   Table globals;
+*/
+//> Global Slots vm-global-slots
+  Table globalNames;        // Global name -> index into globalValues
+  ValueArray globalValues;  // UNDEFINED_VAL until the global is defined
+//< Global Slots vm-global-slots
 //< Global Variables vm-globals
 //> Hash Tables vm-strings
   Table strings;
@@ -105,26 +131,71 @@ typedef struct {
 //> Methods and Initializers vm-init-string
   ObjString* initString;
 //< Methods and Initializers vm-init-string
+//> Arrays vm-array-method-names
+  ObjString* pushString;
+  ObjString* popString;
+  ObjString* lenString;
+//< Arrays vm-array-method-names
 //> Closures open-upvalues-field
   ObjUpvalue* openUpvalues;
 //< Closures open-upvalues-field
+//> Garbage Collection vm-fields
+  size_t bytesAllocated;
+  size_t nextGC;
+//< Garbage Collection vm-fields
 //> Strings objects-root
   Obj* objects;
 //< Strings objects-root
+//> Generational GC vm-fields
+  Obj* youngObjects;                    // Allocated since the last collection
+  struct NurseryBlock* nursery;         // Blocks being bump-allocated into
+  struct NurseryBlock* nurseryCurrent;
+  int nurseryBlockCount;
+  int rememberedCount;
+  int rememberedCapacity;
+  Obj** rememberedSet;
+//< Generational GC vm-fields
+//> Garbage Collection vm-gray-stack
+  int grayCount;
+  int grayCapacity;
+  Obj** grayStack;
+//< Garbage Collection vm-gray-stack
+//> Incremental GC vm-fields
+  GCPhase gcPhase;
+  int gcPauseUs;                 // Slice budget; 0 collects stop-the-world
+  uint8_t gcEpoch;               // Mark value of the cycle in progress
+  bool gcMarkingIncremental;     // markObject() shades for the cycle
+  int gcSafepointCountdown;
+  uint64_t gcLastSliceEnd;       // Microseconds, monotonic
+  Obj** gcSweepLink;             // Next link the incremental sweep visits
+  ObjHash* gcScanHash;           // Large hash being scanned a chunk at a time
+  Entry* gcScanEntries;
+  int gcScanCapacity;
+  int gcScanIndex;
+  int incrementalGrayCount;
+  int incrementalGrayCapacity;
+  Obj** incrementalGrayStack;
+//< Incremental GC vm-fields
 //> Memory Safety VM Fields
   int currentScopeDepth; // Track current scope depth for memory safety
 //< Memory Safety VM Fields
-//> Inline Cache global array
-#if INLINE_CACHE_ENABLED  
-  InlineCache globalCallCache[INLINE_CACHE_SIZE];
-  uint32_t nextCallSiteId;
-#endif
+//> Memory Safety scope-object-fields
+  Obj** scopeObjects;    // Created inside open scopes, innermost scope last
+  int scopeObjectCount;
+  int scopeObjectCapacity;
+//< Memory Safety scope-object-fields
+//> Inline Caches vm-ic-stats
+  uint64_t icHits;
+  uint64_t icMisses;        // Property lookups that went to the shape/class
+  uint64_t icMegamorphic;   // Sites that overflowed their cache
+  uint64_t callCacheHits;
+  uint64_t callCacheMisses;
+//< Inline Caches vm-ic-stats
 //> Memoization Cache global array
 #if MEMO_CACHE_ENABLED
   MemoEntry memoCache[MEMO_CACHE_SIZE];
 #endif
 //< Memoization Cache global array
-//< Inline Cache global array
 } VM;
 
 //> interpret-result
@@ -139,6 +210,9 @@ typedef enum {
 extern VM vm;
 
 //< Strings extern-vm
+//> Stack Guards set-max-frames-h
+void setMaxFrames(int frames);
+//< Stack Guards set-max-frames-h
 void initVM();
 void freeVM();
 /* A Virtual Machine interpret-h < Scanning on Demand vm-interpret-h
@@ -147,9 +221,21 @@ InterpretResult interpret(Chunk* chunk);
 //> Scanning on Demand vm-interpret-h
 InterpretResult interpret(const char* source);
 //< Scanning on Demand vm-interpret-h
+//> Global Slots global-slot-h
+int globalSlot(ObjString* name);
+//< Global Slots global-slot-h
 //> Module System run-h
 InterpretResult run();
 //< Module System run-h
+//> JIT Integration run-instruction-h
+InterpretResult runInstruction();
+//< JIT Integration run-instruction-h
+//> Garbage Collection mark-vm-caches-h
+void markVMCaches();
+//< Garbage Collection mark-vm-caches-h
+//> Inline Caches print-ic-stats-h
+void printInlineCacheStats();
+//< Inline Caches print-ic-stats-h
 //> push-pop
 void push(Value value);
 Value pop();